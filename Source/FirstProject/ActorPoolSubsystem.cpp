@@ -0,0 +1,403 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "ActorPoolSubsystem.h"
+#include "FirstProject.h"
+#include "Engine/World.h"
+#include "Components/DecalComponent.h"
+#include "Components/AudioComponent.h"
+#include "Materials/MaterialInterface.h"
+#include "Sound/SoundBase.h"
+#include "HAL/IConsoleManager.h"
+
+static FAutoConsoleCommandWithWorld LogPoolStatsCommand(
+	TEXT("acrl.Pool.Stats"),
+	TEXT("Logs hit/miss counts of every actor and component pool in the current world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UActorPoolSubsystem* Pool = World ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr)
+		{
+			Pool->LogPoolStats();
+		}
+	}));
+
+void UActorPoolSubsystem::Deinitialize()
+{
+	Buckets.Empty();
+	TimedReleases.Empty();
+	ComponentHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+void FObjectPoolBucket::PurgeStale()
+{
+	for (TSet<TWeakObjectPtr<UObject>>::TIterator It(InUse); It; ++It)
+	{
+		if (!It->IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	Free.RemoveAll([](UObject* Object) { return !IsValid(Object); });
+
+	Stats.InUse = InUse.Num();
+	Stats.Free = Free.Num();
+}
+
+FObjectPoolStats FObjectPoolBucket::GetLiveStats() const
+{
+	FObjectPoolStats LiveStats = Stats;
+	LiveStats.InUse = 0;
+	for (const TWeakObjectPtr<UObject>& Object : InUse)
+	{
+		LiveStats.InUse += Object.IsValid() ? 1 : 0;
+	}
+	LiveStats.Free = 0;
+	for (UObject* Object : Free)
+	{
+		LiveStats.Free += IsValid(Object) ? 1 : 0;
+	}
+	return LiveStats;
+}
+
+bool UActorPoolSubsystem::IsTickable() const
+{
+	return TimedReleases.Num() > 0;
+}
+
+ETickableTickType UActorPoolSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UActorPoolSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UActorPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UActorPoolSubsystem, STATGROUP_Tickables);
+}
+
+void UActorPoolSubsystem::Tick(float DeltaTime)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (int32 Index = TimedReleases.Num() - 1; Index >= 0; Index--)
+	{
+		if (TimedReleases[Index].Value <= Now)
+		{
+			if (UActorComponent* Component = TimedReleases[Index].Key.Get())
+			{
+				ReleaseComponent(Component);
+			}
+			TimedReleases.RemoveAtSwap(Index, 1, false);
+		}
+	}
+}
+
+UObject* UActorPoolSubsystem::PopFree(FObjectPoolBucket& Bucket)
+{
+	while (Bucket.Free.Num() > 0)
+	{
+		UObject* Object = Bucket.Free.Pop(false);
+		// Instances can be destroyed behind our back, e.g. when their level is unloaded
+		if (IsValid(Object))
+		{
+			return Object;
+		}
+	}
+	return nullptr;
+}
+
+AActor* UActorPoolSubsystem::SpawnPooledActor(UClass* Class)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* Actor = GetWorld()->SpawnActor<AActor>(Class, FTransform::Identity, SpawnParams);
+	if (Actor != nullptr)
+	{
+		FObjectPoolBucket& Bucket = Buckets.FindOrAdd(Class);
+		Bucket.InUse.Add(Actor);
+		Bucket.Stats.InUse++;
+		ReleaseActor(Actor);
+	}
+	return Actor;
+}
+
+AActor* UActorPoolSubsystem::AcquireActorOfClass(UClass* Class, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	if (Class == nullptr)
+	{
+		return nullptr;
+	}
+
+	FObjectPoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	AActor* Actor = Cast<AActor>(PopFree(Bucket));
+	if (Actor != nullptr)
+	{
+		Bucket.Stats.Hits++;
+	}
+	else
+	{
+		Bucket.Stats.Misses++;
+		Bucket.PurgeStale();
+		if (SpawnPooledActor(Class) == nullptr)
+		{
+			return nullptr;
+		}
+		// Spawning may have grown the map, so look the bucket up again
+		Actor = Cast<AActor>(PopFree(Buckets.FindChecked(Class)));
+	}
+
+	FObjectPoolBucket& ActiveBucket = Buckets.FindChecked(Class);
+	ActiveBucket.InUse.Add(Actor);
+	ActiveBucket.Stats.InUse++;
+	ActiveBucket.Stats.Free = ActiveBucket.Free.Num();
+
+	Actor->SetOwner(Owner);
+	Actor->SetInstigator(Instigator);
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	Actor->SetActorHiddenInGame(false);
+	Actor->SetActorEnableCollision(true);
+	Actor->SetActorTickEnabled(true);
+
+	if (IPoolableActor* Poolable = Cast<IPoolableActor>(Actor))
+	{
+		Poolable->OnAcquiredFromPool();
+	}
+	return Actor;
+}
+
+bool UActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	if (Actor == nullptr)
+	{
+		return false;
+	}
+
+	FObjectPoolBucket* Bucket = Buckets.Find(Actor->GetClass());
+	if (Bucket == nullptr || Bucket->InUse.Remove(Actor) == 0)
+	{
+		return false;
+	}
+
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	Actor->SetLifeSpan(0.f);
+
+	if (IPoolableActor* Poolable = Cast<IPoolableActor>(Actor))
+	{
+		Poolable->OnReleasedToPool();
+	}
+
+	Bucket->Free.Add(Actor);
+	Bucket->Stats.InUse--;
+	Bucket->Stats.Free = Bucket->Free.Num();
+	return true;
+}
+
+void UActorPoolSubsystem::PrewarmActors(UClass* Class, int32 Count)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	FObjectPoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	Bucket.PurgeStale();
+	const int32 Existing = Bucket.Free.Num() + Bucket.InUse.Num();
+	for (int32 Index = Existing; Index < Count; Index++)
+	{
+		if (SpawnPooledActor(Class) == nullptr)
+		{
+			break;
+		}
+	}
+}
+
+AActor* UActorPoolSubsystem::GetComponentHost()
+{
+	if (ComponentHost == nullptr || ComponentHost->IsPendingKill())
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		ComponentHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	}
+	return ComponentHost;
+}
+
+UActorComponent* UActorPoolSubsystem::CreatePooledComponent(UClass* Class)
+{
+	AActor* Host = GetComponentHost();
+	if (Host == nullptr)
+	{
+		return nullptr;
+	}
+
+	UActorComponent* Component = NewObject<UActorComponent>(Host, Class, NAME_None, RF_Transient);
+	if (UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+	{
+		AudioComponent->bAutoActivate = false;
+		AudioComponent->bAutoDestroy = false;
+		AudioComponent->OnAudioFinishedNative.AddUObject(this, &UActorPoolSubsystem::OnPooledSoundFinished);
+	}
+	Component->RegisterComponent();
+
+	FObjectPoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	Bucket.InUse.Add(Component);
+	Bucket.Stats.InUse++;
+	ReleaseComponent(Component);
+	return Component;
+}
+
+UActorComponent* UActorPoolSubsystem::AcquireComponentOfClass(UClass* Class)
+{
+	if (Class == nullptr)
+	{
+		return nullptr;
+	}
+
+	FObjectPoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	UActorComponent* Component = Cast<UActorComponent>(PopFree(Bucket));
+	if (Component != nullptr)
+	{
+		Bucket.Stats.Hits++;
+	}
+	else
+	{
+		Bucket.Stats.Misses++;
+		Bucket.PurgeStale();
+		if (CreatePooledComponent(Class) == nullptr)
+		{
+			return nullptr;
+		}
+		Component = Cast<UActorComponent>(PopFree(Buckets.FindChecked(Class)));
+	}
+
+	FObjectPoolBucket& ActiveBucket = Buckets.FindChecked(Class);
+	ActiveBucket.InUse.Add(Component);
+	ActiveBucket.Stats.InUse++;
+	ActiveBucket.Stats.Free = ActiveBucket.Free.Num();
+	return Component;
+}
+
+bool UActorPoolSubsystem::ReleaseComponent(UActorComponent* Component)
+{
+	if (Component == nullptr)
+	{
+		return false;
+	}
+
+	FObjectPoolBucket* Bucket = Buckets.Find(Component->GetClass());
+	if (Bucket == nullptr || Bucket->InUse.Remove(Component) == 0)
+	{
+		return false;
+	}
+
+	Component->Deactivate();
+	if (USceneComponent* SceneComponent = Cast<USceneComponent>(Component))
+	{
+		SceneComponent->SetVisibility(false);
+	}
+
+	Bucket->Free.Add(Component);
+	Bucket->Stats.InUse--;
+	Bucket->Stats.Free = Bucket->Free.Num();
+	return true;
+}
+
+void UActorPoolSubsystem::PrewarmComponents(UClass* Class, int32 Count)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	FObjectPoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	Bucket.PurgeStale();
+	const int32 Existing = Bucket.Free.Num() + Bucket.InUse.Num();
+	for (int32 Index = Existing; Index < Count; Index++)
+	{
+		if (CreatePooledComponent(Class) == nullptr)
+		{
+			break;
+		}
+	}
+}
+
+UDecalComponent* UActorPoolSubsystem::SpawnDecalAtLocation(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FRotator& Rotation, float LifeSpan)
+{
+	if (DecalMaterial == nullptr)
+	{
+		return nullptr;
+	}
+
+	UDecalComponent* Decal = AcquireComponent<UDecalComponent>();
+	if (Decal != nullptr)
+	{
+		Decal->SetDecalMaterial(DecalMaterial);
+		Decal->DecalSize = DecalSize;
+		Decal->SetWorldLocationAndRotation(Location, Rotation);
+		Decal->SetVisibility(true);
+		Decal->MarkRenderStateDirty();
+		TimedReleases.Emplace(Decal, GetWorld()->GetTimeSeconds() + LifeSpan);
+	}
+	return Decal;
+}
+
+UAudioComponent* UActorPoolSubsystem::PlaySoundAtLocation(USoundBase* Sound, const FVector& Location)
+{
+	if (Sound == nullptr)
+	{
+		return nullptr;
+	}
+
+	UAudioComponent* AudioComponent = AcquireComponent<UAudioComponent>();
+	if (AudioComponent != nullptr)
+	{
+		AudioComponent->SetSound(Sound);
+		AudioComponent->bAllowSpatialization = true;
+		AudioComponent->SetWorldLocation(Location);
+		AudioComponent->Play();
+	}
+	return AudioComponent;
+}
+
+UAudioComponent* UActorPoolSubsystem::PlaySound2D(USoundBase* Sound)
+{
+	if (Sound == nullptr)
+	{
+		return nullptr;
+	}
+
+	UAudioComponent* AudioComponent = AcquireComponent<UAudioComponent>();
+	if (AudioComponent != nullptr)
+	{
+		AudioComponent->SetSound(Sound);
+		AudioComponent->bAllowSpatialization = false;
+		AudioComponent->Play();
+	}
+	return AudioComponent;
+}
+
+void UActorPoolSubsystem::OnPooledSoundFinished(UAudioComponent* AudioComponent)
+{
+	ReleaseComponent(AudioComponent);
+}
+
+FObjectPoolStats UActorPoolSubsystem::GetPoolStats(UClass* Class) const
+{
+	const FObjectPoolBucket* Bucket = Buckets.Find(Class);
+	return Bucket ? Bucket->GetLiveStats() : FObjectPoolStats();
+}
+
+void UActorPoolSubsystem::LogPoolStats() const
+{
+	for (const TPair<UClass*, FObjectPoolBucket>& Pair : Buckets)
+	{
+		const FObjectPoolStats Stats = Pair.Value.GetLiveStats();
+		UE_LOG(LogFlying, Log, TEXT("Pool %s: %d hits, %d misses, %d in use, %d free"), *GetNameSafe(Pair.Key), Stats.Hits, Stats.Misses, Stats.InUse, Stats.Free);
+	}
+}
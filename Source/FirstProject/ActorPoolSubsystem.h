@@ -0,0 +1,170 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ActorPoolSubsystem.generated.h"
+
+class UDecalComponent;
+class UAudioComponent;
+class UMaterialInterface;
+class USoundBase;
+
+UINTERFACE(MinimalAPI)
+class UPoolableActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/** Implemented by actors that need to reset their own state when recycled by UActorPoolSubsystem */
+class IPoolableActor
+{
+	GENERATED_BODY()
+
+public:
+	/** Called once the actor has been taken from the pool, moved into place and made visible */
+	virtual void OnAcquiredFromPool() {}
+
+	/** Called once the actor has been returned to the pool and hidden */
+	virtual void OnReleasedToPool() {}
+};
+
+/** Usage counters for one pooled class */
+USTRUCT(BlueprintType)
+struct FObjectPoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquires served from a pre-existing instance */
+	UPROPERTY(BlueprintReadOnly, Category = Pool)
+	int32 Hits = 0;
+
+	/** Acquires that had to create a new instance */
+	UPROPERTY(BlueprintReadOnly, Category = Pool)
+	int32 Misses = 0;
+
+	/** Instances currently handed out */
+	UPROPERTY(BlueprintReadOnly, Category = Pool)
+	int32 InUse = 0;
+
+	/** Instances waiting in the pool */
+	UPROPERTY(BlueprintReadOnly, Category = Pool)
+	int32 Free = 0;
+};
+
+/** Free instances and counters for one pooled class */
+USTRUCT()
+struct FObjectPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UObject*> Free;
+
+	/** Instances currently handed out, used to ignore double releases */
+	TSet<TWeakObjectPtr<UObject>> InUse;
+
+	FObjectPoolStats Stats;
+
+	/** Forgets instances destroyed outside the pool, e.g. with their level, so they are neither counted nor reported */
+	void PurgeStale();
+
+	/** Returns Stats with the in use and free counts of live instances only */
+	FObjectPoolStats GetLiveStats() const;
+};
+
+/**
+ * Recycles actors and components instead of creating and destroying them.
+ * Released instances are hidden, have collision and ticking disabled, and are handed out again on the next acquire.
+ */
+UCLASS()
+class FIRSTPROJECT_API UActorPoolSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Takes an actor of Class from the pool, spawning one if the pool is empty */
+	AActor* AcquireActorOfClass(UClass* Class, const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr);
+
+	template<class T>
+	T* AcquireActor(const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr)
+	{
+		return Cast<T>(AcquireActorOfClass(T::StaticClass(), Transform, Owner, Instigator));
+	}
+
+	/** Returns an actor to the pool. Returns false if the actor was not handed out by this pool. */
+	bool ReleaseActor(AActor* Actor);
+
+	/** Makes sure at least Count actors of Class exist in the pool */
+	void PrewarmActors(UClass* Class, int32 Count);
+
+	/** Takes a registered component of Class from the pool, creating one if the pool is empty */
+	UActorComponent* AcquireComponentOfClass(UClass* Class);
+
+	template<class T>
+	T* AcquireComponent()
+	{
+		return Cast<T>(AcquireComponentOfClass(T::StaticClass()));
+	}
+
+	/** Returns a component to the pool. Returns false if the component was not handed out by this pool. */
+	bool ReleaseComponent(UActorComponent* Component);
+
+	/** Makes sure at least Count components of Class exist in the pool */
+	void PrewarmComponents(UClass* Class, int32 Count);
+
+	/** Places a pooled decal that returns itself to the pool after LifeSpan seconds */
+	UDecalComponent* SpawnDecalAtLocation(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FRotator& Rotation, float LifeSpan);
+
+	/** Plays a one-shot sound on a pooled audio component that returns itself to the pool when finished */
+	UAudioComponent* PlaySoundAtLocation(USoundBase* Sound, const FVector& Location);
+
+	/** Plays a non-spatialized one-shot sound on a pooled audio component */
+	UAudioComponent* PlaySound2D(USoundBase* Sound);
+
+	/** Returns the usage counters for Class */
+	UFUNCTION(BlueprintCallable, Category = Pool)
+	FObjectPoolStats GetPoolStats(UClass* Class) const;
+
+	/** Writes the usage counters of every pool to the log */
+	void LogPoolStats() const;
+
+private:
+	/** Spawns a fresh actor of Class, already released into its bucket */
+	AActor* SpawnPooledActor(UClass* Class);
+
+	/** Creates a fresh registered component of Class, already released into its bucket */
+	UActorComponent* CreatePooledComponent(UClass* Class);
+
+	/** Pops a valid free instance out of Bucket, or returns null */
+	UObject* PopFree(FObjectPoolBucket& Bucket);
+
+	/** Actor that owns every pooled component */
+	AActor* GetComponentHost();
+
+	/** Bound to pooled audio components finishing their sound */
+	void OnPooledSoundFinished(UAudioComponent* AudioComponent);
+
+	UPROPERTY()
+	TMap<UClass*, FObjectPoolBucket> Buckets;
+
+	UPROPERTY()
+	AActor* ComponentHost;
+
+	/** Pooled components to release once the world time passes their release time */
+	TArray<TPair<TWeakObjectPtr<UActorComponent>, float>> TimedReleases;
+};
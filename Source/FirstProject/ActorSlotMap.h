@@ -0,0 +1,64 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "GameFramework/Actor.h"
+
+/**
+ * Maps actors to the dense slots of a manager's parallel arrays, and each slot back to its actor's key.
+ * Slots are removed by moving the last one into their place, matching TArray::RemoveAtSwap on the arrays.
+ * Actors are keyed by index and serial number, so a slot can be dropped after its actor is gone, and a new
+ * actor allocated at the same address never finds the old slot.
+ */
+class FActorSlotMap
+{
+public:
+	/** Returns the slot of Actor, or null when it has none */
+	FORCEINLINE const int32* Find(const AActor* Actor) const
+	{
+		return Indices.Find(TObjectKey<AActor>(Actor));
+	}
+
+	FORCEINLINE bool Contains(const AActor* Actor) const
+	{
+		return Indices.Contains(TObjectKey<AActor>(Actor));
+	}
+
+	/** Gives Actor the next slot, which must not be taken yet, and returns it */
+	int32 Add(const AActor* Actor)
+	{
+		const TObjectKey<AActor> Key(Actor);
+		checkSlow(!Indices.Contains(Key));
+		const int32 Index = Keys.Add(Key);
+		Indices.Add(Key, Index);
+		return Index;
+	}
+
+	/** Drops slot Index; the last slot, if another one, moves into it */
+	void RemoveAtSwap(int32 Index)
+	{
+		const int32 LastIndex = Keys.Num() - 1;
+		Indices.Remove(Keys[Index]);
+		if (Index != LastIndex)
+		{
+			Indices.Add(Keys[LastIndex], Index);
+		}
+		Keys.RemoveAtSwap(Index, 1, false);
+	}
+
+	void Empty()
+	{
+		Indices.Empty();
+		Keys.Empty();
+	}
+
+	FORCEINLINE int32 Num() const { return Keys.Num(); }
+
+private:
+	/** Slot of each actor */
+	TMap<TObjectKey<AActor>, int32> Indices;
+
+	/** Actor of each slot */
+	TArray<TObjectKey<AActor>> Keys;
+};
@@ -0,0 +1,175 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "AircraftSwarmSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/PlayerController.h"
+#include "Async/ParallelFor.h"
+
+UAircraftSwarmSubsystem::UAircraftSwarmSubsystem()
+{
+	StepRate = 120.f;
+	MaxSubsteps = 8;
+	AircraftPerTask = 64;
+	RelevantDistance = 2000000.f;
+	RecentlyRenderedTime = 0.25f;
+	DistantWritebackInterval = 8;
+	FrameCounter = 0;
+}
+
+void UAircraftSwarmSubsystem::Deinitialize()
+{
+	Batch.Empty();
+	Members.Empty();
+	MemberSlots.Empty();
+	ViewLocations.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UAircraftSwarmSubsystem::IsTickable() const
+{
+	return Members.Num() > 0;
+}
+
+ETickableTickType UAircraftSwarmSubsystem::GetTickableTickType() const
+{
+	// The class default object never simulates anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UAircraftSwarmSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UAircraftSwarmSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAircraftSwarmSubsystem, STATGROUP_Tickables);
+}
+
+void UAircraftSwarmSubsystem::AddAircraft(AActor* Aircraft, const FFlightModelParams& Params, const FFlightModelState& State)
+{
+	if (Aircraft == nullptr || MemberSlots.Contains(Aircraft))
+	{
+		return;
+	}
+
+	if (Members.Num() == 0)
+	{
+		Clock.Reset();
+	}
+
+	Batch.Add(Params, Aircraft->GetActorLocation(), Aircraft->GetActorQuat(), State);
+	Members.Add(Aircraft);
+	MemberSlots.Add(Aircraft);
+}
+
+void UAircraftSwarmSubsystem::RemoveAircraft(AActor* Aircraft)
+{
+	if (const int32* Index = MemberSlots.Find(Aircraft))
+	{
+		RemoveMemberAtSwap(*Index);
+	}
+}
+
+void UAircraftSwarmSubsystem::RemoveMemberAtSwap(int32 Index)
+{
+	MemberSlots.RemoveAtSwap(Index);
+	Batch.RemoveAtSwap(Index);
+	Members.RemoveAtSwap(Index, 1, false);
+}
+
+void UAircraftSwarmSubsystem::SetAircraftInput(const AActor* Aircraft, const FFlightModelInput& Input)
+{
+	if (const int32* Index = MemberSlots.Find(Aircraft))
+	{
+		Batch.SetInput(*Index, Input);
+	}
+}
+
+FFlightModelState UAircraftSwarmSubsystem::GetAircraftState(const AActor* Aircraft) const
+{
+	const int32* Index = MemberSlots.Find(Aircraft);
+	return Index ? Batch.GetState(*Index) : FFlightModelState();
+}
+
+void UAircraftSwarmSubsystem::DeflectAircraft(const AActor* Aircraft, const FQuat& Rotation, float Alpha)
+{
+	if (const int32* Index = MemberSlots.Find(Aircraft))
+	{
+		// Both ends of the interpolation turn, so the deflection shows at once like a rotated actor would
+		Batch.Rotations[*Index] = FQuat::Slerp(Batch.Rotations[*Index], Rotation, Alpha);
+		Batch.PreviousRotations[*Index] = FQuat::Slerp(Batch.PreviousRotations[*Index], Rotation, Alpha);
+	}
+}
+
+void UAircraftSwarmSubsystem::GatherViewLocations()
+{
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+}
+
+bool UAircraftSwarmSubsystem::IsRelevant(int32 Index, const FVector& Location) const
+{
+	const float RelevantDistanceSquared = FMath::Square(RelevantDistance);
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		if (FVector::DistSquared(ViewLocation, Location) < RelevantDistanceSquared)
+		{
+			return true;
+		}
+	}
+
+	const AActor* Aircraft = Members[Index].Get();
+	return Aircraft && Aircraft->WasRecentlyRendered(RecentlyRenderedTime);
+}
+
+void UAircraftSwarmSubsystem::Tick(float DeltaTime)
+{
+	// Drop members whose actor has gone, walking backwards so the swap does not skip any
+	for (int32 Index = Members.Num() - 1; Index >= 0; Index--)
+	{
+		if (!Members[Index].IsValid())
+		{
+			RemoveMemberAtSwap(Index);
+		}
+	}
+
+	const float StepTime = 1.f / FMath::Max(1.f, StepRate);
+	const int32 NumSteps = Clock.Advance(DeltaTime, StepTime, MaxSubsteps);
+	const int32 NumAircraft = Batch.Num();
+	const int32 ChunkSize = FMath::Max(1, AircraftPerTask);
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumAircraft, ChunkSize);
+	for (int32 StepIndex = 0; StepIndex < NumSteps; StepIndex++)
+	{
+		ParallelFor(NumChunks, [this, StepTime, ChunkSize, NumAircraft](int32 Chunk)
+		{
+			const int32 BeginIndex = Chunk * ChunkSize;
+			Batch.Step(StepTime, BeginIndex, FMath::Min(BeginIndex + ChunkSize, NumAircraft));
+		}, NumChunks < 2);
+	}
+
+	// Only touch the scene for aircraft someone can see, the rest catch up every few frames
+	GatherViewLocations();
+	const float Alpha = Clock.GetAlpha(StepTime);
+	const uint32 Interval = (uint32)FMath::Max(1, DistantWritebackInterval);
+	FrameCounter++;
+	for (int32 Index = 0; Index < NumAircraft; Index++)
+	{
+		const FTransform Transform = Batch.GetInterpolatedTransform(Index, Alpha);
+		if ((Index + FrameCounter) % Interval == 0 || IsRelevant(Index, Transform.GetLocation()))
+		{
+			Members[Index]->SetActorLocationAndRotation(Transform.GetLocation(), Transform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+}
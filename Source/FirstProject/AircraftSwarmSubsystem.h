@@ -0,0 +1,111 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "AircraftBatch.h"
+#include "ActorSlotMap.h"
+#include "AircraftSwarmSubsystem.generated.h"
+
+/**
+ * Flies AI aircraft in bulk instead of one actor tick each.
+ * Every member's state lives in one FAircraftBatch, stepped at a fixed rate across task graph workers.
+ * Actor transforms are only written back every frame for members near a player or recently rendered;
+ * the others are written back round robin every few frames. Members are moved without collision.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UAircraftSwarmSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UAircraftSwarmSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Starts flying Aircraft from its current transform, does nothing if it is already a member */
+	void AddAircraft(AActor* Aircraft, const FFlightModelParams& Params, const FFlightModelState& State);
+
+	/** Stops flying Aircraft and leaves it at its last written transform */
+	void RemoveAircraft(AActor* Aircraft);
+
+	/** Returns whether Aircraft is flown by the swarm */
+	FORCEINLINE bool IsMember(const AActor* Aircraft) const { return MemberSlots.Contains(Aircraft); }
+
+	/** Sets the control axes Aircraft holds from the next step on */
+	void SetAircraftInput(const AActor* Aircraft, const FFlightModelInput& Input);
+
+	/** Returns the flight speeds of Aircraft, or defaults if it is not a member */
+	FFlightModelState GetAircraftState(const AActor* Aircraft) const;
+
+	/**
+	 * Turns the simulated rotation of Aircraft Alpha of the way towards Rotation, e.g. to deflect it off a contact.
+	 * Its actor follows on the next writeback; rotating the actor directly would be overwritten.
+	 */
+	void DeflectAircraft(const AActor* Aircraft, const FQuat& Rotation, float Alpha);
+
+	FORCEINLINE int32 GetNumAircraft() const { return Members.Num(); }
+
+private:
+	/** Removes member Index, keeping MemberSlots in line with the swap */
+	void RemoveMemberAtSwap(int32 Index);
+
+	/** Collects where every local or remote player is looking from */
+	void GatherViewLocations();
+
+	/** Returns whether member Index should have its actor moved this frame */
+	bool IsRelevant(int32 Index, const FVector& Location) const;
+
+	/** Rate at which the swarm is stepped */
+	UPROPERTY(Config)
+	float StepRate;
+
+	/** Most steps run in one frame, time beyond it is dropped after a hitch */
+	UPROPERTY(Config)
+	int32 MaxSubsteps;
+
+	/** Aircraft stepped by one worker task */
+	UPROPERTY(Config)
+	int32 AircraftPerTask;
+
+	/** Members closer than this to a player have their actor moved every frame */
+	UPROPERTY(Config)
+	float RelevantDistance;
+
+	/** Members rendered within this many seconds have their actor moved every frame */
+	UPROPERTY(Config)
+	float RecentlyRenderedTime;
+
+	/** Frames between two moves of the actor of a member that is not relevant */
+	UPROPERTY(Config)
+	int32 DistantWritebackInterval;
+
+	/** State of every member */
+	FAircraftBatch Batch;
+
+	/** Actor of each member, same order as Batch */
+	TArray<TWeakObjectPtr<AActor>> Members;
+
+	/** Index of each member's actor in Batch */
+	FActorSlotMap MemberSlots;
+
+	/** Counts the steps owed each frame */
+	FFixedStepClock Clock;
+
+	/** Player view points this frame */
+	TArray<FVector> ViewLocations;
+
+	/** Frames ticked, picks which distant members are written back */
+	uint32 FrameCounter;
+};
@@ -0,0 +1,80 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "AssetStreamingSubsystem.h"
+#include "FirstProject.h"
+#include "Engine/AssetManager.h"
+#include "HAL/PlatformTime.h"
+
+UAssetStreamingSubsystem::UAssetStreamingSubsystem()
+{
+	NumPreloadsPending = 0;
+	NumPreloadAssets = 0;
+	PreloadStartTime = 0.0;
+}
+
+void UAssetStreamingSubsystem::Deinitialize()
+{
+	for (const TSharedPtr<FStreamableHandle>& Handle : PreloadHandles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->CancelHandle();
+		}
+	}
+	PreloadHandles.Empty();
+	NumPreloadsPending = 0;
+	NumPreloadAssets = 0;
+	OnPreloadComplete.Clear();
+
+	Super::Deinitialize();
+}
+
+TSharedPtr<FStreamableHandle> UAssetStreamingSubsystem::RequestAssets(const TArray<FSoftObjectPath>& Assets, FStreamableDelegate OnLoaded, TAsyncLoadPriority Priority)
+{
+	TArray<FSoftObjectPath> ToLoad;
+	for (const FSoftObjectPath& Asset : Assets)
+	{
+		if (!Asset.IsNull())
+		{
+			ToLoad.AddUnique(Asset);
+		}
+	}
+	if (ToLoad.Num() == 0)
+	{
+		OnLoaded.ExecuteIfBound();
+		return nullptr;
+	}
+
+	// Assets already in memory complete the handle at once and call OnLoaded before this returns
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(ToLoad, OnLoaded, Priority);
+}
+
+void UAssetStreamingSubsystem::Preload(const TArray<FSoftObjectPath>& Assets)
+{
+	if (NumPreloadsPending == 0)
+	{
+		PreloadStartTime = FPlatformTime::Seconds();
+		NumPreloadAssets = 0;
+	}
+	NumPreloadsPending++;
+	NumPreloadAssets += Assets.Num();
+
+	// Counted as pending before the request, which completes immediately if everything is already loaded
+	TSharedPtr<FStreamableHandle> Handle = RequestAssets(Assets, FStreamableDelegate::CreateUObject(this, &UAssetStreamingSubsystem::OnPreloadLoaded), FStreamableManager::AsyncLoadHighPriority);
+	if (Handle.IsValid())
+	{
+		PreloadHandles.Add(Handle);
+	}
+}
+
+void UAssetStreamingSubsystem::OnPreloadLoaded()
+{
+	NumPreloadsPending--;
+	if (NumPreloadsPending > 0)
+	{
+		return;
+	}
+
+	UE_LOG(LogFlying, Log, TEXT("Preloaded %d assets in %.2f s"), NumPreloadAssets, FPlatformTime::Seconds() - PreloadStartTime);
+	OnPreloadComplete.Broadcast();
+}
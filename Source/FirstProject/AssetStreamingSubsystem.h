@@ -0,0 +1,58 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "AssetStreamingSubsystem.generated.h"
+
+/**
+ * Loads soft referenced assets in the background through the asset manager's streamable manager, so classes
+ * no longer drag their meshes and sounds in with their class default objects.
+ * The game mode starts a preload phase with everything the default pawn needs and holds players back until it
+ * is done; what the preload keeps in memory then resolves at once for every actor spawned in this world.
+ */
+UCLASS()
+class FIRSTPROJECT_API UAssetStreamingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UAssetStreamingSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	/**
+	 * Loads Assets in the background.
+	 * @param OnLoaded	Called once all of them are in memory, right away if they already are
+	 * @return Handle keeping the assets in memory until it is released, null if there was nothing to load
+	 */
+	TSharedPtr<FStreamableHandle> RequestAssets(const TArray<FSoftObjectPath>& Assets, FStreamableDelegate OnLoaded = FStreamableDelegate(), TAsyncLoadPriority Priority = FStreamableManager::DefaultAsyncLoadPriority);
+
+	/** Starts loading Assets ahead of play and keeps them in memory for the lifetime of the world */
+	void Preload(const TArray<FSoftObjectPath>& Assets);
+
+	/** Returns whether preloaded assets are still loading */
+	bool IsPreloading() const { return NumPreloadsPending > 0; }
+
+	/** Broadcast once every preload started so far has finished */
+	FSimpleMulticastDelegate OnPreloadComplete;
+
+private:
+	/** Bound to the completion of each preload */
+	void OnPreloadLoaded();
+
+	/** Preloads in flight or done, held until the world goes away */
+	TArray<TSharedPtr<FStreamableHandle>> PreloadHandles;
+
+	/** Preloads that have not finished yet */
+	int32 NumPreloadsPending;
+
+	/** Assets requested by the unfinished preloads */
+	int32 NumPreloadAssets;
+
+	/** Platform time the first unfinished preload started */
+	double PreloadStartTime;
+};
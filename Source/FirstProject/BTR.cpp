@@ -2,33 +2,106 @@
 
 
 #include "BTR.h"
+#include "GroundVehicleSubsystem.h"
+#include "TargetIndexSubsystem.h"
+#include "Components/BoxComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
 
 // Sets default values
 ABTR::ABTR()
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Movement is done in bulk by the ground vehicle subsystem, the vehicle itself never ticks
+	PrimaryActorTick.bCanEverTick = false;
 
+	CollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("CollisionBox0"));
+	CollisionBox->SetCollisionProfileName("Vehicle");
+	CollisionBox->SetBoxExtent(FVector(370.f, 150.f, 120.f), false);
+	RootComponent = CollisionBox;
+
+	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Mesh0"));
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Mesh->SetGenerateOverlapEvents(false);
+	Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	Mesh->SetupAttachment(RootComponent);
+
+	MaxSpeed = 2200.f;
+	Acceleration = 300.f;
+	TurnRate = 30.f;
+	AvoidanceRadius = 400.f;
+	CurrentHealth = 100;
 }
 
 // Called when the game starts or when spawned
 void ABTR::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	if (UGroundVehicleSubsystem* GroundVehicles = GetWorld()->GetSubsystem<UGroundVehicleSubsystem>())
+	{
+		FGroundVehicleParams Params;
+		Params.MaxSpeed = MaxSpeed;
+		Params.Acceleration = Acceleration;
+		Params.TurnRate = TurnRate;
+		Params.Radius = AvoidanceRadius;
+		Params.HalfLength = CollisionBox->GetScaledBoxExtent().X;
+		Params.HalfWidth = CollisionBox->GetScaledBoxExtent().Y;
+		Params.RideHeight = CollisionBox->GetScaledBoxExtent().Z;
+		GroundVehicles->AddVehicle(this, Params);
+	}
+
+	if (UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>())
+	{
+		TargetIndex->AddTarget(this);
+	}
 }
 
-// Called every frame
-void ABTR::Tick(float DeltaTime)
+void ABTR::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (UGroundVehicleSubsystem* GroundVehicles = GetWorld()->GetSubsystem<UGroundVehicleSubsystem>())
+	{
+		GroundVehicles->RemoveVehicle(this);
+	}
 
+	if (UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>())
+	{
+		TargetIndex->RemoveTarget(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
-// Called to bind functionality to input
-void ABTR::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
+void ABTR::DriveAlong(const TArray<FVector>& Waypoints)
 {
-	Super::SetupPlayerInputComponent(PlayerInputComponent);
+	if (UGroundVehicleSubsystem* GroundVehicles = GetWorld()->GetSubsystem<UGroundVehicleSubsystem>())
+	{
+		GroundVehicles->DriveAlong(this, Waypoints);
+	}
+}
 
+void ABTR::Park()
+{
+	if (UGroundVehicleSubsystem* GroundVehicles = GetWorld()->GetSubsystem<UGroundVehicleSubsystem>())
+	{
+		GroundVehicles->Park(this);
+	}
 }
 
+bool ABTR::IsParked() const
+{
+	const UGroundVehicleSubsystem* GroundVehicles = GetWorld()->GetSubsystem<UGroundVehicleSubsystem>();
+	return GroundVehicles == nullptr || GroundVehicles->IsParked(this);
+}
+
+float ABTR::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	const float ActualDamage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	CurrentHealth -= FMath::RoundToInt(ActualDamage);
+
+	// EndPlay takes the wreck out of the ground vehicle subsystem and the target index
+	if (CurrentHealth <= 0 && HasAuthority() && !IsPendingKillPending())
+	{
+		Destroy();
+	}
+	return ActualDamage;
+}
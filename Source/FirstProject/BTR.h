@@ -3,27 +3,78 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "GameFramework/Character.h"
+#include "GameFramework/Pawn.h"
 #include "BTR.generated.h"
 
-UCLASS()
-class FIRSTPROJECT_API ABTR : public ACharacter
+class UBoxComponent;
+class USkeletalMeshComponent;
+
+/**
+ * BTR-80 ground target.
+ * Driven by UGroundVehicleSubsystem rather than a movement component, and never ticked itself,
+ * so a parked vehicle costs nothing per frame.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API ABTR : public APawn
 {
 	GENERATED_BODY()
 
+	/** Coarse hull box, the only collision the vehicle has */
+	UPROPERTY(Category = Mesh, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	UBoxComponent* CollisionBox;
+
+	/** Drawn hull, without collision of its own */
+	UPROPERTY(Category = Mesh, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	USkeletalMeshComponent* Mesh;
+
 public:
-	// Sets default values for this character's properties
+	// Sets default values for this pawn's properties
 	ABTR();
 
+	/** Drives along Waypoints and parks at the last one */
+	UFUNCTION(BlueprintCallable, Category = Movement)
+	void DriveAlong(const TArray<FVector>& Waypoints);
+
+	/** Stops where the vehicle is */
+	UFUNCTION(BlueprintCallable, Category = Movement)
+	void Park();
+
+	UFUNCTION(BlueprintPure, Category = Movement)
+	bool IsParked() const;
+
+	/** Top road speed, in cm/s */
+	UPROPERTY(Category = Movement, Config, EditAnywhere, BlueprintReadOnly)
+	float MaxSpeed;
+
+	/** Speed gained or lost per second, in cm/s */
+	UPROPERTY(Category = Movement, Config, EditAnywhere, BlueprintReadOnly)
+	float Acceleration;
+
+	/** Heading change, in degrees per second */
+	UPROPERTY(Category = Movement, Config, EditAnywhere, BlueprintReadOnly)
+	float TurnRate;
+
+	/** Radius kept clear of other vehicles */
+	UPROPERTY(Category = Movement, Config, EditAnywhere, BlueprintReadOnly)
+	float AvoidanceRadius;
+
+	/** The vehicle is destroyed once this runs out */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	int CurrentHealth;
+
+	// Called when the vehicle is hit by a missile or anything else that applies damage
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
-	// Called to bind functionality to input
-	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
+	// Called when the vehicle leaves play
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+public:
+	/** Returns CollisionBox subobject **/
+	FORCEINLINE UBoxComponent* GetCollisionBox() const { return CollisionBox; }
+	/** Returns Mesh subobject **/
+	FORCEINLINE USkeletalMeshComponent* GetMesh() const { return Mesh; }
 };
@@ -0,0 +1,109 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+
+/** One aggregated contact with a surface, as handed out once per step */
+struct FContactEvent
+{
+	/** Where the surface was last touched */
+	FVector Location;
+
+	/** Surface normal at the last touch */
+	FVector Normal;
+
+	/** Fastest speed into the surface over the whole contact so far, in cm/s */
+	float ImpactSpeed;
+
+	/** ImpactSpeed when the contact was last handed out, 0 for a new contact */
+	float PreviousImpactSpeed;
+};
+
+/**
+ * Merges hit callbacks into one contact per surface.
+ * A sweep that scrapes along a surface reports a hit on every move, so a contact stays open while its surface
+ * keeps being hit and closes once it has been left alone for a while. Only the strongest contact touched since
+ * the previous step is reported, with the peak impact speed of that contact, so whatever is applied per contact
+ * does not depend on how many callbacks a frame or a step happened to produce.
+ */
+struct FContactAggregator
+{
+	/**
+	 * Records one hit callback.
+	 * @param ImpactSpeed	Speed into the surface at the hit, in cm/s
+	 */
+	void AddHit(const UPrimitiveComponent* Surface, const FVector& Location, const FVector& Normal, float ImpactSpeed)
+	{
+		FContact* Contact = Contacts.FindByPredicate([Surface](const FContact& Candidate) { return Candidate.Surface == Surface; });
+		if (Contact == nullptr)
+		{
+			Contact = &Contacts.AddDefaulted_GetRef();
+			Contact->Surface = Surface;
+		}
+
+		Contact->Event.Location = Location;
+		Contact->Event.Normal = Normal;
+		Contact->Event.ImpactSpeed = FMath::Max(Contact->Event.ImpactSpeed, ImpactSpeed);
+		Contact->QuietTime = 0.f;
+		Contact->bTouched = true;
+	}
+
+	/**
+	 * Hands out the strongest contact touched since the last step, then ages every contact by StepTime.
+	 * @param Window	Seconds a contact stays open without being hit
+	 * @return Whether any contact was touched
+	 */
+	bool ConsumeStep(float StepTime, float Window, FContactEvent& OutEvent)
+	{
+		int32 Strongest = INDEX_NONE;
+		for (int32 Index = 0; Index < Contacts.Num(); Index++)
+		{
+			if (Contacts[Index].bTouched && (Strongest == INDEX_NONE || Contacts[Index].Event.ImpactSpeed > Contacts[Strongest].Event.ImpactSpeed))
+			{
+				Strongest = Index;
+			}
+		}
+
+		if (Strongest != INDEX_NONE)
+		{
+			OutEvent = Contacts[Strongest].Event;
+			Contacts[Strongest].Event.PreviousImpactSpeed = Contacts[Strongest].Event.ImpactSpeed;
+		}
+
+		for (int32 Index = Contacts.Num() - 1; Index >= 0; Index--)
+		{
+			FContact& Contact = Contacts[Index];
+			Contact.bTouched = false;
+			Contact.QuietTime += StepTime;
+			if (Contact.QuietTime > Window || !Contact.Surface.IsValid())
+			{
+				Contacts.RemoveAtSwap(Index, 1, false);
+			}
+		}
+
+		return Strongest != INDEX_NONE;
+	}
+
+	/** Forgets every contact */
+	void Reset()
+	{
+		Contacts.Reset();
+	}
+
+private:
+	struct FContact
+	{
+		TWeakObjectPtr<const UPrimitiveComponent> Surface;
+		FContactEvent Event = { FVector::ZeroVector, FVector::UpVector, 0.f, 0.f };
+
+		/** Seconds since the surface was last hit */
+		float QuietTime = 0.f;
+
+		/** Whether the surface was hit since the last step */
+		bool bTouched = false;
+	};
+
+	/** Open contacts, one per surface */
+	TArray<FContact> Contacts;
+};
@@ -0,0 +1,275 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "ConvoyNavGrid.h"
+#include "TerrainHeightfield.h"
+#include "Algo/Reverse.h"
+
+namespace ConvoyNavGrid
+{
+	/** Length of a diagonal step between grid cells */
+	static const float DiagonalStep = 1.41421356f;
+
+	struct FOpenNode
+	{
+		float Score;
+		int32 Index;
+	};
+
+	struct FOpenNodeLess
+	{
+		FORCEINLINE bool operator()(const FOpenNode& A, const FOpenNode& B) const
+		{
+			return A.Score < B.Score;
+		}
+	};
+
+	/** Octile distance, never more than the cheapest route since every cell costs at least 1 */
+	static FORCEINLINE float Heuristic(int32 X, int32 Y, const FIntPoint& Goal)
+	{
+		const int32 DeltaX = FMath::Abs(X - Goal.X);
+		const int32 DeltaY = FMath::Abs(Y - Goal.Y);
+		return float(DeltaX + DeltaY) + (DiagonalStep - 2.f) * FMath::Min(DeltaX, DeltaY);
+	}
+
+	/** A* over an 8-connected grid, entering a cell costs CostAt of it and Blocked cells are never entered */
+	static bool FindGridPath(int32 SizeX, int32 SizeY, TFunctionRef<uint8(int32, int32)> CostAt, const FIntPoint& Start, const FIntPoint& Goal, TArray<FIntPoint>& OutPath)
+	{
+		OutPath.Reset();
+		if (CostAt(Start.X, Start.Y) == FConvoyNavGrid::Blocked || CostAt(Goal.X, Goal.Y) == FConvoyNavGrid::Blocked)
+		{
+			return false;
+		}
+
+		TArray<float> Costs;
+		Costs.Init(MAX_flt, SizeX * SizeY);
+		TArray<int32> Parents;
+		Parents.Init(INDEX_NONE, SizeX * SizeY);
+		TArray<FOpenNode> Open;
+
+		const int32 StartIndex = Start.Y * SizeX + Start.X;
+		const int32 GoalIndex = Goal.Y * SizeX + Goal.X;
+		Costs[StartIndex] = 0.f;
+		Open.HeapPush({ Heuristic(Start.X, Start.Y, Goal), StartIndex }, FOpenNodeLess());
+
+		while (Open.Num() > 0)
+		{
+			FOpenNode Node;
+			Open.HeapPop(Node, FOpenNodeLess(), false);
+			if (Node.Index == GoalIndex)
+			{
+				break;
+			}
+
+			const int32 X = Node.Index % SizeX;
+			const int32 Y = Node.Index / SizeX;
+
+			// A cell is pushed again whenever a cheaper way in is found, skip the stale entries
+			if (Node.Score > Costs[Node.Index] + Heuristic(X, Y, Goal) + KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			for (int32 OffsetY = -1; OffsetY <= 1; OffsetY++)
+			{
+				for (int32 OffsetX = -1; OffsetX <= 1; OffsetX++)
+				{
+					const int32 NextX = X + OffsetX;
+					const int32 NextY = Y + OffsetY;
+					if ((OffsetX == 0 && OffsetY == 0) || NextX < 0 || NextY < 0 || NextX >= SizeX || NextY >= SizeY)
+					{
+						continue;
+					}
+
+					const uint8 CellCost = CostAt(NextX, NextY);
+					if (CellCost == FConvoyNavGrid::Blocked)
+					{
+						continue;
+					}
+
+					// Diagonal steps may not cut the corner of a blocked cell
+					const bool bDiagonal = OffsetX != 0 && OffsetY != 0;
+					if (bDiagonal && (CostAt(NextX, Y) == FConvoyNavGrid::Blocked || CostAt(X, NextY) == FConvoyNavGrid::Blocked))
+					{
+						continue;
+					}
+
+					const int32 NextIndex = NextY * SizeX + NextX;
+					const float NextCost = Costs[Node.Index] + (bDiagonal ? DiagonalStep : 1.f) * CellCost;
+					if (NextCost < Costs[NextIndex])
+					{
+						Costs[NextIndex] = NextCost;
+						Parents[NextIndex] = Node.Index;
+						Open.HeapPush({ NextCost + Heuristic(NextX, NextY, Goal), NextIndex }, FOpenNodeLess());
+					}
+				}
+			}
+		}
+
+		if (GoalIndex != StartIndex && Parents[GoalIndex] == INDEX_NONE)
+		{
+			return false;
+		}
+
+		for (int32 Index = GoalIndex; Index != INDEX_NONE; Index = Parents[Index])
+		{
+			OutPath.Add(FIntPoint(Index % SizeX, Index / SizeX));
+		}
+		Algo::Reverse(OutPath);
+		return true;
+	}
+}
+
+FConvoyNavGrid::FConvoyNavGrid()
+	: Origin(FVector2D::ZeroVector)
+	, CellSize(1.f)
+	, NumX(0)
+	, NumY(0)
+	, ClusterSize(1)
+	, ClustersX(0)
+	, ClustersY(0)
+{
+}
+
+void FConvoyNavGrid::Build(const FTerrainHeightfield& Heightfield, float InCellSize, float MaxSlopeDegrees, int32 InClusterSize)
+{
+	check(InCellSize > 0.f && InClusterSize > 0);
+
+	const FBox Bounds = Heightfield.GetBounds();
+	Origin = FVector2D(Bounds.Min);
+	CellSize = InCellSize;
+	NumX = Heightfield.IsValid() ? FMath::Max(1, FMath::FloorToInt(Bounds.GetSize().X / CellSize)) : 0;
+	NumY = Heightfield.IsValid() ? FMath::Max(1, FMath::FloorToInt(Bounds.GetSize().Y / CellSize)) : 0;
+	ClusterSize = InClusterSize;
+	ClustersX = FMath::DivideAndRoundUp(NumX, ClusterSize);
+	ClustersY = FMath::DivideAndRoundUp(NumY, ClusterSize);
+
+	// Cost grows with the square of the slope, from 1 on flat ground to 16 at the steepest drivable slope
+	const float MaxGradient = FMath::Tan(FMath::DegreesToRadians(MaxSlopeDegrees));
+	const float HalfCell = 0.5f * CellSize;
+	Costs.SetNumUninitialized(NumX * NumY);
+	Heights.SetNumUninitialized(NumX * NumY);
+	for (int32 Y = 0; Y < NumY; Y++)
+	{
+		for (int32 X = 0; X < NumX; X++)
+		{
+			const int32 Index = Y * NumX + X;
+			const FVector2D Center = Origin + FVector2D(X + 0.5f, Y + 0.5f) * CellSize;
+			float Height, Left, Right, Back, Front;
+			const bool bOnTerrain = Heightfield.GetHeight(Center.X, Center.Y, Height)
+				&& Heightfield.GetHeight(Center.X - HalfCell, Center.Y, Left) && Heightfield.GetHeight(Center.X + HalfCell, Center.Y, Right)
+				&& Heightfield.GetHeight(Center.X, Center.Y - HalfCell, Back) && Heightfield.GetHeight(Center.X, Center.Y + HalfCell, Front);
+
+			Heights[Index] = bOnTerrain ? Height : 0.f;
+			const float Gradient = bOnTerrain ? FMath::Max(FMath::Abs(Right - Left), FMath::Abs(Front - Back)) / CellSize : MAX_flt;
+			Costs[Index] = Gradient > MaxGradient ? Blocked : (uint8)(1 + FMath::RoundToInt(FMath::Square(Gradient / MaxGradient) * 15.f));
+		}
+	}
+
+	// A cluster is drivable when most of its cells are, and costs the mean of those
+	ClusterCosts.SetNumUninitialized(ClustersX * ClustersY);
+	for (int32 ClusterY = 0; ClusterY < ClustersY; ClusterY++)
+	{
+		for (int32 ClusterX = 0; ClusterX < ClustersX; ClusterX++)
+		{
+			int32 NumCells = 0;
+			int32 NumDrivable = 0;
+			int32 TotalCost = 0;
+			for (int32 Y = ClusterY * ClusterSize; Y < FMath::Min((ClusterY + 1) * ClusterSize, NumY); Y++)
+			{
+				for (int32 X = ClusterX * ClusterSize; X < FMath::Min((ClusterX + 1) * ClusterSize, NumX); X++)
+				{
+					const uint8 Cost = Costs[Y * NumX + X];
+					NumCells++;
+					NumDrivable += Cost != Blocked ? 1 : 0;
+					TotalCost += Cost;
+				}
+			}
+			ClusterCosts[ClusterY * ClustersX + ClusterX] = NumDrivable * 2 < NumCells ? Blocked : (uint8)FMath::Max(1, TotalCost / NumDrivable);
+		}
+	}
+}
+
+FIntPoint FConvoyNavGrid::GetCell(const FVector& Location) const
+{
+	const FVector2D Local = (FVector2D(Location) - Origin) / CellSize;
+	return FIntPoint(FMath::Clamp(FMath::FloorToInt(Local.X), 0, NumX - 1), FMath::Clamp(FMath::FloorToInt(Local.Y), 0, NumY - 1));
+}
+
+FVector FConvoyNavGrid::GetCellCenter(const FIntPoint& Cell) const
+{
+	const FVector2D Center = Origin + FVector2D(Cell.X + 0.5f, Cell.Y + 0.5f) * CellSize;
+	return FVector(Center, Heights[Cell.Y * NumX + Cell.X]);
+}
+
+bool FConvoyNavGrid::FindClusterPath(const FIntPoint& Start, const FIntPoint& Goal, TArray<FIntPoint>& OutClusters) const
+{
+	return ConvoyNavGrid::FindGridPath(ClustersX, ClustersY, [this](int32 X, int32 Y)
+	{
+		return ClusterCosts[Y * ClustersX + X];
+	}, GetCluster(Start), GetCluster(Goal), OutClusters);
+}
+
+bool FConvoyNavGrid::FindCellPath(const FIntPoint& Start, const FIntPoint& Goal, const TBitArray<>* Corridor, TArray<FIntPoint>& OutCells) const
+{
+	return ConvoyNavGrid::FindGridPath(NumX, NumY, [this, Corridor](int32 X, int32 Y)
+	{
+		if (Corridor && !(*Corridor)[(Y / ClusterSize) * ClustersX + X / ClusterSize])
+		{
+			return Blocked;
+		}
+		return Costs[Y * NumX + X];
+	}, Start, Goal, OutCells);
+}
+
+TBitArray<> FConvoyNavGrid::MakeCorridor(TArrayView<const FIntPoint> ClusterPath, int32 Radius) const
+{
+	TBitArray<> Corridor(false, ClustersX * ClustersY);
+	for (const FIntPoint& Cluster : ClusterPath)
+	{
+		for (int32 Y = FMath::Max(0, Cluster.Y - Radius); Y <= FMath::Min(ClustersY - 1, Cluster.Y + Radius); Y++)
+		{
+			for (int32 X = FMath::Max(0, Cluster.X - Radius); X <= FMath::Min(ClustersX - 1, Cluster.X + Radius); X++)
+			{
+				Corridor[Y * ClustersX + X] = true;
+			}
+		}
+	}
+	return Corridor;
+}
+
+bool FConvoyNavGrid::IsLineDrivable(const FIntPoint& A, const FIntPoint& B) const
+{
+	const int32 NumSteps = FMath::Max(FMath::Abs(B.X - A.X), FMath::Abs(B.Y - A.Y));
+	for (int32 Step = 0; Step <= NumSteps; Step++)
+	{
+		const float Alpha = NumSteps > 0 ? float(Step) / NumSteps : 0.f;
+		const int32 X = FMath::RoundToInt(FMath::Lerp(float(A.X), float(B.X), Alpha));
+		const int32 Y = FMath::RoundToInt(FMath::Lerp(float(A.Y), float(B.Y), Alpha));
+		if (Costs[Y * NumX + X] == Blocked)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FConvoyNavGrid::SimplifyPath(TArray<FIntPoint>& InOutCells) const
+{
+	if (InOutCells.Num() < 3)
+	{
+		return;
+	}
+
+	// Keep a cell only where the straight line from the last kept cell stops being drivable
+	TArray<FIntPoint> Simplified;
+	Simplified.Add(InOutCells[0]);
+	for (int32 Index = 2; Index < InOutCells.Num(); Index++)
+	{
+		if (!IsLineDrivable(Simplified.Last(), InOutCells[Index]))
+		{
+			Simplified.Add(InOutCells[Index - 1]);
+		}
+	}
+	Simplified.Add(InOutCells.Last());
+	InOutCells = MoveTemp(Simplified);
+}
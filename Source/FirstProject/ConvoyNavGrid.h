@@ -0,0 +1,83 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FTerrainHeightfield;
+
+/**
+ * Two level drivability grid for ground convoys, derived from terrain slope.
+ * Fine cells carry a traversal cost that rises with slope and are blocked beyond the steepest drivable slope.
+ * Square clusters of fine cells form the coarse level: routes are found across clusters first, then refined
+ * over fine cells inside the corridor of clusters the coarse route crosses.
+ * A built grid is immutable, so path searches may run on any thread.
+ */
+class FConvoyNavGrid
+{
+public:
+	/** Cost of a blocked cell */
+	static const uint8 Blocked = 0;
+
+	FConvoyNavGrid();
+
+	/**
+	 * Builds the grid over the whole heightfield.
+	 * @param CellSize			Edge of a fine cell, in cm
+	 * @param MaxSlopeDegrees	Steepest slope a vehicle can drive up
+	 * @param InClusterSize		Fine cells along each edge of a cluster
+	 */
+	void Build(const FTerrainHeightfield& Heightfield, float CellSize, float MaxSlopeDegrees, int32 InClusterSize);
+
+	FORCEINLINE bool IsValid() const { return NumX > 0 && NumY > 0; }
+
+	/** Returns the fine cell containing Location, clamped to the grid */
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/** Returns whether a vehicle can drive on fine cell Cell */
+	FORCEINLINE bool IsCellDrivable(const FIntPoint& Cell) const { return Costs[Cell.Y * NumX + Cell.X] != Blocked; }
+
+	/** Returns the centre of fine cell Cell */
+	FVector GetCellCenter(const FIntPoint& Cell) const;
+
+	/** Returns the cluster holding fine cell Cell */
+	FORCEINLINE FIntPoint GetCluster(const FIntPoint& Cell) const { return FIntPoint(Cell.X / ClusterSize, Cell.Y / ClusterSize); }
+
+	/** Finds a route between the clusters holding Start and Goal */
+	bool FindClusterPath(const FIntPoint& Start, const FIntPoint& Goal, TArray<FIntPoint>& OutClusters) const;
+
+	/**
+	 * Finds a route of fine cells from Start to Goal.
+	 * @param Corridor	Clusters the route may cross, one bit per cluster, or null to search the whole grid
+	 */
+	bool FindCellPath(const FIntPoint& Start, const FIntPoint& Goal, const TBitArray<>* Corridor, TArray<FIntPoint>& OutCells) const;
+
+	/** Marks the clusters of ClusterPath and their neighbours within Radius clusters */
+	TBitArray<> MakeCorridor(TArrayView<const FIntPoint> ClusterPath, int32 Radius) const;
+
+	/** Drops cells of a fine route that can be skipped by driving straight over drivable cells */
+	void SimplifyPath(TArray<FIntPoint>& InOutCells) const;
+
+	FORCEINLINE int32 GetNumClustersX() const { return ClustersX; }
+	FORCEINLINE int32 GetNumClustersY() const { return ClustersY; }
+
+private:
+	/** Returns whether every fine cell on the straight line from A to B is drivable */
+	bool IsLineDrivable(const FIntPoint& A, const FIntPoint& B) const;
+
+	FVector2D Origin;
+	float CellSize;
+	int32 NumX;
+	int32 NumY;
+	int32 ClusterSize;
+	int32 ClustersX;
+	int32 ClustersY;
+
+	/** Cost of each fine cell, Blocked or 1 for flat ground up to 16 at the steepest drivable slope */
+	TArray<uint8> Costs;
+
+	/** Mean cost of the drivable cells of each cluster, Blocked when most of it cannot be driven */
+	TArray<uint8> ClusterCosts;
+
+	/** Height of each fine cell centre, for the waypoints handed to vehicles */
+	TArray<float> Heights;
+};
@@ -0,0 +1,268 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "ConvoySubsystem.h"
+#include "FirstProject.h"
+#include "BTR.h"
+#include "TerrainHeightfieldSubsystem.h"
+#include "Engine/World.h"
+#include "Async/Async.h"
+
+namespace Convoy
+{
+	/** Packs a start and goal cell into one cache key, grids are far smaller than 65536 cells a side */
+	static FORCEINLINE uint64 PathKey(const FIntPoint& Start, const FIntPoint& Goal)
+	{
+		return (uint64(uint16(Start.X)) << 48) | (uint64(uint16(Start.Y)) << 32) | (uint64(uint16(Goal.X)) << 16) | uint64(uint16(Goal.Y));
+	}
+}
+
+UConvoySubsystem::UConvoySubsystem()
+{
+	CellSize = 2000.f;
+	ClusterSize = 16;
+	MaxSlope = 25.f;
+	CorridorRadius = 1;
+	FollowerSpacing = 2500.f;
+	FollowerStagger = 400.f;
+	WaypointSpacing = 1000.f;
+	MaxCachedPaths = 64;
+}
+
+void UConvoySubsystem::Deinitialize()
+{
+	// Workers hold their own reference to the grid, so pending refinements can simply be abandoned
+	PendingConvoys.Empty();
+	PathCache.Empty();
+	PathCacheOrder.Empty();
+	NavGrid.Reset();
+	NavGridHeightfield.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UConvoySubsystem::IsTickable() const
+{
+	return PendingConvoys.Num() > 0;
+}
+
+ETickableTickType UConvoySubsystem::GetTickableTickType() const
+{
+	// The class default object never plans anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UConvoySubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UConvoySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UConvoySubsystem, STATGROUP_Tickables);
+}
+
+TSharedPtr<const FConvoyNavGrid, ESPMode::ThreadSafe> UConvoySubsystem::GetNavGrid()
+{
+	// Streaming landscape in or out bakes a new heightfield, and the grid and routes follow it
+	UTerrainHeightfieldSubsystem* Terrain = GetWorld()->GetSubsystem<UTerrainHeightfieldSubsystem>();
+	const FTerrainHeightfieldPtr Heightfield = Terrain ? Terrain->GetHeightfield() : FTerrainHeightfieldPtr();
+	if (Heightfield.IsValid() && Heightfield != NavGridHeightfield)
+	{
+		Invalidate();
+		TSharedRef<FConvoyNavGrid, ESPMode::ThreadSafe> NewGrid = MakeShared<FConvoyNavGrid, ESPMode::ThreadSafe>();
+		NewGrid->Build(*Heightfield, CellSize, MaxSlope, FMath::Max(1, ClusterSize));
+		NavGrid = NewGrid;
+		NavGridHeightfield = Heightfield;
+	}
+	return NavGrid;
+}
+
+void UConvoySubsystem::Invalidate()
+{
+	PathCache.Empty();
+	PathCacheOrder.Empty();
+	NavGrid.Reset();
+	NavGridHeightfield.Reset();
+}
+
+bool UConvoySubsystem::MoveConvoy(const TArray<ABTR*>& Vehicles, FVector Goal)
+{
+	// Staggered column: each follower a fixed distance further back, alternating sides
+	TArray<FVector2D> Offsets;
+	Offsets.Reserve(Vehicles.Num());
+	for (int32 Index = 0; Index < Vehicles.Num(); Index++)
+	{
+		const float Side = Index == 0 ? 0.f : (Index % 2 == 1 ? 1.f : -1.f);
+		Offsets.Add(FVector2D(Index * FollowerSpacing, Side * FollowerStagger));
+	}
+	return MoveConvoyInFormation(Vehicles, Offsets, Goal);
+}
+
+bool UConvoySubsystem::MoveConvoyInFormation(TArrayView<ABTR* const> Vehicles, TArrayView<const FVector2D> Offsets, const FVector& Goal)
+{
+	if (Vehicles.Num() == 0 || Vehicles[0] == nullptr)
+	{
+		return false;
+	}
+
+	const TSharedPtr<const FConvoyNavGrid, ESPMode::ThreadSafe> Grid = GetNavGrid();
+	if (!Grid.IsValid() || !Grid->IsValid())
+	{
+		return false;
+	}
+
+	const FIntPoint StartCell = Grid->GetCell(Vehicles[0]->GetActorLocation());
+	const FIntPoint GoalCell = Grid->GetCell(Goal);
+	if (!Grid->IsCellDrivable(StartCell) || !Grid->IsCellDrivable(GoalCell))
+	{
+		return false;
+	}
+	const uint64 PathKey = Convoy::PathKey(StartCell, GoalCell);
+
+	TArray<TWeakObjectPtr<ABTR>> ConvoyVehicles;
+	for (ABTR* Vehicle : Vehicles)
+	{
+		ConvoyVehicles.Add(Vehicle);
+	}
+
+	if (const FConvoyPathPtr* CachedPath = PathCache.Find(PathKey))
+	{
+		DispatchConvoy(ConvoyVehicles, Offsets, **CachedPath);
+		return true;
+	}
+
+	// The coarse route is cheap enough for the game thread, and narrows the fine search to a corridor
+	TArray<FIntPoint> ClusterPath;
+	TBitArray<> Corridor;
+	if (Grid->FindClusterPath(StartCell, GoalCell, ClusterPath))
+	{
+		Corridor = Grid->MakeCorridor(ClusterPath, FMath::Max(0, CorridorRadius));
+	}
+
+	FPendingConvoy& Pending = PendingConvoys.AddDefaulted_GetRef();
+	Pending.Vehicles = MoveTemp(ConvoyVehicles);
+	Pending.Offsets = TArray<FVector2D>(Offsets.GetData(), Offsets.Num());
+	Pending.PathKey = PathKey;
+	Pending.Path = Async(EAsyncExecution::ThreadPool, [Grid, Corridor = MoveTemp(Corridor), StartCell, GoalCell]() -> FConvoyPathPtr
+	{
+		// Clusters that are only partly drivable can pinch the corridor shut, search the whole grid then
+		TArray<FIntPoint> Cells;
+		const TBitArray<>* FineCorridor = Corridor.Num() > 0 ? &Corridor : nullptr;
+		if (!Grid->FindCellPath(StartCell, GoalCell, FineCorridor, Cells) && (FineCorridor == nullptr || !Grid->FindCellPath(StartCell, GoalCell, nullptr, Cells)))
+		{
+			return FConvoyPathPtr();
+		}
+
+		Grid->SimplifyPath(Cells);
+		TSharedRef<TArray<FVector>, ESPMode::ThreadSafe> Path = MakeShared<TArray<FVector>, ESPMode::ThreadSafe>();
+		for (const FIntPoint& Cell : Cells)
+		{
+			Path->Add(Grid->GetCellCenter(Cell));
+		}
+		return Path;
+	});
+	return true;
+}
+
+void UConvoySubsystem::DispatchConvoy(TArrayView<const TWeakObjectPtr<ABTR>> Vehicles, TArrayView<const FVector2D> Offsets, const TArray<FVector>& Path) const
+{
+	if (Path.Num() == 0)
+	{
+		return;
+	}
+
+	// Distance along the leader's route at each of its points
+	TArray<float> Distances;
+	Distances.Add(0.f);
+	for (int32 Index = 1; Index < Path.Num(); Index++)
+	{
+		Distances.Add(Distances.Last() + FVector::Dist2D(Path[Index - 1], Path[Index]));
+	}
+	const float TotalDistance = Distances.Last();
+	const float Spacing = FMath::Max(100.f, WaypointSpacing);
+
+	TArray<FVector> Waypoints;
+	for (int32 VehicleIndex = 0; VehicleIndex < Vehicles.Num(); VehicleIndex++)
+	{
+		ABTR* Vehicle = Vehicles[VehicleIndex].Get();
+		if (Vehicle == nullptr)
+		{
+			continue;
+		}
+
+		// A follower drives the leader's route shifted to its side, and stops short by its distance behind
+		const FVector2D Offset = Offsets.IsValidIndex(VehicleIndex) ? Offsets[VehicleIndex] : FVector2D::ZeroVector;
+		const float EndDistance = FMath::Max(0.f, TotalDistance - Offset.X);
+		Waypoints.Reset();
+		int32 Segment = 0;
+		for (float Distance = 0.f; ; Distance += Spacing)
+		{
+			const float ClampedDistance = FMath::Min(Distance, EndDistance);
+			if (Path.Num() < 2)
+			{
+				Waypoints.Add(Path[0]);
+				break;
+			}
+
+			while (Segment < Path.Num() - 2 && Distances[Segment + 1] < ClampedDistance)
+			{
+				Segment++;
+			}
+			const FVector& SegmentStart = Path[Segment];
+			const FVector& SegmentEnd = Path[Segment + 1];
+			const float SegmentLength = Distances[Segment + 1] - Distances[Segment];
+			const float Alpha = SegmentLength > 0.f ? (ClampedDistance - Distances[Segment]) / SegmentLength : 0.f;
+			const FVector2D Direction = FVector2D(SegmentEnd - SegmentStart).GetSafeNormal();
+			const FVector2D Right(-Direction.Y, Direction.X);
+			Waypoints.Add(FMath::Lerp(SegmentStart, SegmentEnd, Alpha) + FVector(Right * Offset.Y, 0.f));
+
+			if (ClampedDistance >= EndDistance)
+			{
+				break;
+			}
+		}
+
+		Vehicle->DriveAlong(Waypoints);
+	}
+}
+
+void UConvoySubsystem::CachePath(uint64 PathKey, const FConvoyPathPtr& Path)
+{
+	if (PathCache.Contains(PathKey))
+	{
+		return;
+	}
+
+	PathCache.Add(PathKey, Path);
+	PathCacheOrder.Add(PathKey);
+	while (PathCacheOrder.Num() > FMath::Max(1, MaxCachedPaths))
+	{
+		PathCache.Remove(PathCacheOrder[0]);
+		PathCacheOrder.RemoveAt(0, 1, false);
+	}
+}
+
+void UConvoySubsystem::Tick(float DeltaTime)
+{
+	for (int32 Index = PendingConvoys.Num() - 1; Index >= 0; Index--)
+	{
+		FPendingConvoy& Pending = PendingConvoys[Index];
+		if (!Pending.Path.IsReady())
+		{
+			continue;
+		}
+
+		const FConvoyPathPtr Path = Pending.Path.Get();
+		if (Path.IsValid())
+		{
+			CachePath(Pending.PathKey, Path);
+			DispatchConvoy(Pending.Vehicles, Pending.Offsets, *Path);
+		}
+		else
+		{
+			const ABTR* Leader = Pending.Vehicles[0].Get();
+			UE_LOG(LogFlying, Warning, TEXT("No route for the convoy of %d led by %s, it stays put"), Pending.Vehicles.Num(), Leader ? *Leader->GetName() : TEXT("a destroyed vehicle"));
+		}
+		PendingConvoys.RemoveAtSwap(Index, 1, false);
+	}
+}
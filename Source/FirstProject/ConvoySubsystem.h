@@ -0,0 +1,132 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "ConvoyNavGrid.h"
+#include "ConvoySubsystem.generated.h"
+
+class ABTR;
+
+typedef TSharedPtr<const TArray<FVector>, ESPMode::ThreadSafe> FConvoyPathPtr;
+
+/** A convoy waiting for its route to be refined off the game thread */
+struct FPendingConvoy
+{
+	/** Leader first, then followers in formation order */
+	TArray<TWeakObjectPtr<ABTR>> Vehicles;
+
+	/** Each vehicle's place in the formation: X behind the leader along its route, Y to its right, in cm */
+	TArray<FVector2D> Offsets;
+
+	/** Cache key of the route */
+	uint64 PathKey;
+
+	/** Refined route, ready once the worker finishes */
+	TFuture<FConvoyPathPtr> Path;
+};
+
+/**
+ * Plans routes for BTR convoys across the terrain.
+ * One route is planned per convoy: across the coarse clusters of an FConvoyNavGrid on the game thread, then
+ * refined over fine cells on a worker thread. Refined routes are cached by start and goal cell, so convoys
+ * sent between the same places reuse them. Followers are sent along the leader's route shifted by their
+ * formation offset, so the convoy keeps its shape through turns.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UConvoySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UConvoySubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/**
+	 * Sends a convoy to Goal in a staggered column behind Vehicles[0].
+	 * @return False when the convoy cannot start or reach Goal on drivable ground. True once the route is
+	 *			cached or being refined, the vehicles may start moving a few frames later, and stay put if the
+	 *			refinement finds no route after all
+	 */
+	UFUNCTION(BlueprintCallable, Category = Convoy)
+	bool MoveConvoy(const TArray<ABTR*>& Vehicles, FVector Goal);
+
+	/**
+	 * Sends a convoy to Goal with an explicit formation.
+	 * @param Offsets	Per vehicle, distance behind the leader along its route in X and to its right in Y, in cm
+	 * @return Same as MoveConvoy
+	 */
+	bool MoveConvoyInFormation(TArrayView<ABTR* const> Vehicles, TArrayView<const FVector2D> Offsets, const FVector& Goal);
+
+	/** Drops the cached routes and the grid, e.g. after the terrain was baked again */
+	void Invalidate();
+
+private:
+	/** Returns the drivability grid, building it from the terrain heightfield on first use and after every rebake */
+	TSharedPtr<const FConvoyNavGrid, ESPMode::ThreadSafe> GetNavGrid();
+
+	/** Sends every vehicle of a convoy along its offset copy of Path */
+	void DispatchConvoy(TArrayView<const TWeakObjectPtr<ABTR>> Vehicles, TArrayView<const FVector2D> Offsets, const TArray<FVector>& Path) const;
+
+	/** Adds a refined route to the cache, evicting the oldest one when full */
+	void CachePath(uint64 PathKey, const FConvoyPathPtr& Path);
+
+	/** Edge of a fine grid cell, in cm */
+	UPROPERTY(Config)
+	float CellSize;
+
+	/** Fine cells along each edge of a coarse cluster */
+	UPROPERTY(Config)
+	int32 ClusterSize;
+
+	/** Steepest slope a BTR can climb, in degrees */
+	UPROPERTY(Config)
+	float MaxSlope;
+
+	/** Clusters either side of the coarse route the refined route may use */
+	UPROPERTY(Config)
+	int32 CorridorRadius;
+
+	/** Distance between followers in the default formation, in cm */
+	UPROPERTY(Config)
+	float FollowerSpacing;
+
+	/** Sideways offset of every other follower in the default formation, in cm */
+	UPROPERTY(Config)
+	float FollowerStagger;
+
+	/** Distance between waypoints handed to vehicles, in cm */
+	UPROPERTY(Config)
+	float WaypointSpacing;
+
+	/** Most routes kept in the cache */
+	UPROPERTY(Config)
+	int32 MaxCachedPaths;
+
+	TSharedPtr<const FConvoyNavGrid, ESPMode::ThreadSafe> NavGrid;
+
+	/** Heightfield the grid was built from */
+	TSharedPtr<const FTerrainHeightfield, ESPMode::ThreadSafe> NavGridHeightfield;
+
+	/** Refined routes by start and goal cell */
+	TMap<uint64, FConvoyPathPtr> PathCache;
+
+	/** Cache keys, oldest first */
+	TArray<uint64> PathCacheOrder;
+
+	/** Convoys whose route is being refined */
+	TArray<FPendingConvoy> PendingConvoys;
+};
@@ -6,3 +6,22 @@
 IMPLEMENT_PRIMARY_GAME_MODULE(FDefaultGameModuleImpl, FirstProject, "FirstProject");
 
 DEFINE_LOG_CATEGORY(LogFlying)
+
+DEFINE_STAT(STAT_ACRL_PawnTick);
+DEFINE_STAT(STAT_ACRL_FlightSweep);
+DEFINE_STAT(STAT_ACRL_TurbineAudio);
+DEFINE_STAT(STAT_ACRL_MGunFire);
+DEFINE_STAT(STAT_ACRL_RoundArcSweep);
+DEFINE_STAT(STAT_ACRL_BulletManagerTick);
+DEFINE_STAT(STAT_ACRL_RoundHit);
+DEFINE_STAT(STAT_ACRL_PredictiveStreaming);
+DEFINE_STAT(STAT_ACRL_LiveRounds);
+DEFINE_STAT(STAT_ACRL_StreamingCellsLoaded);
+DEFINE_STAT(STAT_ACRL_RoundsSpawned);
+DEFINE_STAT(STAT_ACRL_RoundHits);
+DEFINE_STAT(STAT_ACRL_Sweeps);
+DEFINE_STAT(STAT_ACRL_StreamingLoads);
+DEFINE_STAT(STAT_ACRL_StreamingUnloads);
+DEFINE_STAT(STAT_ACRL_StreamingMisses);
+
+CSV_DEFINE_CATEGORY(ACRL, true);
@@ -3,5 +3,75 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "HAL/PlatformTime.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogFlying, Log, All);
+
+/** Game hot paths, shown by stat ACRL */
+DECLARE_STATS_GROUP(TEXT("ACRL"), STATGROUP_ACRL, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pawn Tick"), STAT_ACRL_PawnTick, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Flight Sweep"), STAT_ACRL_FlightSweep, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Turbine Audio"), STAT_ACRL_TurbineAudio, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MGun Fire"), STAT_ACRL_MGunFire, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Round Arc Sweep"), STAT_ACRL_RoundArcSweep, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bullet Manager Tick"), STAT_ACRL_BulletManagerTick, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Round Hit"), STAT_ACRL_RoundHit, STATGROUP_ACRL, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Predictive Streaming"), STAT_ACRL_PredictiveStreaming, STATGROUP_ACRL, );
+
+/** Rounds in flight in the bullet manager */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Rounds"), STAT_ACRL_LiveRounds, STATGROUP_ACRL, );
+
+/** Streaming cells loaded ahead of the aircraft */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Streaming Cells Loaded"), STAT_ACRL_StreamingCellsLoaded, STATGROUP_ACRL, );
+
+/** Per frame counters */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rounds Spawned"), STAT_ACRL_RoundsSpawned, STATGROUP_ACRL, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Round Hits"), STAT_ACRL_RoundHits, STATGROUP_ACRL, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sweeps"), STAT_ACRL_Sweeps, STATGROUP_ACRL, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Streaming Loads"), STAT_ACRL_StreamingLoads, STATGROUP_ACRL, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Streaming Unloads"), STAT_ACRL_StreamingUnloads, STATGROUP_ACRL, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Streaming Misses"), STAT_ACRL_StreamingMisses, STATGROUP_ACRL, );
+
+CSV_DECLARE_CATEGORY_EXTERN(ACRL);
+
+/** Times the enclosing scope as STAT_ACRL_<Stat>, as <Stat> in CSV captures and as ACRL_<Stat> in traces */
+#define ACRL_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(STAT_ACRL_##Stat); \
+	CSV_SCOPED_TIMING_STAT(ACRL, Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACRL_##Stat)
+
+/**
+ * Logs at Verbose how long the constructor it is declared in took, when that built the default object of Class.
+ * Objects of other classes are skipped, so subclass and Blueprint defaults are not reported again.
+ */
+class FScopedDefaultObjectTimer
+{
+public:
+	FScopedDefaultObjectTimer(const UObject* InObject, const UClass* Class)
+		: Object(InObject->HasAnyFlags(RF_ClassDefaultObject) && InObject->GetClass() == Class ? InObject : nullptr)
+		, StartTime(FPlatformTime::Seconds())
+	{
+	}
+
+	~FScopedDefaultObjectTimer()
+	{
+		if (Object)
+		{
+			UE_LOG(LogFlying, Verbose, TEXT("%s default object constructed in %.2f ms"), *Object->GetClass()->GetName(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+	}
+
+private:
+	const UObject* Object;
+	double StartTime;
+};
+
+/** Adds Amount to the per frame counter STAT_ACRL_<Stat>, and to <Stat> in CSV captures */
+#define ACRL_INC_COUNTER(Stat, Amount) \
+	INC_DWORD_STAT_BY(STAT_ACRL_##Stat, Amount); \
+	CSV_CUSTOM_STAT(ACRL, Stat, (int32)(Amount), ECsvCustomStatOp::Accumulate)
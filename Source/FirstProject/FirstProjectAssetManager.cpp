@@ -0,0 +1,29 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "FirstProjectAssetManager.h"
+#include "FirstProject.h"
+#include "FirstProjectPawn.h"
+#include "MGunBullet.h"
+
+#if WITH_EDITOR
+void UFirstProjectAssetManager::ModifyCook(TArray<FName>& PackagesToCook, TArray<FName>& PackagesToNeverCook)
+{
+	Super::ModifyCook(PackagesToCook, PackagesToNeverCook);
+
+	TArray<FSoftObjectPath> Assets;
+	GetDefault<AFirstProjectPawn>()->GetStreamedAssets(Assets);
+	GetDefault<AMGunBullet>()->GetStreamedAssets(Assets);
+
+	int32 NumAdded = 0;
+	for (const FSoftObjectPath& Asset : Assets)
+	{
+		if (!Asset.IsNull())
+		{
+			const int32 NumBefore = PackagesToCook.Num();
+			PackagesToCook.AddUnique(FName(*Asset.GetLongPackageName()));
+			NumAdded += PackagesToCook.Num() - NumBefore;
+		}
+	}
+	UE_LOG(LogFlying, Display, TEXT("Added %d softly referenced packages of native defaults to the cook"), NumAdded);
+}
+#endif
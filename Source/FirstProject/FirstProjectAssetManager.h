@@ -0,0 +1,24 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetManager.h"
+#include "FirstProjectAssetManager.generated.h"
+
+/**
+ * Asset manager of the game, set as AssetManagerClassName in DefaultEngine.ini.
+ * The pawn and its rounds only reference their meshes and sounds softly from native defaults, which no cooked
+ * package points at, so the cook is told about them here from the same list the game mode preloads.
+ */
+UCLASS()
+class FIRSTPROJECT_API UFirstProjectAssetManager : public UAssetManager
+{
+	GENERATED_BODY()
+
+public:
+#if WITH_EDITOR
+	// Begin UAssetManager overrides
+	virtual void ModifyCook(TArray<FName>& PackagesToCook, TArray<FName>& PackagesToNeverCook) override;
+	// End UAssetManager overrides
+#endif
+};
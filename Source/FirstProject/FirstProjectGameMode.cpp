@@ -1,10 +1,110 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "FirstProjectGameMode.h"
+#include "FirstProject.h"
 #include "FirstProjectPawn.h"
+#include "MGunBullet.h"
+#include "AssetStreamingSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "TimerManager.h"
+#include "CoreGlobals.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/CoreDelegates.h"
+
+bool AFirstProjectGameMode::bFirstFrameReported = false;
 
 AFirstProjectGameMode::AFirstProjectGameMode()
 {
 	// set default pawn class to our flying pawn
 	DefaultPawnClass = AFirstProjectPawn::StaticClass();
+
+	PreloadTimeout = 10.f;
+	bPreloading = false;
+	PreloadStartTime = 0.0;
+}
+
+void AFirstProjectGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	UAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UAssetStreamingSubsystem>();
+	if (Streaming == nullptr)
+	{
+		return;
+	}
+
+	// Start streaming what the first pawn and its rounds need while the level finishes loading
+	TArray<FSoftObjectPath> Assets;
+	if (DefaultPawnClass && DefaultPawnClass->IsChildOf(AFirstProjectPawn::StaticClass()))
+	{
+		DefaultPawnClass->GetDefaultObject<AFirstProjectPawn>()->GetStreamedAssets(Assets);
+	}
+	GetDefault<AMGunBullet>()->GetStreamedAssets(Assets);
+
+	bPreloading = true;
+	PreloadStartTime = FPlatformTime::Seconds();
+	Streaming->OnPreloadComplete.AddUObject(this, &AFirstProjectGameMode::EndPreload);
+	Streaming->Preload(Assets);
+
+	// Everything may already be in memory, in which case the preload has ended already
+	if (bPreloading && PreloadTimeout > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(PreloadTimeoutHandle, this, &AFirstProjectGameMode::EndPreload, PreloadTimeout);
+	}
+}
+
+void AFirstProjectGameMode::HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer)
+{
+	if (bPreloading)
+	{
+		PendingPlayers.AddUnique(NewPlayer);
+		return;
+	}
+
+	Super::HandleStartingNewPlayer_Implementation(NewPlayer);
+
+	if (!bFirstFrameReported && !FirstFrameHandle.IsValid())
+	{
+		FirstFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &AFirstProjectGameMode::ReportFirstFrame);
+	}
+}
+
+void AFirstProjectGameMode::EndPreload()
+{
+	if (!bPreloading)
+	{
+		return;
+	}
+	bPreloading = false;
+	GetWorldTimerManager().ClearTimer(PreloadTimeoutHandle);
+
+	UAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UAssetStreamingSubsystem>();
+	if (Streaming && Streaming->IsPreloading())
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Preload still running after %.0f s, starting play with placeholders"), PreloadTimeout);
+	}
+	else
+	{
+		UE_LOG(LogFlying, Log, TEXT("Players held back %.2f s by the preload"), FPlatformTime::Seconds() - PreloadStartTime);
+	}
+
+	for (APlayerController* Player : PendingPlayers)
+	{
+		if (Player && !Player->IsPendingKill())
+		{
+			HandleStartingNewPlayer(Player);
+		}
+	}
+	PendingPlayers.Empty();
+}
+
+void AFirstProjectGameMode::ReportFirstFrame()
+{
+	FCoreDelegates::OnEndFrame.Remove(FirstFrameHandle);
+	FirstFrameHandle.Reset();
+	bFirstFrameReported = true;
+
+	// From process start, so module loading, default objects, the map and the preload are all included
+	UE_LOG(LogFlying, Log, TEXT("First frame with a player finished %.2f s after launch"), FPlatformTime::Seconds() - GStartTime);
 }
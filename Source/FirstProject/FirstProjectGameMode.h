@@ -6,14 +6,44 @@
 #include "GameFramework/GameModeBase.h"
 #include "FirstProjectGameMode.generated.h"
 
-UCLASS(MinimalAPI)
+UCLASS(MinimalAPI, Config=Game)
 class AFirstProjectGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
 public:
 	AFirstProjectGameMode();
-};
 
+	// Begin AGameModeBase overrides
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer) override;
+	// End AGameModeBase overrides
+
+	/** Longest players are held back while the default pawn's assets preload, in seconds; late assets then pop in */
+	UPROPERTY(Config, EditDefaultsOnly, Category = Loading)
+	float PreloadTimeout;
+
+private:
+	/** Spawns the players held back by the preload */
+	void EndPreload();
+
+	/** Bound to the end of the frame the first player started in, logs how long after launch that was */
+	void ReportFirstFrame();
+
+	/** Whether players are being held back */
+	bool bPreloading;
 
+	/** Players waiting for the preload to end */
+	UPROPERTY()
+	TArray<APlayerController*> PendingPlayers;
 
+	FTimerHandle PreloadTimeoutHandle;
+
+	/** Platform time the preload started */
+	double PreloadStartTime;
+
+	FDelegateHandle FirstFrameHandle;
+
+	/** Whether the first frame with a player has been timed, once per process */
+	static bool bFirstFrameReported;
+};
@@ -1,10 +1,17 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "FirstProjectPawn.h"
+#include "FirstProject.h"
 #include "MGunBullet.h"
-#include "UObject/ConstructorHelpers.h"
+#include "MGunBulletManager.h"
+#include "ActorPoolSubsystem.h"
+#include "AircraftSwarmSubsystem.h"
+#include "TargetIndexSubsystem.h"
+#include "AssetStreamingSubsystem.h"
+#include "GunsightSubsystem.h"
 #include "Camera/CameraComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "Components/BoxComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Components/InputComponent.h"
 #include "GameFramework/SpringArmComponent.h"
@@ -14,27 +21,69 @@
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundBase.h"
 #include "Components/AudioComponent.h"
+#include "Components/DecalComponent.h"
+#include "Particles/ParticleSystem.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "Misc/Paths.h"
+#include "Misc/Parse.h"
+#include "Misc/CommandLine.h"
+#include "HAL/IConsoleManager.h"
 
-AFirstProjectPawn::AFirstProjectPawn()
-{
-	// Structure to hold one-time initialization
-	struct FConstructorStatics
+static FAutoConsoleCommand ExportFlightDataCommand(
+	TEXT("acrl.FlightRecorder.ExportCsv"),
+	TEXT("Writes a flight data file from Saved/FlightData as a .csv next to it. Usage: acrl.FlightRecorder.ExportCsv <file>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
 	{
-		ConstructorHelpers::FObjectFinderOptional<USkeletalMesh> PlaneMesh;
-		FConstructorStatics()
-			: PlaneMesh(TEXT("/Game/Models/F22_Rigged/F22_Rigged_Scaled.F22_Rigged_Scaled"))
+		if (Args.Num() < 1)
 		{
+			UE_LOG(LogFlying, Warning, TEXT("Usage: acrl.FlightRecorder.ExportCsv <file>"));
+			return;
 		}
-	};
-	static FConstructorStatics ConstructorStatics;
 
-	
+		FString Filename = Args[0];
+		if (FPaths::IsRelative(Filename))
+		{
+			Filename = FPaths::ProjectSavedDir() / TEXT("FlightData") / Filename;
+		}
+		const FString CsvFilename = FPaths::ChangeExtension(Filename, TEXT("csv"));
+		if (FFlightRecordReader::ExportCsv(Filename, CsvFilename))
+		{
+			UE_LOG(LogFlying, Log, TEXT("Exported %s"), *CsvFilename);
+		}
+		else
+		{
+			UE_LOG(LogFlying, Warning, TEXT("Cannot export %s, it is missing or not a flight data file"), *Filename);
+		}
+	}));
+
+AFirstProjectPawn::AFirstProjectPawn()
+{
+	const FScopedDefaultObjectTimer ConstructTimer(this, AFirstProjectPawn::StaticClass());
+
+	// Assets are only referenced softly, they stream in after the pawn is created rather than with the class
+	PlaneMeshAsset = TSoftObjectPtr<USkeletalMesh>(FSoftObjectPath(TEXT("/Game/Models/F22_Rigged/F22_Rigged_Scaled.F22_Rigged_Scaled")));
+	TracerMeshAsset = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/Effects/Sphere.Sphere")));
+	// No missile model yet, the tracer sphere stretched by the missile manager stands in for one
+	MissileMeshAsset = TracerMeshAsset;
+	MissileMotorSoundAsset = TSoftObjectPtr<USoundBase>(FSoftObjectPath(TEXT("/Game/Audio/Effects/JET_exhaust.JET_exhaust")));
+	MissileLaunchSoundAsset = TSoftObjectPtr<USoundBase>(FSoftObjectPath(TEXT("/Game/Audio/Effects/HUD_VOICE_MISSILE.HUD_VOICE_MISSILE")));
+	MissileExplosionAsset = TSoftObjectPtr<UParticleSystem>(FSoftObjectPath(TEXT("/Game/StarterContent/Particles/P_Explosion.P_Explosion")));
+	TurbineCueAsset = TSoftObjectPtr<USoundCue>(FSoftObjectPath(TEXT("/Game/Audio/Fighter_Turbine_Steady_02_Cue.Fighter_Turbine_Steady_02_Cue")));
+	FireCueAsset = TSoftObjectPtr<USoundCue>(FSoftObjectPath(TEXT("/Game/Audio/Effects/WPN_GUN_BRRT_Cue.WPN_GUN_BRRT_Cue")));
+	AmmoZeroCueAsset = TSoftObjectPtr<USoundCue>(FSoftObjectPath(TEXT("/Game/Audio/Effects/HUD_VOICE_AMMUNITION_ZERO_Cue.HUD_VOICE_AMMUNITION_ZERO_Cue")));
+
+	// Create the box that is swept when the pawn moves
+	CollisionProxy = CreateDefaultSubobject<UBoxComponent>(TEXT("CollisionProxy0"));
+	CollisionProxy->SetCollisionProfileName("Pawn");
+	FallbackCollisionProxyExtent = FVector(900.f, 650.f, 250.f);
+	CollisionProxy->SetBoxExtent(FallbackCollisionProxyExtent, false);
+	RootComponent = CollisionProxy;
 
 	// Create static mesh component
 	PlaneMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("PlaneMesh0"));
-	PlaneMesh->SetSkeletalMesh(ConstructorStatics.PlaneMesh.Get());	// Set static mesh
 	PlaneMesh->SetCollisionProfileName("Pawn");
-	RootComponent = PlaneMesh;
+	PlaneMesh->SetupAttachment(RootComponent);
 
 	// Create a spring arm component
 	SpringArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArm0"));
@@ -66,6 +115,23 @@ AFirstProjectPawn::AFirstProjectPawn()
 	MinSpeed = 7200.f;
 	CurrentForwardSpeed = 10000.f;
 	YawSpeed = 10.f;
+	FlightStepRate = 120.f;
+	MaxFlightSubsteps = 8;
+	bFlyInSwarmWhenAI = true;
+	ContactWindow = 0.25f;
+	ContactDamage = 10.f;
+	ContactDamageSpeed = 5000.f;
+	ContactDeflection = 0.025f;
+	bRecordFlightData = false;
+	AIFireHitProbability = 0.3f;
+	bScriptedMGunFiring = false;
+	InputReplayMode = EInputReplayMode::None;
+	bInputReplayChecked = false;
+	bApplyingInputReplay = false;
+	InputReplayStep = 0;
+	PendingInputActions = 0;
+	bUseCollisionProxy = true;
+	CollisionProxyExtent = FVector::ZeroVector;
 	CurrentHealth = 100.f;
 	CurrentCameraRight = 0.f;
 	CurrentCameraUp = 0.f;
@@ -75,20 +141,33 @@ AFirstProjectPawn::AFirstProjectPawn()
 	GunOffset = FVector(70.f, 160.f, 45.f);
 	FireRate = 0.004f;
 	MGunCone = 0.2f;
-	bCanFire = true;
+	MGunSeed = 0;
 	MGunAmmo = 480;
 	firing = false;
+	MGunBurstEndIndex = INDEX_NONE;
+	MGunLastBurstId = 0;
+	MGunCatchUpRounds = 0;
+	bUseBulletManager = true;
+	TracerMesh = nullptr;
+	TracerEveryNthRound = 1;
+	MGunRoundsFired = 0;
+	MGunBulletPoolSize = 500;
+	ImpactDecalPoolSize = 64;
+	OneShotSoundPoolSize = 8;
+	MissileAmmo = 6;
+	MissileSeeker = EMissileSeeker::Infrared;
+	MissileOffset = FVector(0.f, 0.f, -120.f);
+	MissileMesh = nullptr;
+	MissileMotorSound = nullptr;
+	MissileLaunchSound = nullptr;
+	MissileExplosion = nullptr;
 
-	// Load our Sound Cue for the turbine sound we created in the editor... note your path may be different depending
-	// on where you store the asset on disk.
-	static ConstructorHelpers::FObjectFinder<USoundCue> turbineCue(TEXT("'/Game/Audio/Fighter_Turbine_Steady_02_Cue.Fighter_Turbine_Steady_02_Cue'"));
-	static ConstructorHelpers::FObjectFinder<USoundCue> fireCue(TEXT("'/Game/Audio/Effects/WPN_GUN_BRRT_Cue.WPN_GUN_BRRT_Cue'"));
-	static ConstructorHelpers::FObjectFinder<USoundCue> ammoZeroCue(TEXT("'/Game/Audio/Effects/HUD_VOICE_AMMUNITION_ZERO_Cue.HUD_VOICE_AMMUNITION_ZERO_Cue'"));
+	// The cues are filled in once they have streamed in
+	turbineAudioCue = nullptr;
+	fireAudioCue = nullptr;
+	ammoZeroAudioCue = nullptr;
+	turbineStartupCue = nullptr;
 
-	// Store a reference to the Cue asset - we'll need it later.
-	turbineAudioCue = turbineCue.Object;
-	fireAudioCue = fireCue.Object;
-	ammoZeroAudioCue = ammoZeroCue.Object;
 	// Create an audio component, the audio component wraps the Cue, and allows us to ineract with
 	// it, and its parameters from code.
 	turbineAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("TurbineAudioComp"));
@@ -105,17 +184,130 @@ AFirstProjectPawn::AFirstProjectPawn()
 void AFirstProjectPawn::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
-	if (turbineAudioCue->IsValidLowLevelFast()) {
-		turbineAudioComponent->SetSound(turbineAudioCue);
+
+	if (bUseCollisionProxy)
+	{
+		// The mesh is only drawn, so moving it costs no physics body or overlap updates
+		PlaneMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		PlaneMesh->SetGenerateOverlapEvents(false);
+		FitCollisionProxy();
+	}
+	else
+	{
+		// Sweep the skeletal mesh and its physics asset as the pawn always used to
+		CollisionProxy->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		PlaneMesh->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		SetRootComponent(PlaneMesh);
+		CollisionProxy->AttachToComponent(PlaneMesh, FAttachmentTransformRules::KeepWorldTransform);
+		SpringArm->AttachToComponent(PlaneMesh, FAttachmentTransformRules::KeepRelativeTransform);
+	}
+
+	// Whatever the preload already brought in is used right away, the rest arrives when it is loaded
+	ApplyStreamedAssets();
+	if (UAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UAssetStreamingSubsystem>())
+	{
+		TArray<FSoftObjectPath> Assets;
+		GetStreamedAssets(Assets);
+		StreamedAssetsHandle = Streaming->RequestAssets(Assets, FStreamableDelegate::CreateUObject(this, &AFirstProjectPawn::ApplyStreamedAssets));
 	}
-	if (fireAudioCue->IsValidLowLevelFast()) {
+}
+
+void AFirstProjectPawn::GetStreamedAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	OutAssets.Add(PlaneMeshAsset.ToSoftObjectPath());
+	OutAssets.Add(TracerMeshAsset.ToSoftObjectPath());
+	OutAssets.Add(MissileMeshAsset.ToSoftObjectPath());
+	OutAssets.Add(MissileMotorSoundAsset.ToSoftObjectPath());
+	OutAssets.Add(MissileLaunchSoundAsset.ToSoftObjectPath());
+	OutAssets.Add(MissileExplosionAsset.ToSoftObjectPath());
+	OutAssets.Add(TurbineCueAsset.ToSoftObjectPath());
+	OutAssets.Add(FireCueAsset.ToSoftObjectPath());
+	OutAssets.Add(AmmoZeroCueAsset.ToSoftObjectPath());
+}
+
+void AFirstProjectPawn::ApplyStreamedAssets()
+{
+	// References set on a subclass or instance win over the streamed defaults
+	if (PlaneMesh->SkeletalMesh == nullptr && PlaneMeshAsset.Get())
+	{
+		PlaneMesh->SetSkeletalMesh(PlaneMeshAsset.Get());
+		if (bUseCollisionProxy)
+		{
+			FitCollisionProxy();
+		}
+	}
+	if (TracerMesh == nullptr)
+	{
+		TracerMesh = TracerMeshAsset.Get();
+	}
+	if (MissileMesh == nullptr)
+	{
+		MissileMesh = MissileMeshAsset.Get();
+	}
+	if (MissileMotorSound == nullptr)
+	{
+		MissileMotorSound = MissileMotorSoundAsset.Get();
+	}
+	if (MissileLaunchSound == nullptr)
+	{
+		MissileLaunchSound = MissileLaunchSoundAsset.Get();
+	}
+	if (MissileExplosion == nullptr)
+	{
+		MissileExplosion = MissileExplosionAsset.Get();
+	}
+	if (ammoZeroAudioCue == nullptr)
+	{
+		ammoZeroAudioCue = AmmoZeroCueAsset.Get();
+	}
+	if (fireAudioCue == nullptr && FireCueAsset.Get())
+	{
+		fireAudioCue = FireCueAsset.Get();
 		fireAudioComponent->SetSound(fireAudioCue);
+		if (firing)
+		{
+			// The trigger went down before the cue arrived
+			fireAudioComponent->Play();
+		}
+	}
+	if (turbineAudioCue == nullptr && TurbineCueAsset.Get())
+	{
+		turbineAudioCue = TurbineCueAsset.Get();
+		turbineAudioComponent->SetSound(turbineAudioCue);
+		if (HasActorBegunPlay())
+		{
+			StartTurbineSound();
+		}
 	}
 }
 
-void AFirstProjectPawn::BeginPlay()
+void AFirstProjectPawn::FitCollisionProxy()
 {
-	Super::BeginPlay();
+	if (!CollisionProxyExtent.IsZero())
+	{
+		CollisionProxy->SetBoxExtent(CollisionProxyExtent);
+	}
+	else if (PlaneMesh->SkeletalMesh)
+	{
+		// Bounds of the model as placed under the box, before it is moved
+		const FTransform MeshTransform(PlaneMesh->GetRelativeRotation(), FVector::ZeroVector, PlaneMesh->GetRelativeScale3D());
+		const FBox Bounds = PlaneMesh->SkeletalMesh->GetBounds().GetBox().TransformBy(MeshTransform);
+		CollisionProxy->SetBoxExtent(Bounds.GetExtent());
+		PlaneMesh->SetRelativeLocation(-Bounds.GetCenter());
+	}
+	else
+	{
+		CollisionProxy->SetBoxExtent(FallbackCollisionProxyExtent);
+	}
+}
+
+void AFirstProjectPawn::StartTurbineSound()
+{
+	if (turbineAudioComponent->Sound == nullptr)
+	{
+		// Starts when the cue has streamed in
+		return;
+	}
 
 	// Note because the Cue Asset is set to loop the sound,
 	// once we start playing the sound, it will play 
@@ -127,45 +319,124 @@ void AFirstProjectPawn::BeginPlay()
 	float fadeTime = 1.0f;
 	turbineAudioComponent->FadeIn(fadeTime, volume, startTime);
 }
+
+void AFirstProjectPawn::BeginPlay()
+{
+	Super::BeginPlay();
+
+	StartTurbineSound();
+
+	// Start the flight model from wherever the pawn was placed
+	FlightTransform = GetActorTransform();
+	PreviousFlightTransform = FlightTransform;
+	FlightClock.Reset();
+
+	// Clients receive the server's seed with the pawn, so every machine draws the same dispersion stream
+	if (MGunSeed == 0 && HasAuthority())
+	{
+		MGunSeed = FMath::Rand() | 1;
+	}
+
+	// Create everything the cannon recycles now, rather than during the first firefight
+	if (UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+	{
+		if (!bUseBulletManager)
+		{
+			Pool->PrewarmActors(AMGunBullet::StaticClass(), MGunBulletPoolSize);
+		}
+		Pool->PrewarmComponents(UDecalComponent::StaticClass(), ImpactDecalPoolSize);
+		Pool->PrewarmComponents(UAudioComponent::StaticClass(), OneShotSoundPoolSize);
+	}
+
+	if (UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>())
+	{
+		TargetIndex->AddTarget(this);
+	}
+}
+
+void AFirstProjectPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>())
+	{
+		TargetIndex->RemoveTarget(this);
+	}
+
+	if (FlightRecorder)
+	{
+		if (FlightRecorder->GetNumDropped() > 0)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s dropped %d flight records"), *GetName(), FlightRecorder->GetNumDropped());
+		}
+		FlightRecorder.Reset();
+	}
+
+	if (InputReplayMode == EInputReplayMode::Recording)
+	{
+		if (InputReplay.Save(InputReplayFilename))
+		{
+			UE_LOG(LogFlying, Log, TEXT("Recorded %d steps of input to %s"), InputReplay.Steps.Num(), *InputReplayFilename);
+		}
+		else
+		{
+			UE_LOG(LogFlying, Warning, TEXT("Cannot save input replay to %s"), *InputReplayFilename);
+		}
+	}
+	InputReplayMode = EInputReplayMode::None;
+
+	if (StreamedAssetsHandle.IsValid())
+	{
+		StreamedAssetsHandle->CancelHandle();
+		StreamedAssetsHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AFirstProjectPawn::Tick(float DeltaSeconds)
 {
-	float NewForwardSpeed = CurrentForwardSpeed + (GetWorld()->GetDeltaSeconds() * CurrentAcceleration);
-	// Clamp between MinSpeed and MaxSpeed
-	CurrentForwardSpeed = FMath::Clamp(NewForwardSpeed, MinSpeed, MaxSpeed);
-	const FVector LocalMove = FVector(CurrentForwardSpeed * DeltaSeconds, 0.f, 0.f);
+	ACRL_SCOPE_CYCLE_COUNTER(PawnTick);
 
-	// Move plan forwards (with sweep so we stop when we collide with things)
-	AddActorLocalOffset(LocalMove, true);
+	// Remember where the frame started so rounds can be spawned along this frame's motion
+	const FTransform FrameStartTransform = GetActorTransform();
 
-	// Calculate change in rotation this frame
-	FRotator DeltaRotation(0,0,0);
-	DeltaRotation.Pitch = CurrentPitchSpeed * DeltaSeconds;
-	DeltaRotation.Yaw = CurrentYawSpeed * DeltaSeconds;
-	DeltaRotation.Roll = CurrentRollSpeed * DeltaSeconds;
+	TickAIFire();
 
-	// Rotate plane
-	AddActorLocalRotation(DeltaRotation);
+	// Rebuild the rounds of a replicated burst the server fired before it got here, ahead of any newer round
+	MGunCatchUp(DeltaSeconds);
 
+	if (!TickSwarmFlight())
+	{
+		// Fires the cannon step by step along with the flight model and any replayed trigger
+		TickFlight(DeltaSeconds);
+	}
+	else
+	{
+		// The swarm steps this pawn, so take contacts and fire once per frame instead
+		FContactEvent Contact;
+		if (Contacts.ConsumeStep(DeltaSeconds, ContactWindow, Contact))
+		{
+			ApplyContact(Contact);
+		}
+		MGunFireRounds(DeltaSeconds, DeltaSeconds, 0.f, FrameStartTransform, GetActorTransform());
+	}
 	
-	//Turbine noise pitch is determined by a combination of the relative speed and acceleration with acceleration having preference
-	float turbineRpm = (((CurrentAcceleration - MinAcceleration) / (MaxAcceleration - MinAcceleration)) * 0.75f + 0.25f * ((CurrentForwardSpeed - MinSpeed) / (MaxSpeed - MinSpeed))) * 1.25f + 0.75f;
-	turbineAudioComponent->SetPitchMultiplier(turbineRpm);
+	{
+		ACRL_SCOPE_CYCLE_COUNTER(TurbineAudio);
+
+		//Turbine noise pitch is determined by a combination of the relative speed and acceleration with acceleration having preference
+		float turbineRpm = (((CurrentAcceleration - MinAcceleration) / (MaxAcceleration - MinAcceleration)) * 0.75f + 0.25f * ((CurrentForwardSpeed - MinSpeed) / (MaxSpeed - MinSpeed))) * 1.25f + 0.75f;
+		turbineAudioComponent->SetPitchMultiplier(turbineRpm);
+	}
 
 	SpringArm->SetRelativeRotation(FRotator(CurrentCameraUp, CurrentCameraRight, 0.f));
 
-	if (firing)
+	if (firing && (MGunAmmo <= 0 || (MGunBurstEndIndex != INDEX_NONE && MGunRoundsFired >= MGunBurstEndIndex)))
 	{
-		if (bCanFire == true)
+		fireAudioComponent->Deactivate();
+		firing = false;
+		if (HasAuthority())
 		{
-			if (MGunAmmo > 0)
-			{
-				MGunFire();
-			}
-			else
-			{
-				fireAudioComponent->Deactivate();
-				firing = false;
-			}
+			EndMGunBurst();
 		}
 	}
 	// Call any parent class Tick implementation
@@ -176,13 +447,327 @@ void AFirstProjectPawn::NotifyHit(class UPrimitiveComponent* MyComp, class AActo
 {
 	Super::NotifyHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
 
-	// Deflect along the surface when we collide.
-	FRotator CurrentRotation = GetActorRotation();
-	SetActorRotation(FQuat::Slerp(CurrentRotation.Quaternion(), HitNormal.ToOrientationQuat(), 0.025f));
-	CurrentHealth -= 10;
+	// The pawn is swept rather than simulated, so its hits carry no impulse: use the speed into the surface instead
+	const FVector Velocity = FlightTransform.GetRotation().GetForwardVector() * FlightState.ForwardSpeed;
+	const FVector OtherVelocity = Other ? Other->GetVelocity() : FVector::ZeroVector;
+	const float ImpactSpeed = FMath::Max(0.f, FVector::DotProduct(OtherVelocity - Velocity, HitNormal));
+
+	// Only recorded here, the next flight step applies at most one contact however many callbacks arrive
+	Contacts.AddHit(OtherComp, HitLocation, HitNormal, ImpactSpeed);
+}
+
+void AFirstProjectPawn::ApplyContact(const FContactEvent& Contact)
+{
+	// Deflect along the surface when we collide; the swarm writes its own rotation back over a member's actor
+	UAircraftSwarmSubsystem* Swarm = GetWorld()->GetSubsystem<UAircraftSwarmSubsystem>();
+	if (Swarm && Swarm->IsMember(this))
+	{
+		Swarm->DeflectAircraft(this, Contact.Normal.ToOrientationQuat(), ContactDeflection);
+	}
+	else
+	{
+		SetActorRotation(FQuat::Slerp(GetActorQuat(), Contact.Normal.ToOrientationQuat(), ContactDeflection));
+	}
+
+	// A contact costs health once, for the hardest it has been hit; later steps of it only take any increase
+	const float DamagePerSpeed = ContactDamage / FMath::Max(1.f, ContactDamageSpeed);
+	CurrentHealth -= FMath::RoundToInt(Contact.ImpactSpeed * DamagePerSpeed) - FMath::RoundToInt(Contact.PreviousImpactSpeed * DamagePerSpeed);
+}
+
+void AFirstProjectPawn::TickAIFire()
+{
+	if (AIFireHitProbability <= 0.f || bScriptedMGunFiring || !HasAuthority() || Controller == nullptr || IsPlayerControlled())
+	{
+		return;
+	}
+
+	UGunsightSubsystem* Gunsight = GetWorld()->GetSubsystem<UGunsightSubsystem>();
+	if (Gunsight == nullptr)
+	{
+		return;
+	}
+
+	// One batch solves every target ahead, whichever is lined up best decides
+	TArray<FGunsightSolution> Solutions;
+	Gunsight->GetLeadSolutions(this, Solutions);
+	bool bOnTarget = false;
+	for (const FGunsightSolution& Solution : Solutions)
+	{
+		bOnTarget |= Solution.HitProbability >= AIFireHitProbability;
+	}
+
+	if (bOnTarget && !firing && MGunAmmo > 0)
+	{
+		MGunInput();
+	}
+	else if (!bOnTarget && firing)
+	{
+		MGunOutput();
+	}
+}
+
+float AFirstProjectPawn::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	// Radial falloff is worked out by the base class
+	const float ActualDamage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	CurrentHealth -= FMath::RoundToInt(ActualDamage);
+	return ActualDamage;
+}
+
+void AFirstProjectPawn::TickFlight(float DeltaSeconds)
+{
+	if (!bInputReplayChecked && IsLocallyControlled())
+	{
+		bInputReplayChecked = true;
+		BeginInputReplay();
+	}
+
+	// Step the flight model at its fixed rate, however long this frame was
+	const float FlightStepTime = 1.f / FMath::Max(1.f, FlightStepRate);
+	const int32 NumFlightSteps = FlightClock.Advance(DeltaSeconds, FlightStepTime, MaxFlightSubsteps);
+	if (NumFlightSteps > 0)
+	{
+		// Blueprint and burst replication may have changed the speeds since the last step
+		FlightState.ForwardSpeed = CurrentForwardSpeed;
+		FlightState.Acceleration = CurrentAcceleration;
+
+		// The pawn is drawn between steps, so put it back on the simulated state before sweeping on from there
+		SetActorTransform(FlightTransform, false, nullptr, ETeleportType::TeleportPhysics);
+
+		if (bRecordFlightData && !FlightRecorder && IsLocallyControlled())
+		{
+			const FString Filename = FPaths::ProjectSavedDir() / TEXT("FlightData") / FString::Printf(TEXT("%s_%s.acfr"), *GetName(), *FDateTime::Now().ToString());
+			FlightRecorder = FFlightRecorder::Create(Filename);
+			if (!FlightRecorder)
+			{
+				UE_LOG(LogFlying, Warning, TEXT("Cannot record flight data to %s"), *Filename);
+				bRecordFlightData = false;
+			}
+		}
+
+		// The pawn is drawn a step behind the last one, so that step ends this far past the end of the frame
+		const float DrawLag = (1.f - FlightClock.GetAlpha(FlightStepTime)) * FlightStepTime;
+
+		const float Time = GetWorld()->GetTimeSeconds();
+		for (int32 StepIndex = 0; StepIndex < NumFlightSteps; StepIndex++)
+		{
+			TickInputReplay();
+			StepFlight(FlightStepTime);
+
+			// Rounds leave the muzzle along this step's motion, timed against the frame the way the pawn is drawn
+			const float StepStartTime = DeltaSeconds + DrawLag - (NumFlightSteps - StepIndex) * FlightStepTime;
+			MGunFireRounds(DeltaSeconds, FlightStepTime, StepStartTime, PreviousFlightTransform, FlightTransform);
+
+			if (FlightRecorder)
+			{
+				FlightRecorder->Record({ Time, DeltaSeconds, FlightTransform.GetLocation(), FlightTransform.Rotator(), FlightInput, FlightState });
+			}
+		}
+
+		CurrentForwardSpeed = FlightState.ForwardSpeed;
+		CurrentAcceleration = FlightState.Acceleration;
+	}
+
+	// Draw the pawn part way between the last two steps
+	FTransform RenderTransform;
+	RenderTransform.Blend(PreviousFlightTransform, FlightTransform, FlightClock.GetAlpha(FlightStepTime));
+	SetActorTransform(RenderTransform, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+bool AFirstProjectPawn::TickSwarmFlight()
+{
+	UAircraftSwarmSubsystem* Swarm = GetWorld()->GetSubsystem<UAircraftSwarmSubsystem>();
+	if (Swarm == nullptr)
+	{
+		return false;
+	}
+
+	if (!bFlyInSwarmWhenAI || Controller == nullptr || IsPlayerControlled())
+	{
+		if (Swarm->IsMember(this))
+		{
+			// A player took over, carry on from wherever the swarm left the pawn
+			FlightState = Swarm->GetAircraftState(this);
+			Swarm->RemoveAircraft(this);
+			FlightTransform = GetActorTransform();
+			PreviousFlightTransform = FlightTransform;
+			FlightClock.Reset();
+		}
+		return false;
+	}
+
+	if (!Swarm->IsMember(this))
+	{
+		FlightState.ForwardSpeed = CurrentForwardSpeed;
+		FlightState.Acceleration = CurrentAcceleration;
+		Swarm->AddAircraft(this, GetFlightParams(), FlightState);
+	}
+	Swarm->SetAircraftInput(this, FlightInput);
+
+	FlightState = Swarm->GetAircraftState(this);
+	CurrentForwardSpeed = FlightState.ForwardSpeed;
+	CurrentAcceleration = FlightState.Acceleration;
+	return true;
+}
+
+void AFirstProjectPawn::StepFlight(float StepTime)
+{
+	FVector LocalMove;
+	FRotator DeltaRotation;
+	FFlightModel::Step(GetFlightParams(), FlightInput, StepTime, FlightState, LocalMove, DeltaRotation);
+
+	PreviousFlightTransform = FlightTransform;
+
+	{
+		ACRL_SCOPE_CYCLE_COUNTER(FlightSweep);
+		ACRL_INC_COUNTER(Sweeps, 1);
+
+		// Move plan forwards (with sweep so we stop when we collide with things)
+		AddActorLocalOffset(LocalMove, true);
+	}
+
+	// Rotate plane
+	AddActorLocalRotation(DeltaRotation);
+
+	// At most one contact per step, so deflection and damage do not depend on the frame rate
+	FContactEvent Contact;
+	if (Contacts.ConsumeStep(StepTime, ContactWindow, Contact))
+	{
+		ApplyContact(Contact);
+	}
+
+	// Read back rather than accumulate, collisions may have stopped or deflected the pawn
+	FlightTransform = GetActorTransform();
+}
+
+void AFirstProjectPawn::BeginInputReplay()
+{
+	FString Filename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("InputReplay="), Filename))
+	{
+		InputReplayFilename = FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("InputReplays") / Filename : Filename;
+		if (!InputReplay.Load(InputReplayFilename))
+		{
+			UE_LOG(LogFlying, Warning, TEXT("Cannot play back %s, it is missing or not an input replay"), *InputReplayFilename);
+			return;
+		}
+
+		// Start from exactly where the recording did, the replay only holds input
+		InputReplayMode = EInputReplayMode::Playing;
+		MGunSeed = InputReplay.Seed;
+		FlightStepRate = InputReplay.StepRate;
+		FlightTransform = FTransform(InputReplay.StartRotation, InputReplay.StartLocation);
+		PreviousFlightTransform = FlightTransform;
+		FlightState = InputReplay.StartState;
+		CurrentForwardSpeed = FlightState.ForwardSpeed;
+		CurrentAcceleration = FlightState.Acceleration;
+		FlightClock.Reset();
+		UE_LOG(LogFlying, Log, TEXT("Playing back %d steps of input from %s"), InputReplay.Steps.Num(), *InputReplayFilename);
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("InputRecord="), Filename))
+	{
+		InputReplayFilename = FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("InputReplays") / Filename : Filename;
+		InputReplayMode = EInputReplayMode::Recording;
+		InputReplay.Seed = MGunSeed;
+		InputReplay.StepRate = FlightStepRate;
+		InputReplay.StartLocation = FlightTransform.GetLocation();
+		InputReplay.StartRotation = FlightTransform.Rotator();
+		InputReplay.StartState = FlightState;
+		InputReplay.StartState.ForwardSpeed = CurrentForwardSpeed;
+		InputReplay.StartState.Acceleration = CurrentAcceleration;
+		InputReplay.Steps.Reset();
+		PendingInputActions = 0;
+	}
+	else
+	{
+		return;
+	}
+
+	// Anything else drawing from the global stream repeats too, as long as it draws in the same order
+	FMath::RandInit(MGunSeed);
+	FMath::SRandInit(MGunSeed);
+	InputReplayStep = 0;
+}
+
+void AFirstProjectPawn::TickInputReplay()
+{
+	if (InputReplayMode == EInputReplayMode::Recording)
+	{
+		FInputReplayStep& Step = InputReplay.Steps.AddDefaulted_GetRef();
+		Step.Flight = FlightInput;
+		Step.CameraRight = CurrentCameraRight;
+		Step.CameraUp = CurrentCameraUp;
+		Step.Actions = PendingInputActions;
+		PendingInputActions = 0;
+	}
+	else if (InputReplayMode == EInputReplayMode::Playing)
+	{
+		if (!InputReplay.Steps.IsValidIndex(InputReplayStep))
+		{
+			// Hand the controls back, starting from neutral rather than from the last recorded input
+			UE_LOG(LogFlying, Log, TEXT("Finished playing back %s"), *InputReplayFilename);
+			InputReplayMode = EInputReplayMode::None;
+			FlightInput = FFlightModelInput();
+			return;
+		}
+
+		const FInputReplayStep& Step = InputReplay.Steps[InputReplayStep++];
+		FlightInput = Step.Flight;
+		CurrentCameraRight = Step.CameraRight;
+		CurrentCameraUp = Step.CameraUp;
+
+		TGuardValue<bool> ApplyingGuard(bApplyingInputReplay, true);
+		if (Step.Actions & EInputReplayAction::MGunPressed)
+		{
+			MGunInput();
+		}
+		if (Step.Actions & EInputReplayAction::MGunReleased)
+		{
+			MGunOutput();
+		}
+		if (Step.Actions & EInputReplayAction::Missile)
+		{
+			MissileInput();
+		}
+	}
+}
+
+bool AFirstProjectPawn::FilterInputAction(EInputReplayAction::Type Action)
+{
+	if (IsPlayingBackInput())
+	{
+		return false;
+	}
+	if (InputReplayMode == EInputReplayMode::Recording)
+	{
+		PendingInputActions |= Action;
+	}
+	return true;
+}
+
+FFlightModelParams AFirstProjectPawn::GetFlightParams() const
+{
+	FFlightModelParams Params;
+	Params.Acceleration = Acceleration;
+	Params.TurnSpeed = TurnSpeed;
+	Params.YawSpeed = YawSpeed;
+	Params.MinSpeed = MinSpeed;
+	Params.MaxSpeed = MaxSpeed;
+	Params.MinAcceleration = MinAcceleration;
+	Params.MaxAcceleration = MaxAcceleration;
+	return Params;
 }
 
 
+void AFirstProjectPawn::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The shooter's own client fires locally and does not need its bursts echoed back
+	DOREPLIFETIME_CONDITION(AFirstProjectPawn, MGunBurst, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AFirstProjectPawn, MGunSeed, COND_InitialOnly);
+}
+
 void AFirstProjectPawn::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
 {
     // Check if PlayerInputComponent is valid (not NULL)
@@ -195,112 +780,373 @@ void AFirstProjectPawn::SetupPlayerInputComponent(class UInputComponent* PlayerI
 	PlayerInputComponent->BindAxis("Yaw", this, &AFirstProjectPawn::YawRightInput);
 	PlayerInputComponent->BindAction("MGun", IE_Pressed, this, &AFirstProjectPawn::MGunInput);
 	PlayerInputComponent->BindAction("MGun", IE_Released, this, &AFirstProjectPawn::MGunOutput);
+	PlayerInputComponent->BindAction("Missile", IE_Pressed, this, &AFirstProjectPawn::MissileInput);
 	PlayerInputComponent->BindAxis("CameraRight", this, &AFirstProjectPawn::CameraRightInput);
 	PlayerInputComponent->BindAxis("CameraUp", this, &AFirstProjectPawn::CameraUpInput);
 }
 
 void AFirstProjectPawn::ThrustInput(float Val)
 {
-	// Is there any input?
-	bool bHasInput = !FMath::IsNearlyEqual(Val, 0.f);
-	// If input is not held down, reduce speed
-	float CurrentAcc = bHasInput ? (Val * Acceleration) : (-0.4f * CurrentAcceleration);
-	// Calculate new speed
-	float NewAccelerationSpeed = CurrentAcceleration + (GetWorld()->GetDeltaSeconds() * CurrentAcc);
-	// Clamp between MinSpeed and MaxSpeed
-	CurrentAcceleration = FMath::Clamp(NewAccelerationSpeed, MinAcceleration, MaxAcceleration);
+	if (IsPlayingBackInput())
+	{
+		return;
+	}
+
+	// Axes are only latched here, the flight model integrates them at its own rate
+	FlightInput.Thrust = Val;
 }
 
 void AFirstProjectPawn::MoveUpInput(float Val)
 {
-	// Target pitch speed is based in input
-	float TargetPitchSpeed = (Val * TurnSpeed * -1.f);
-
-	// When steering, we decrease pitch slightly
-	TargetPitchSpeed += (FMath::Abs(CurrentYawSpeed) * -0.2f);
-
-	// Smoothly interpolate to target pitch speed
-	CurrentPitchSpeed = FMath::FInterpTo(CurrentPitchSpeed, TargetPitchSpeed, GetWorld()->GetDeltaSeconds(), 2.f);
+	if (IsPlayingBackInput())
+	{
+		return;
+	}
+	FlightInput.Up = Val;
 }
 
 void AFirstProjectPawn::MoveRightInput(float Val)
 {
-	// Target yaw speed is based on input
-	float TargetRollSpeed = (2 * Val * TurnSpeed);
-
-
-	// Is there any left/right input?
-	const bool bIsTurning = FMath::Abs(Val) > 0.2f;
-
-	// Smoothly interpolate roll speed
-	CurrentRollSpeed = FMath::FInterpTo(CurrentRollSpeed, TargetRollSpeed, GetWorld()->GetDeltaSeconds(), 2.f);
+	if (IsPlayingBackInput())
+	{
+		return;
+	}
+	FlightInput.Right = Val;
 }
 
 void AFirstProjectPawn::YawRightInput(float Val)
 {
-	// Target yaw speed is based on input
-	float TargetYawSpeed = (2 * Val * YawSpeed);
-
-
-	// Is there any left/right input?
-	const bool bIsTurning = FMath::Abs(Val) > 0.2f;
-
-	// Smoothly interpolate roll speed
-	CurrentYawSpeed = FMath::FInterpTo(CurrentYawSpeed, TargetYawSpeed, GetWorld()->GetDeltaSeconds(), 2.f);
+	if (IsPlayingBackInput())
+	{
+		return;
+	}
+	FlightInput.Yaw = Val;
 }
 
 void AFirstProjectPawn::CameraRightInput(float Val)
 {
+	if (IsPlayingBackInput())
+	{
+		return;
+	}
 	CurrentCameraRight = 180.f * Val;
 }
 
 void AFirstProjectPawn::CameraUpInput(float Val)
 {
+	if (IsPlayingBackInput())
+	{
+		return;
+	}
 	CurrentCameraUp = -90.f * Val;
 }
 
 void AFirstProjectPawn::MGunInput()
 {
+	if (!FilterInputAction(EInputReplayAction::MGunPressed))
+	{
+		return;
+	}
+
 	if (MGunAmmo > 0)
 	{
 		firing = true;
 		fireAudioComponent->Activate();
+		if (HasAuthority())
+		{
+			BeginMGunBurst();
+		}
+		else
+		{
+			ServerSetMGunFiring(true);
+		}
 	}
-	else
+	else if (UWorld* World = GetWorld())
 	{
-		UGameplayStatics::PlaySound2D(World, ammoZeroAudioCue);
+		if (UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>())
+		{
+			Pool->PlaySound2D(ammoZeroAudioCue);
+		}
 	}
 }
 
 void AFirstProjectPawn::MGunOutput()
 {
+	if (!FilterInputAction(EInputReplayAction::MGunReleased))
+	{
+		return;
+	}
+
 	firing = false;
 	fireAudioComponent->Deactivate();
+	if (HasAuthority())
+	{
+		EndMGunBurst();
+	}
+	else
+	{
+		ServerSetMGunFiring(false);
+	}
+}
+
+void AFirstProjectPawn::SetScriptedMGunFiring(bool bNewFiring)
+{
+	bScriptedMGunFiring = true;
+	if (bNewFiring != firing)
+	{
+		if (bNewFiring)
+		{
+			MGunInput();
+		}
+		else
+		{
+			MGunOutput();
+		}
+	}
+}
+
+void AFirstProjectPawn::ServerSetMGunFiring_Implementation(bool bNewFiring)
+{
+	if (bNewFiring && MGunAmmo > 0)
+	{
+		firing = true;
+		BeginMGunBurst();
+	}
+	else if (!bNewFiring)
+	{
+		firing = false;
+		EndMGunBurst();
+	}
+}
+
+void AFirstProjectPawn::MissileInput()
+{
+	if (!FilterInputAction(EInputReplayAction::Missile))
+	{
+		return;
+	}
+
+	if (HasAuthority())
+	{
+		FireMissile();
+	}
+	else
+	{
+		ServerFireMissile();
+	}
+}
+
+void AFirstProjectPawn::ServerFireMissile_Implementation()
+{
+	FireMissile();
+}
+
+void AFirstProjectPawn::FireMissile()
+{
+	UMissileManager* MissileManager = GetWorld()->GetSubsystem<UMissileManager>();
+	if (MissileManager == nullptr || MissileAmmo <= 0)
+	{
+		return;
+	}
+
+	MissileAmmo--;
+	const FVector Location = GetActorLocation() + GetActorQuat().RotateVector(MissileOffset);
+	const FVector Direction = GetActorForwardVector();
+	AActor* Target = MissileManager->FindSeekerTarget(MissileSeeker, Location, Direction, this);
+	MulticastLaunchMissile(MissileSeeker, Target, Location, Direction, CurrentForwardSpeed);
+}
+
+void AFirstProjectPawn::MulticastLaunchMissile_Implementation(EMissileSeeker Seeker, AActor* Target, FVector_NetQuantize Location, FVector_NetQuantizeNormal Direction, float LaunchSpeed)
+{
+	UMissileManager* MissileManager = GetWorld()->GetSubsystem<UMissileManager>();
+	if (MissileManager == nullptr)
+	{
+		return;
+	}
+
+	FMissileLaunch Launch;
+	Launch.Seeker = Seeker;
+	Launch.Launcher = this;
+	Launch.Target = Target;
+	Launch.Location = Location;
+	Launch.Direction = Direction;
+	Launch.LaunchSpeed = LaunchSpeed;
+	Launch.Mesh = MissileMesh;
+	Launch.MotorSound = MissileMotorSound;
+	Launch.Explosion = MissileExplosion;
+	MissileManager->LaunchMissile(Launch);
+
+	if (IsLocallyControlled())
+	{
+		if (UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+		{
+			Pool->PlaySound2D(MissileLaunchSound);
+		}
+	}
+}
+
+void AFirstProjectPawn::BeginMGunBurst()
+{
+	MGunBurst.BurstId++;
+	MGunBurst.StartTime = GetWorld()->GetTimeSeconds();
+	MGunBurst.FirstShotIndex = MGunRoundsFired;
+	MGunBurst.NumRounds = INDEX_NONE;
+	MGunBurst.MuzzleRotation = GetActorRotation();
+	MGunBurst.MuzzleLocation = GetActorLocation() + MGunBurst.MuzzleRotation.RotateVector(GunOffset);
+	MGunBurst.ForwardSpeed = CurrentForwardSpeed;
+}
+
+void AFirstProjectPawn::EndMGunBurst()
+{
+	if (MGunBurst.NumRounds == INDEX_NONE)
+	{
+		MGunBurst.NumRounds = MGunRoundsFired - MGunBurst.FirstShotIndex;
+	}
+}
+
+void AFirstProjectPawn::OnRep_MGunBurst()
+{
+	if (MGunBurst.BurstId != MGunLastBurstId)
+	{
+		MGunLastBurstId = MGunBurst.BurstId;
+
+		// The rounds the server fired while the event was in flight are rebuilt from the muzzle state on the next tick
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+		const float ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : MGunBurst.StartTime;
+		MGunCatchUpRounds = FireRate > 0.f ? FMath::FloorToInt(FMath::Max(0.f, ServerTime - MGunBurst.StartTime) / FireRate) : 0;
+		MGunRoundsFired = MGunBurst.FirstShotIndex;
+
+		MGunFireControl.Reset();
+		firing = true;
+		fireAudioComponent->Activate();
+	}
+
+	MGunBurstEndIndex = MGunBurst.NumRounds != INDEX_NONE ? MGunBurst.FirstShotIndex + MGunBurst.NumRounds : INDEX_NONE;
+}
+
+void AFirstProjectPawn::MGunCatchUp(float DeltaSeconds)
+{
+	int32 NumRounds = MGunCatchUpRounds;
+	MGunCatchUpRounds = 0;
+	if (MGunBurstEndIndex != INDEX_NONE)
+	{
+		NumRounds = FMath::Min(NumRounds, MGunBurstEndIndex - MGunRoundsFired);
+	}
+	NumRounds = FMath::Min(NumRounds, MGunAmmo);
+	if (NumRounds <= 0)
+	{
+		return;
+	}
+
+	// The shooter is taken to fly straight on from the muzzle state, close enough over one trip from the server
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const float ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : MGunBurst.StartTime;
+	const FVector BurstStartLocation = MGunBurst.MuzzleLocation - MGunBurst.MuzzleRotation.RotateVector(GunOffset);
+	const FVector ShooterVelocity = MGunBurst.MuzzleRotation.Vector() * MGunBurst.ForwardSpeed;
+	FMGunDispersion::GetBurstOffsets(MGunSeed, MGunRoundsFired, NumRounds, MGunCone, MGunShotDispersion);
+	for (int32 Round = 0; Round < NumRounds; Round++)
+	{
+		const float FireTime = Round * FireRate;
+		const float Age = ServerTime - MGunBurst.StartTime - FireTime;
+		if (Age >= UMGunBulletManager::RoundLifeSpan)
+		{
+			// Already gone on the server, only keep the shot indices lined up
+			MGunAmmo--;
+			MGunRoundsFired++;
+			continue;
+		}
+
+		const FTransform MuzzleTransform(MGunBurst.MuzzleRotation, BurstStartLocation + ShooterVelocity * FireTime);
+		MGunFire(MuzzleTransform, DeltaSeconds, DeltaSeconds - Age, MGunShotDispersion[Round], MGunBurst.ForwardSpeed);
+	}
 }
 
-void AFirstProjectPawn::MGunFire()
+void AFirstProjectPawn::MGunFireRounds(float DeltaSeconds, float FireTime, float FireTimeOffset, const FTransform& FromTransform, const FTransform& ToTransform)
 {
+	// Every round owed over this span, however many spans the fire interval covers
+	int32 MaxShots = MGunAmmo;
+	if (MGunBurstEndIndex != INDEX_NONE)
+	{
+		// A replicated burst that has ended on the server only plays out the rounds it actually fired
+		MaxShots = FMath::Min(MaxShots, MGunBurstEndIndex - MGunRoundsFired);
+	}
+	const int32 NumShots = MGunFireControl.Advance(FireTime, FireRate, firing, MaxShots, MGunShotTimes);
+	FMGunDispersion::GetBurstOffsets(MGunSeed, MGunRoundsFired, NumShots, MGunCone, MGunShotDispersion);
+	for (int32 ShotIndex = 0; ShotIndex < NumShots; ShotIndex++)
+	{
+		// Place the muzzle where the pawn was at the moment this round was fired
+		const float ShotTime = MGunShotTimes[ShotIndex];
+		FTransform MuzzleTransform;
+		MuzzleTransform.Blend(FromTransform, ToTransform, FireTime > 0.f ? ShotTime / FireTime : 1.f);
+		MGunFire(MuzzleTransform, DeltaSeconds, FireTimeOffset + ShotTime, MGunShotDispersion[ShotIndex], CurrentForwardSpeed);
+	}
+}
+
+void AFirstProjectPawn::MGunFire(const FTransform& MuzzleTransform, float DeltaSeconds, float ShotTime, const FRotator& Dispersion, float ForwardSpeed)
+{
+	ACRL_SCOPE_CYCLE_COUNTER(MGunFire);
+	ACRL_INC_COUNTER(RoundsSpawned, 1);
+
 	MGunAmmo--;
-	bCanFire = false;
-	const FRotator FireRotation = GetActorRotation();
+	MGunRoundsFired++;
+
+	const FRotator FireRotation = MuzzleTransform.Rotator();
 	// Spawn projectile at an offset from this pawn
-	const FVector SpawnLocation = GetActorLocation() + FireRotation.RotateVector(GunOffset);
+	const FVector SpawnLocation = MuzzleTransform.GetLocation() + FireRotation.RotateVector(GunOffset);
+	const FRotator RoundRotation = FireRotation + Dispersion;
 
-	if (World != NULL)
+	UWorld* const World = GetWorld();
+	if (World != NULL && bUseBulletManager)
+	{
+		// hand the round to the bullet manager, it is simulated without an actor
+		if (UMGunBulletManager* BulletManager = World->GetSubsystem<UMGunBulletManager>())
+		{
+			UStaticMesh* RoundTracer = (MGunRoundsFired % FMath::Max(1, TracerEveryNthRound)) == 0 ? TracerMesh : nullptr;
+			BulletManager->SpawnRound(SpawnLocation, RoundRotation.Vector() * (UMGunBulletManager::MuzzleSpeed + ForwardSpeed), this, ShotTime, RoundTracer);
+		}
+	}
+	else if (World != NULL)
 	{
-		// spawn the projectile
-		AMGunBullet* bullet = World->SpawnActorDeferred<AMGunBullet>(AMGunBullet::StaticClass(), FTransform(FireRotation + FRotator(((float)rand()) / RAND_MAX * 2.0 * MGunCone - MGunCone, ((float)rand()) / RAND_MAX * 2.0 * MGunCone - MGunCone, ((float)rand()) / RAND_MAX * 2.0 * MGunCone - MGunCone), SpawnLocation), GetOwner(), GetOwner()->GetInstigator());
-		bullet->SetVelocity(CurrentForwardSpeed);
-		UGameplayStatics::FinishSpawningActor(bullet, FTransform(FireRotation + FRotator(((float)rand()) / RAND_MAX * 2.0 * MGunCone - MGunCone, ((float)rand()) / RAND_MAX * 2.0 * MGunCone - MGunCone, ((float)rand()) / RAND_MAX * 2.0 * MGunCone - MGunCone), SpawnLocation));
+		// actors are not stepped until next frame, so start the round where it would be by the end of this one
+		const FVector RoundLocation = SpawnLocation + RoundRotation.Vector() * (UMGunBulletManager::MuzzleSpeed + ForwardSpeed) * (DeltaSeconds - ShotTime);
+
+		// take the projectile from the pool, it is spawned only if the pool ran dry
+		if (UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>())
+		{
+			if (AMGunBullet* bullet = Pool->AcquireActor<AMGunBullet>(FTransform(RoundRotation, RoundLocation), GetOwner(), GetInstigator()))
+			{
+				bullet->SetVelocity(ForwardSpeed);
+			}
+		}
 	}
 	else
 	{
-		printf("World == null!");
+		UE_LOG(LogFlying, Warning, TEXT("%s fired a round without a world"), *GetName());
 	}
-	World->GetTimerManager().SetTimer(TimerHandle_ShotTimerExpired, this, &AFirstProjectPawn::ShotTimerExpired, FireRate);
 }
 
-void AFirstProjectPawn::ShotTimerExpired()
+bool FMGunBurst::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
 {
-	bCanFire = true;
-}
\ No newline at end of file
+	Ar << BurstId;
+	Ar << StartTime;
+
+	uint32 PackedShotIndex = (uint32)FirstShotIndex;
+	Ar.SerializeIntPacked(PackedShotIndex);
+	FirstShotIndex = (int32)PackedShotIndex;
+
+	// Offset by one so an open burst packs into a single byte
+	uint32 PackedNumRounds = (uint32)(NumRounds + 1);
+	Ar.SerializeIntPacked(PackedNumRounds);
+	NumRounds = (int32)PackedNumRounds - 1;
+
+	bOutSuccess = true;
+	MuzzleLocation.NetSerialize(Ar, Map, bOutSuccess);
+	MuzzleRotation.SerializeCompressedShort(Ar);
+
+	// Forward speed in 2 cm/s steps fits the whole flight envelope in 16 bits
+	uint16 PackedSpeed = (uint16)FMath::Clamp(FMath::RoundToInt(ForwardSpeed * 0.5f), 0, 65535);
+	Ar << PackedSpeed;
+	ForwardSpeed = PackedSpeed * 2.f;
+
+	return true;
+}
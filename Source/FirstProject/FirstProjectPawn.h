@@ -4,14 +4,80 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
 #include "Sound/SoundCue.h"
+#include "Engine/StreamableManager.h"
+#include "MGunFireControl.h"
+#include "MGunDispersion.h"
+#include "FlightModel.h"
+#include "MissileManager.h"
+#include "ContactAggregator.h"
+#include "FlightRecorder.h"
+#include "InputReplay.h"
 #include "FirstProjectPawn.generated.h"
 
+class USkeletalMesh;
+class UStaticMesh;
+class USoundBase;
+class UParticleSystem;
+
+/**
+ * Replicated description of one cannon burst.
+ * Clients regenerate every round of the burst locally from the pawn's MGunSeed and the shot indices, so the cost
+ * on the wire is one event when the trigger goes down and one when it comes up, regardless of the fire rate.
+ */
+USTRUCT()
+struct FMGunBurst
+{
+	GENERATED_BODY()
+
+	/** Incremented for every new burst so clients can tell a new trigger pull from an update */
+	UPROPERTY()
+	uint8 BurstId = 0;
+
+	/** Server world time the trigger went down */
+	UPROPERTY()
+	float StartTime = 0.f;
+
+	/** Shot index of the first round of the burst */
+	UPROPERTY()
+	int32 FirstShotIndex = 0;
+
+	/** Rounds fired in the burst, INDEX_NONE while the trigger is still held */
+	UPROPERTY()
+	int32 NumRounds = INDEX_NONE;
+
+	/** Muzzle location when the trigger went down */
+	UPROPERTY()
+	FVector_NetQuantize MuzzleLocation;
+
+	/** Shooter rotation when the trigger went down */
+	UPROPERTY()
+	FRotator MuzzleRotation = FRotator::ZeroRotator;
+
+	/** Shooter forward speed when the trigger went down */
+	UPROPERTY()
+	float ForwardSpeed = 0.f;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FMGunBurst> : public TStructOpsTypeTraitsBase2<FMGunBurst>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
 
 UCLASS(Config=Game)
 class AFirstProjectPawn : public APawn
 {
 	GENERATED_BODY()
 
+	/** Simple box swept in place of the skeletal mesh when the pawn moves */
+	UPROPERTY(Category = Mesh, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UBoxComponent* CollisionProxy;
+
 	/** StaticMesh component that will be the visuals for our flying pawn */
 	UPROPERTY(Category = Mesh, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	class USkeletalMeshComponent* PlaneMesh;
@@ -28,11 +94,26 @@ public:
 
 	// Begin AActor overrides
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void PostInitializeComponents() override;
 	virtual void Tick(float DeltaSeconds) override;
 	virtual void NotifyHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
 	// End AActor overrides
 
+	/** Holds Input on the flight controls, for pawns flown by a script rather than by bound input */
+	void SetScriptedInput(const FFlightModelInput& Input) { FlightInput = Input; }
+
+	/** Presses or releases the cannon trigger, for pawns flown by a script rather than by bound input; the AI trigger stays off from then on */
+	void SetScriptedMGunFiring(bool bNewFiring);
+
+	/** Returns the speeds integrated by the flight model at the last flight step */
+	const FFlightModelState& GetFlightState() const { return FlightState; }
+
+	/** Appends the soft referenced assets this pawn loads in the background, for the game mode to preload */
+	void GetStreamedAssets(TArray<FSoftObjectPath>& OutAssets) const;
+
 	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
 	int CurrentHealth;
 
@@ -53,8 +134,97 @@ public:
 	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
 	float MGunCone;
 
-	/* Handler for the fire timer expiry */
-	void ShotTimerExpired();
+	/** Seed of the cannon's dispersion stream, picked by the server at BeginPlay when left at 0 and replicated to everyone */
+	UPROPERTY(Category = Gameplay, Replicated, EditAnywhere, BlueprintReadWrite)
+	int32 MGunSeed;
+
+	/** Simulate rounds in the bullet manager instead of spawning one AMGunBullet actor per round */
+	UPROPERTY(Category = Gameplay, Config, EditAnywhere, BlueprintReadWrite)
+	bool bUseBulletManager;
+
+	/** Mesh drawn for cannon tracers by the bullet manager */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	class UStaticMesh* TracerMesh;
+
+	/** Only every Nth round fired through the bullet manager carries a tracer */
+	UPROPERTY(Category = Gameplay, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+	int32 TracerEveryNthRound;
+
+	/** AMGunBullet actors created up front for the actor fallback path */
+	UPROPERTY(Category = Gameplay, Config, EditAnywhere)
+	int32 MGunBulletPoolSize;
+
+	/** Impact decals created up front */
+	UPROPERTY(Category = Gameplay, Config, EditAnywhere)
+	int32 ImpactDecalPoolSize;
+
+	/** Audio components created up front for one-shot sounds */
+	UPROPERTY(Category = Gameplay, Config, EditAnywhere)
+	int32 OneShotSoundPoolSize;
+
+	/** Missiles left, counted on the server */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	int32 MissileAmmo;
+
+	/** Seeker of the missiles fired by the missile input */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	EMissileSeeker MissileSeeker;
+
+	/** Offset from the ships location at which missiles leave the rail */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	FVector MissileOffset;
+
+	/** Mesh drawn for missiles by the missile manager */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	class UStaticMesh* MissileMesh;
+
+	/** Played along with a missile while it flies */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	class USoundBase* MissileMotorSound;
+
+	/** Played to the pilot when a missile is fired */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	class USoundBase* MissileLaunchSound;
+
+	/** Spawned where a missile detonates */
+	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
+	class UParticleSystem* MissileExplosion;
+
+	/** Aircraft model, nothing is drawn until it has streamed in */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USkeletalMesh> PlaneMeshAsset;
+
+	/** Streamed into TracerMesh unless that is set */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> TracerMeshAsset;
+
+	/** Streamed into MissileMesh unless that is set */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> MissileMeshAsset;
+
+	/** Streamed into MissileMotorSound unless that is set */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USoundBase> MissileMotorSoundAsset;
+
+	/** Streamed into MissileLaunchSound unless that is set */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USoundBase> MissileLaunchSoundAsset;
+
+	/** Streamed into MissileExplosion unless that is set */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<UParticleSystem> MissileExplosionAsset;
+
+	/** Looping engine sound, the turbine starts once it has streamed in */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USoundCue> TurbineCueAsset;
+
+	/** Looping cannon sound */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USoundCue> FireCueAsset;
+
+	/** Played to the pilot when the cannon runs dry */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USoundCue> AmmoZeroCueAsset;
 
 	/** Current forward speed */
 	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
@@ -63,6 +233,54 @@ public:
 	UPROPERTY(Category = Gameplay, EditAnywhere, BlueprintReadWrite)
 	float CurrentAcceleration;
 
+	/** Rate at which the flight model is stepped, independently of the frame rate */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+	float FlightStepRate;
+
+	/** Most flight model steps run in one frame, time beyond it is dropped after a hitch */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+	int32 MaxFlightSubsteps;
+
+	/** Sweep CollisionProxy instead of the skeletal mesh, which then has no collision of its own */
+	UPROPERTY(Category = Plane, Config, EditDefaultsOnly, BlueprintReadOnly)
+	bool bUseCollisionProxy;
+
+	/** Half size of CollisionProxy, fitted to the skeletal mesh bounds when left at zero */
+	UPROPERTY(Category = Plane, Config, EditDefaultsOnly, BlueprintReadOnly)
+	FVector CollisionProxyExtent;
+
+	/** Half size of CollisionProxy while the skeletal mesh it is fitted to is still loading */
+	UPROPERTY(Category = Plane, Config, EditDefaultsOnly, BlueprintReadOnly)
+	FVector FallbackCollisionProxyExtent;
+
+	/** Hand the flight model to the aircraft swarm while an AI controller is flying this pawn */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite)
+	bool bFlyInSwarmWhenAI;
+
+	/** Seconds a contact with a surface stays open without being hit, hits within it count as one impact */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float ContactWindow;
+
+	/** Health lost by hitting a surface at ContactDamageSpeed, scaled linearly with the impact speed */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite)
+	float ContactDamage;
+
+	/** Speed into a surface that costs ContactDamage, in cm/s */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+	float ContactDamageSpeed;
+
+	/** Fraction of the way the pawn is turned toward the surface normal per flight step while in contact */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "1"))
+	float ContactDeflection;
+
+	/** Record every flight step of a locally controlled pawn to Saved/FlightData, read back with acrl.FlightRecorder.ExportCsv */
+	UPROPERTY(Category = Plane, Config, EditAnywhere, BlueprintReadWrite)
+	bool bRecordFlightData;
+
+	/** An AI flown pawn holds the trigger while the gunsight gives a round at least this chance of hitting a target, 0 never fires */
+	UPROPERTY(Category = Gameplay, Config, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "1"))
+	float AIFireHitProbability;
+
 protected:
 
 	// Begin APawn overrides
@@ -84,7 +302,49 @@ protected:
 
 	void MGunOutput();
 
-	void MGunFire();
+	/** Asks the server to start or stop firing the cannon */
+	UFUNCTION(Server, Reliable)
+	void ServerSetMGunFiring(bool bNewFiring);
+
+	/** Starts a new replicated burst, authority only */
+	void BeginMGunBurst();
+
+	/** Closes the current replicated burst with the number of rounds it fired, authority only */
+	void EndMGunBurst();
+
+	/** Rebuilds a remote shooter's burst locally */
+	UFUNCTION()
+	void OnRep_MGunBurst();
+
+	/**
+	 * Fires one round from the pawn at MuzzleTransform, offset by Dispersion.
+	 * @param ShotTime		Seconds into this frame the round was fired, negative for a round fired in an earlier frame
+	 *						and past DeltaSeconds for one fired during the part of the last flight step not drawn yet
+	 * @param ForwardSpeed	Shooter's forward speed when the round was fired, added to the muzzle speed
+	 */
+	void MGunFire(const FTransform& MuzzleTransform, float DeltaSeconds, float ShotTime, const FRotator& Dispersion, float ForwardSpeed);
+
+	/**
+	 * Fires every round owed over FireTime seconds of flight from FromTransform to ToTransform.
+	 * @param FireTimeOffset	Seconds into this frame that FireTime starts at
+	 */
+	void MGunFireRounds(float DeltaSeconds, float FireTime, float FireTimeOffset, const FTransform& FromTransform, const FTransform& ToTransform);
+
+	/** Fires the rounds of a replicated burst that the server fired before the burst arrived, from its muzzle state */
+	void MGunCatchUp(float DeltaSeconds);
+
+	void MissileInput();
+
+	/** Asks the server to fire a missile */
+	UFUNCTION(Server, Reliable)
+	void ServerFireMissile();
+
+	/** Fires a missile at whatever its seeker locks, authority only */
+	void FireMissile();
+
+	/** Puts the same missile in the air on every machine, damage is only applied by the server's copy */
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastLaunchMissile(EMissileSeeker Seeker, AActor* Target, FVector_NetQuantize Location, FVector_NetQuantizeNormal Direction, float LaunchSpeed);
 
 	void CameraRightInput(float Val);
 
@@ -137,14 +397,91 @@ private:
 	UPROPERTY(Category = Plane, EditAnywhere)
 	float MinAcceleration;
 
-	/** Current yaw speed */
-	float CurrentYawSpeed;
+	/** Steps the flight model owed this frame and draws the pawn between the last two steps */
+	void TickFlight(float DeltaSeconds);
+
+	/** Hands the latched input to the swarm and reads back the speeds it integrated, returns false if this pawn flies itself */
+	bool TickSwarmFlight();
+
+	/** Runs one fixed flight model step and sweeps the aircraft along it */
+	void StepFlight(float StepTime);
+
+	/** Handling limits handed to the flight model */
+	FFlightModelParams GetFlightParams() const;
+
+	/** Fills every asset reference that is still empty from the streamed assets already in memory */
+	void ApplyStreamedAssets();
+
+	/**
+	 * Fits CollisionProxy to the aircraft model, unless CollisionProxyExtent sets its size.
+	 * The box is centred on the pawn, so the model is moved to centre its bounds on the box.
+	 */
+	void FitCollisionProxy();
+
+	/** Fades the turbine sound in, once it has streamed in and play has begun */
+	void StartTurbineSound();
 
-	/** Current pitch speed */
-	float CurrentPitchSpeed;
+	/** Presses the trigger of an AI flown pawn while the gunsight has a target lined up, and releases it otherwise */
+	void TickAIFire();
 
-	/** Current roll speed */
-	float CurrentRollSpeed;
+	/** Deflects the pawn off an aggregated contact and takes the damage it has not taken for it yet */
+	void ApplyContact(const FContactEvent& Contact);
+
+	/** Starts recording or playing back input if the command line asks for it with -InputRecord=<file> or -InputReplay=<file> */
+	void BeginInputReplay();
+
+	/** Records the input of the coming flight step, or applies the recorded one */
+	void TickInputReplay();
+
+	/** Records Action while recording, returns false for live input while playing back */
+	bool FilterInputAction(EInputReplayAction::Type Action);
+
+	/** Returns whether live input is ignored because recorded input is being played back */
+	bool IsPlayingBackInput() const { return InputReplayMode == EInputReplayMode::Playing && !bApplyingInputReplay; }
+
+	/** Hit callbacks merged into one contact per surface */
+	FContactAggregator Contacts;
+
+	/** Control axes latched by the input handlers, consumed by every flight step of the frame */
+	FFlightModelInput FlightInput;
+
+	/** Speeds integrated by the flight model */
+	FFlightModelState FlightState;
+
+	/** Counts the flight steps owed each frame */
+	FFixedStepClock FlightClock;
+
+	/** Simulated transform before the last flight step, the pawn is drawn between this and FlightTransform */
+	FTransform PreviousFlightTransform;
+
+	/** Simulated transform after the last flight step */
+	FTransform FlightTransform;
+
+	/** Keeps the streamed assets in memory, and loading while some are missing */
+	TSharedPtr<FStreamableHandle> StreamedAssetsHandle;
+
+	/** Streams flight steps to disk while bRecordFlightData is set, created on the first recorded step */
+	TUniquePtr<FFlightRecorder> FlightRecorder;
+
+	EInputReplayMode InputReplayMode;
+
+	/** Whether the command line has been checked for input replay, done once the pawn is locally controlled */
+	bool bInputReplayChecked;
+
+	/** Whether input handlers are being called by the playback rather than by live input */
+	bool bApplyingInputReplay;
+
+	/** Input recorded so far, or being played back */
+	FInputReplay InputReplay;
+
+	/** File the recording is saved to when play ends */
+	FString InputReplayFilename;
+
+	/** Next step played back */
+	int32 InputReplayStep;
+
+	/** EInputReplayAction bits triggered since the last recorded step */
+	uint8 PendingInputActions;
 
 	float CurrentCameraRight;
 
@@ -152,15 +489,37 @@ private:
 
 	bool firing;
 
-	UWorld* const World = GetWorld();
+	/** Whether a script works the trigger, which then keeps the AI off it */
+	bool bScriptedMGunFiring;
+
+	/** Schedules cannon rounds at FireRate independently of the frame rate */
+	FMGunFireControl MGunFireControl;
+
+	/** Time of each round owed over the span being fired, kept to avoid reallocating every tick */
+	TArray<float> MGunShotTimes;
+
+	/** Cone offset of each round owed this frame */
+	TArray<FRotator> MGunShotDispersion;
+
+	/** Rounds fired so far, the shot index of the dispersion stream and used to pick which ones carry a tracer */
+	int32 MGunRoundsFired;
+
+	/** Current cannon burst, sent to everyone but the shooter's own client */
+	UPROPERTY(ReplicatedUsing = OnRep_MGunBurst)
+	FMGunBurst MGunBurst;
+
+	/** Shot index at which a replicated burst stops, INDEX_NONE while it is open */
+	int32 MGunBurstEndIndex;
 
-	/* Flag to control firing  */
-	uint32 bCanFire : 1;
+	/** Last burst rebuilt from replication */
+	uint8 MGunLastBurstId;
 
-	/** Handle for efficient management of ShotTimerExpired timer */
-	FTimerHandle TimerHandle_ShotTimerExpired;
+	/** Rounds of a replicated burst fired on the server before it arrived, still to be rebuilt */
+	int32 MGunCatchUpRounds;
 
 public:
+	/** Returns CollisionProxy subobject **/
+	FORCEINLINE class UBoxComponent* GetCollisionProxy() const { return CollisionProxy; }
 	/** Returns PlaneMesh subobject **/
 	FORCEINLINE class USkeletalMeshComponent* GetPlaneMesh() const { return PlaneMesh; }
 	/** Returns SpringArm subobject **/
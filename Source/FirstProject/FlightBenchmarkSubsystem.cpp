@@ -0,0 +1,422 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "FlightBenchmarkSubsystem.h"
+#include "FirstProject.h"
+#include "FirstProjectPawn.h"
+#include "BTR.h"
+#include "TerrainHeightfieldSubsystem.h"
+#include "Engine/World.h"
+#include "CoreGlobals.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProperties.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+
+namespace FlightBenchmark
+{
+	/** Percentiles, mean and max of Samples */
+	static TSharedRef<FJsonObject> Summarize(TArray<float> Samples)
+	{
+		Samples.Sort();
+		const int32 Num = Samples.Num();
+		auto Percentile = [&Samples, Num](float Fraction)
+		{
+			return Num > 0 ? Samples[FMath::Clamp(FMath::CeilToInt(Fraction * Num) - 1, 0, Num - 1)] : 0.f;
+		};
+
+		float Sum = 0.f;
+		for (float Sample : Samples)
+		{
+			Sum += Sample;
+		}
+
+		TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+		Summary->SetNumberField(TEXT("samples"), Num);
+		Summary->SetNumberField(TEXT("mean"), Num > 0 ? Sum / Num : 0.f);
+		Summary->SetNumberField(TEXT("p50"), Percentile(0.5f));
+		Summary->SetNumberField(TEXT("p95"), Percentile(0.95f));
+		Summary->SetNumberField(TEXT("p99"), Percentile(0.99f));
+		Summary->SetNumberField(TEXT("max"), Num > 0 ? Samples.Last() : 0.f);
+		return Summary;
+	}
+
+	static float GetUsedMemoryMB()
+	{
+		return FPlatformMemory::GetStats().UsedPhysical / (1024.f * 1024.f);
+	}
+}
+
+void FBenchmarkPhysicsTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target)
+	{
+		Target->MarkPhysics(bEnd);
+	}
+}
+
+FString FBenchmarkPhysicsTickFunction::DiagnosticMessage()
+{
+	return bEnd ? TEXT("FBenchmarkPhysicsTickFunction[End]") : TEXT("FBenchmarkPhysicsTickFunction[Start]");
+}
+
+UFlightBenchmarkSubsystem::UFlightBenchmarkSubsystem()
+{
+	NumAircraft = 16;
+	NumBTRs = 8;
+	WarmupTime = 5.f;
+	Duration = 60.f;
+	AircraftRingRadius = 200000.f;
+	AircraftAltitude = 30000.f;
+	AircraftAltitudeStep = 1500.f;
+	TurnYawInput = 1.f;
+	TurnUpInput = -0.08f;
+	BurstTime = 2.f;
+	BurstPause = 1.f;
+	BTRLoopRadius = 20000.f;
+	BTRLoopWaypoints = 8;
+	MemorySampleInterval = 0.5f;
+	HitchThreshold = 50.f;
+
+	bChecked = false;
+	bRunning = false;
+	bExitWhenDone = false;
+	SampleStartTime = 0.f;
+	SampleEndTime = 0.f;
+	AircraftAmmo = 0;
+	LastTickTime = 0.0;
+	PhysicsWaitStart = 0.0;
+	PhysicsWaitThisFrame = 0.f;
+	LastMemorySampleTime = 0.0;
+}
+
+void UFlightBenchmarkSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		UE_LOG(LogFlying, Error, TEXT("Flight benchmark abandoned, the world ended before the run did"));
+		if (bExitWhenDone)
+		{
+			FPlatformMisc::RequestExitWithStatus(false, 1);
+		}
+	}
+
+	if (PhysicsStartTick.IsTickFunctionRegistered())
+	{
+		GetWorld()->EndPhysicsTickFunction.RemovePrerequisite(this, PhysicsStartTick);
+		PhysicsStartTick.UnRegisterTickFunction();
+	}
+	if (PhysicsEndTick.IsTickFunctionRegistered())
+	{
+		PhysicsEndTick.UnRegisterTickFunction();
+	}
+	GarbageCollectTimer.Stop();
+
+	bRunning = false;
+	Aircraft.Empty();
+	BTRs.Empty();
+	BTRLoops.Empty();
+	FrameTimes.Empty();
+	GameThreadTimes.Empty();
+	PhysicsWaitTimes.Empty();
+	MemoryUsage.Empty();
+	GarbageCollectTimes.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UFlightBenchmarkSubsystem::IsTickable() const
+{
+	return !bChecked || bRunning;
+}
+
+ETickableTickType UFlightBenchmarkSubsystem::GetTickableTickType() const
+{
+	// The class default object never runs a benchmark
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UFlightBenchmarkSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UFlightBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFlightBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UFlightBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	if (!bChecked)
+	{
+		// Aircraft are placed over the terrain, so wait for its first bake
+		UTerrainHeightfieldSubsystem* Terrain = World->GetSubsystem<UTerrainHeightfieldSubsystem>();
+		if (Terrain && !Terrain->GetHeightfield().IsValid())
+		{
+			return;
+		}
+
+		bChecked = true;
+		if (World->IsGameWorld() && FParse::Param(FCommandLine::Get(), TEXT("FlightBenchmark")))
+		{
+			bExitWhenDone = true;
+			StartBenchmark();
+		}
+		return;
+	}
+
+	const float Now = World->GetTimeSeconds();
+	const double PlatformNow = FPlatformTime::Seconds();
+	if (Now >= SampleStartTime)
+	{
+		// Wall clock rather than DeltaTime, which -benchmark fixes
+		FrameTimes.Add((PlatformNow - LastTickTime) * 1000.0);
+		GameThreadTimes.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+		PhysicsWaitTimes.Add(PhysicsWaitThisFrame);
+
+		if (PlatformNow - LastMemorySampleTime >= MemorySampleInterval)
+		{
+			LastMemorySampleTime = PlatformNow;
+			MemoryUsage.Add(FlightBenchmark::GetUsedMemoryMB());
+		}
+	}
+	LastTickTime = PlatformNow;
+	PhysicsWaitThisFrame = 0.f;
+
+	if (Now >= SampleEndTime)
+	{
+		FinishBenchmark();
+		return;
+	}
+
+	ScriptTraffic(Now);
+}
+
+void UFlightBenchmarkSubsystem::MarkPhysics(bool bEnd)
+{
+	if (!bEnd)
+	{
+		PhysicsWaitStart = FPlatformTime::Seconds();
+	}
+	else if (PhysicsWaitStart > 0.0)
+	{
+		PhysicsWaitThisFrame += (FPlatformTime::Seconds() - PhysicsWaitStart) * 1000.0;
+		PhysicsWaitStart = 0.0;
+	}
+}
+
+void UFlightBenchmarkSubsystem::StartBenchmark()
+{
+	UWorld* World = GetWorld();
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("BenchmarkAircraft="), NumAircraft);
+	FParse::Value(CommandLine, TEXT("BenchmarkBTRs="), NumBTRs);
+	FParse::Value(CommandLine, TEXT("BenchmarkSeconds="), Duration);
+	if (!FParse::Value(CommandLine, TEXT("BenchmarkOutput="), OutputFilename))
+	{
+		OutputFilename = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("FlightBenchmark_%s_%s.json"), *World->GetMapName(), *FDateTime::Now().ToString());
+	}
+
+	// Everything circles the player start, or wherever the player already is
+	const FVector Center = FScriptedTraffic::FindCenter(World);
+	AircraftAmmo = FScriptedTraffic::GetAircraftClass(World)->GetDefaultObject<AFirstProjectPawn>()->MGunAmmo;
+
+	FScriptedAircraftRing Ring;
+	Ring.NumAircraft = NumAircraft;
+	Ring.Radius = AircraftRingRadius;
+	Ring.Altitude = AircraftAltitude;
+	Ring.AltitudeStep = AircraftAltitudeStep;
+	Ring.Input.Yaw = TurnYawInput;
+	Ring.Input.Up = TurnUpInput;
+	FScriptedTraffic::SpawnAircraftRing(World, Center, Ring, Aircraft);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	const int32 NumWaypoints = FMath::Max(3, BTRLoopWaypoints);
+	for (int32 Index = 0; Index < NumBTRs; Index++)
+	{
+		const float Angle = 2.f * PI * Index / NumBTRs;
+		const FVector LoopCenter = Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * AircraftRingRadius;
+
+		TArray<FVector> Loop;
+		for (int32 Waypoint = 0; Waypoint <= NumWaypoints; Waypoint++)
+		{
+			const float WaypointAngle = 2.f * PI * Waypoint / NumWaypoints;
+			FVector Location = LoopCenter + FVector(FMath::Cos(WaypointAngle), FMath::Sin(WaypointAngle), 0.f) * BTRLoopRadius;
+			Location.Z = FScriptedTraffic::GetGroundHeight(World, Location.X, Location.Y, Center.Z);
+			Loop.Add(Location);
+		}
+
+		if (ABTR* Vehicle = World->SpawnActor<ABTR>(ABTR::StaticClass(), Loop[0], FRotator(0.f, FMath::RadiansToDegrees(Angle) + 90.f, 0.f), SpawnParams))
+		{
+			Vehicle->DriveAlong(Loop);
+			BTRs.Add(Vehicle);
+			BTRLoops.Add(MoveTemp(Loop));
+		}
+	}
+
+	// Measure the game thread's wait for physics: the start marker runs just before the engine's end of physics, the end marker just after
+	PhysicsStartTick.Target = this;
+	PhysicsStartTick.bEnd = false;
+	PhysicsStartTick.bCanEverTick = true;
+	PhysicsStartTick.TickGroup = TG_EndPhysics;
+	PhysicsStartTick.RegisterTickFunction(World->PersistentLevel);
+	World->EndPhysicsTickFunction.AddPrerequisite(this, PhysicsStartTick);
+
+	PhysicsEndTick.Target = this;
+	PhysicsEndTick.bEnd = true;
+	PhysicsEndTick.bCanEverTick = true;
+	PhysicsEndTick.TickGroup = TG_EndPhysics;
+	PhysicsEndTick.RegisterTickFunction(World->PersistentLevel);
+	PhysicsEndTick.AddPrerequisite(World, World->EndPhysicsTickFunction);
+
+	GarbageCollectTimer.Start([this](float GarbageCollectTime)
+	{
+		UWorld* TimedWorld = GetWorld();
+		if (TimedWorld && TimedWorld->GetTimeSeconds() >= SampleStartTime)
+		{
+			GarbageCollectTimes.Add(GarbageCollectTime);
+		}
+	});
+
+	const float Now = World->GetTimeSeconds();
+	SampleStartTime = Now + WarmupTime;
+	SampleEndTime = SampleStartTime + Duration;
+	LastTickTime = FPlatformTime::Seconds();
+	LastMemorySampleTime = 0.0;
+	bRunning = true;
+
+	UE_LOG(LogFlying, Log, TEXT("Flight benchmark started with %d aircraft and %d BTRs, sampling %.0f s after %.0f s of warmup"), Aircraft.Num(), BTRs.Num(), Duration, WarmupTime);
+}
+
+void UFlightBenchmarkSubsystem::ScriptTraffic(float Now)
+{
+	// Bursts are staggered across the aircraft so the cannon load stays steady rather than pulsing
+	const float Cycle = FMath::Max(KINDA_SMALL_NUMBER, BurstTime + BurstPause);
+	for (int32 Index = 0; Index < Aircraft.Num(); Index++)
+	{
+		AFirstProjectPawn* Pawn = Aircraft[Index];
+		if (Pawn == nullptr || Pawn->IsPendingKill())
+		{
+			continue;
+		}
+
+		const float Phase = FMath::Fmod(Now - SampleStartTime + Cycle * (1.f + float(Index) / Aircraft.Num()), Cycle);
+		const bool bFiring = Phase < BurstTime;
+		if (!bFiring)
+		{
+			Pawn->MGunAmmo = AircraftAmmo;
+		}
+		Pawn->SetScriptedMGunFiring(bFiring);
+	}
+
+	for (int32 Index = 0; Index < BTRs.Num(); Index++)
+	{
+		if (BTRs[Index] && !BTRs[Index]->IsPendingKill() && BTRs[Index]->IsParked())
+		{
+			BTRs[Index]->DriveAlong(BTRLoops[Index]);
+		}
+	}
+}
+
+void UFlightBenchmarkSubsystem::FinishBenchmark()
+{
+	bRunning = false;
+
+	if (WriteResults(OutputFilename))
+	{
+		UE_LOG(LogFlying, Log, TEXT("Flight benchmark finished after %d frames, results written to %s"), FrameTimes.Num(), *OutputFilename);
+	}
+	else
+	{
+		UE_LOG(LogFlying, Error, TEXT("Flight benchmark finished but its results cannot be written to %s"), *OutputFilename);
+	}
+
+	GetWorld()->EndPhysicsTickFunction.RemovePrerequisite(this, PhysicsStartTick);
+	PhysicsStartTick.UnRegisterTickFunction();
+	PhysicsEndTick.UnRegisterTickFunction();
+	GarbageCollectTimer.Stop();
+
+	for (AFirstProjectPawn* Pawn : Aircraft)
+	{
+		if (Pawn)
+		{
+			Pawn->Destroy();
+		}
+	}
+	for (ABTR* Vehicle : BTRs)
+	{
+		if (Vehicle)
+		{
+			Vehicle->Destroy();
+		}
+	}
+	Aircraft.Empty();
+	BTRs.Empty();
+	BTRLoops.Empty();
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+bool UFlightBenchmarkSubsystem::WriteResults(const FString& Filename) const
+{
+	int32 NumHitches = 0;
+	float MaxFrameTime = 0.f;
+	for (float FrameTime : FrameTimes)
+	{
+		NumHitches += FrameTime > HitchThreshold ? 1 : 0;
+		MaxFrameTime = FMath::Max(MaxFrameTime, FrameTime);
+	}
+
+	float TotalGarbageCollectTime = 0.f;
+	for (float Time : GarbageCollectTimes)
+	{
+		TotalGarbageCollectTime += Time;
+	}
+
+	TSharedRef<FJsonObject> Root = FScriptedTraffic::MakeReport(GetWorld());
+	Root->SetStringField(TEXT("build"), FApp::GetBuildVersion());
+	Root->SetNumberField(TEXT("changelist"), FEngineVersion::Current().GetChangelist());
+	Root->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+	Root->SetNumberField(TEXT("aircraft"), Aircraft.Num());
+	Root->SetNumberField(TEXT("btrs"), BTRs.Num());
+	Root->SetNumberField(TEXT("durationSeconds"), Duration);
+	Root->SetNumberField(TEXT("frames"), FrameTimes.Num());
+
+	Root->SetObjectField(TEXT("frameTimeMs"), FlightBenchmark::Summarize(FrameTimes));
+	Root->SetObjectField(TEXT("gameThreadMs"), FlightBenchmark::Summarize(GameThreadTimes));
+	Root->SetObjectField(TEXT("physicsWaitMs"), FlightBenchmark::Summarize(PhysicsWaitTimes));
+
+	TSharedRef<FJsonObject> Hitches = MakeShared<FJsonObject>();
+	Hitches->SetNumberField(TEXT("thresholdMs"), HitchThreshold);
+	Hitches->SetNumberField(TEXT("count"), NumHitches);
+	Hitches->SetNumberField(TEXT("maxMs"), MaxFrameTime);
+	Root->SetObjectField(TEXT("hitches"), Hitches);
+
+	TSharedRef<FJsonObject> GarbageCollection = FlightBenchmark::Summarize(GarbageCollectTimes);
+	GarbageCollection->SetNumberField(TEXT("totalMs"), TotalGarbageCollectTime);
+	Root->SetObjectField(TEXT("gcPauseMs"), GarbageCollection);
+
+	TSharedRef<FJsonObject> Memory = FlightBenchmark::Summarize(MemoryUsage);
+	Memory->SetNumberField(TEXT("startMB"), MemoryUsage.Num() > 0 ? MemoryUsage[0] : 0.f);
+	Memory->SetNumberField(TEXT("endMB"), MemoryUsage.Num() > 0 ? MemoryUsage.Last() : 0.f);
+	Root->SetObjectField(TEXT("usedPhysicalMB"), Memory);
+
+	return FScriptedTraffic::WriteReport(Root, Filename);
+}
@@ -0,0 +1,196 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/EngineBaseTypes.h"
+#include "ScriptedTraffic.h"
+#include "FlightBenchmarkSubsystem.generated.h"
+
+class UFlightBenchmarkSubsystem;
+class AFirstProjectPawn;
+class ABTR;
+
+/** Marks the start or the end of the game thread's wait for the physics scene */
+USTRUCT()
+struct FBenchmarkPhysicsTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UFlightBenchmarkSubsystem* Target = nullptr;
+
+	/** Whether this runs after the physics results are fetched rather than before */
+	bool bEnd = false;
+
+	// Begin FTickFunction overrides
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	// End FTickFunction overrides
+};
+
+template<>
+struct TStructOpsTypeTraits<FBenchmarkPhysicsTickFunction> : public TStructOpsTypeTraitsBase2<FBenchmarkPhysicsTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Repeatable flythrough benchmark, started by -FlightBenchmark on the command line of a game run, for example
+ *   FirstProject LakeCanyonTest -game -nullrhi -benchmark -fps=60 -unattended -FlightBenchmark
+ * Spawns scripted aircraft circling above the player start in cannon bursts and BTRs lapping below them, waits out
+ * a warmup, then samples frame, game thread, physics wait, memory and garbage collection times for a fixed duration.
+ * The results are written as JSON for tracking across builds, and the game exits.
+ * -BenchmarkAircraft=, -BenchmarkBTRs=, -BenchmarkSeconds= and -BenchmarkOutput= override the config.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UFlightBenchmarkSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UFlightBenchmarkSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Called by the physics markers */
+	void MarkPhysics(bool bEnd);
+
+private:
+	/** Spawns the scripted traffic and starts the warmup */
+	void StartBenchmark();
+
+	/** Writes the results, removes the traffic and exits if the command line started the run */
+	void FinishBenchmark();
+
+	/** Steers the aircraft, presses and releases their triggers and sends parked BTRs round again */
+	void ScriptTraffic(float Now);
+
+	/** Writes the results as JSON to Filename */
+	bool WriteResults(const FString& Filename) const;
+
+	/** Scripted aircraft spawned by a run */
+	UPROPERTY(Config)
+	int32 NumAircraft;
+
+	/** Scripted BTRs spawned by a run */
+	UPROPERTY(Config)
+	int32 NumBTRs;
+
+	/** Seconds run before sampling starts, so loading and pool warmup stay out of the results */
+	UPROPERTY(Config)
+	float WarmupTime;
+
+	/** Seconds sampled */
+	UPROPERTY(Config)
+	float Duration;
+
+	/** Distance of the aircraft start points from the player start, in cm */
+	UPROPERTY(Config)
+	float AircraftRingRadius;
+
+	/** Height of the lowest aircraft above the ground, in cm */
+	UPROPERTY(Config)
+	float AircraftAltitude;
+
+	/** Height between the start points of two aircraft, in cm */
+	UPROPERTY(Config)
+	float AircraftAltitudeStep;
+
+	/** Yaw axis held by the aircraft, they fly a steady circle */
+	UPROPERTY(Config)
+	float TurnYawInput;
+
+	/** Pitch axis held by the aircraft, balances the nose drop of the turn */
+	UPROPERTY(Config)
+	float TurnUpInput;
+
+	/** Seconds each cannon burst lasts */
+	UPROPERTY(Config)
+	float BurstTime;
+
+	/** Seconds between two cannon bursts */
+	UPROPERTY(Config)
+	float BurstPause;
+
+	/** Radius of the loop the BTRs drive, in cm */
+	UPROPERTY(Config)
+	float BTRLoopRadius;
+
+	/** Waypoints around the BTR loop */
+	UPROPERTY(Config)
+	int32 BTRLoopWaypoints;
+
+	/** Seconds between two memory samples */
+	UPROPERTY(Config)
+	float MemorySampleInterval;
+
+	/** Frames longer than this count as hitches, in ms */
+	UPROPERTY(Config)
+	float HitchThreshold;
+
+	/** Whether a run has been looked for in this world */
+	bool bChecked;
+
+	/** Whether the traffic is out and the run is in progress */
+	bool bRunning;
+
+	/** Whether the run was started from the command line, which then exits when it is done */
+	bool bExitWhenDone;
+
+	/** World time sampling starts and ends */
+	float SampleStartTime;
+	float SampleEndTime;
+
+	/** Where the results go */
+	FString OutputFilename;
+
+	UPROPERTY()
+	TArray<AFirstProjectPawn*> Aircraft;
+
+	UPROPERTY()
+	TArray<ABTR*> BTRs;
+
+	/** Loop each BTR drives */
+	TArray<TArray<FVector>> BTRLoops;
+
+	/** Ammunition given back to the aircraft at every burst */
+	int32 AircraftAmmo;
+
+	/** Platform time of the previous tick */
+	double LastTickTime;
+
+	/** Platform time the physics wait of this frame started */
+	double PhysicsWaitStart;
+
+	/** Physics wait accumulated this frame, in ms */
+	float PhysicsWaitThisFrame;
+
+	/** Platform time of the last memory sample */
+	double LastMemorySampleTime;
+
+	/** Samples, in ms and MB */
+	TArray<float> FrameTimes;
+	TArray<float> GameThreadTimes;
+	TArray<float> PhysicsWaitTimes;
+	TArray<float> MemoryUsage;
+	TArray<float> GarbageCollectTimes;
+
+	FBenchmarkPhysicsTickFunction PhysicsStartTick;
+	FBenchmarkPhysicsTickFunction PhysicsEndTick;
+
+	FGarbageCollectTimer GarbageCollectTimer;
+};
@@ -0,0 +1,326 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "GroundVehicleSubsystem.h"
+#include "TerrainHeightfieldSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Algo/BinarySearch.h"
+
+namespace GroundVehicle
+{
+	/** Packs a spatial hash cell into one sortable key */
+	static FORCEINLINE uint64 CellKey(int32 CellX, int32 CellY)
+	{
+		return (uint64(uint32(CellX)) << 32) | uint64(uint32(CellY));
+	}
+}
+
+UGroundVehicleSubsystem::UGroundVehicleSubsystem()
+{
+	NumMoving = 0;
+}
+
+void UGroundVehicleSubsystem::Deinitialize()
+{
+	Vehicles.Empty();
+	VehicleSlots.Empty();
+	Params.Empty();
+	Locations.Empty();
+	Headings.Empty();
+	Speeds.Empty();
+	Paths.Empty();
+	NextWaypoints.Empty();
+	Parked.Empty();
+	MovingIndices.Empty();
+	TerrainPoints.Empty();
+	TerrainHeights.Empty();
+	CellEntries.Empty();
+	NumMoving = 0;
+
+	Super::Deinitialize();
+}
+
+bool UGroundVehicleSubsystem::IsTickable() const
+{
+	return NumMoving > 0;
+}
+
+ETickableTickType UGroundVehicleSubsystem::GetTickableTickType() const
+{
+	// The class default object never simulates anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UGroundVehicleSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UGroundVehicleSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGroundVehicleSubsystem, STATGROUP_Tickables);
+}
+
+void UGroundVehicleSubsystem::AddVehicle(AActor* Vehicle, const FGroundVehicleParams& InParams)
+{
+	if (Vehicle == nullptr || VehicleSlots.Contains(Vehicle))
+	{
+		return;
+	}
+
+	Vehicles.Add(Vehicle);
+	VehicleSlots.Add(Vehicle);
+	Params.Add(InParams);
+	Locations.Add(Vehicle->GetActorLocation());
+	Headings.Add(Vehicle->GetActorRotation().Yaw);
+	Speeds.Add(0.f);
+	Paths.AddDefaulted();
+	NextWaypoints.Add(0);
+	Parked.Add(true);
+}
+
+void UGroundVehicleSubsystem::RemoveVehicle(AActor* Vehicle)
+{
+	if (const int32* Index = VehicleSlots.Find(Vehicle))
+	{
+		RemoveVehicleAtSwap(*Index);
+	}
+}
+
+void UGroundVehicleSubsystem::RemoveVehicleAtSwap(int32 Index)
+{
+	ParkAtIndex(Index);
+
+	VehicleSlots.RemoveAtSwap(Index);
+	Vehicles.RemoveAtSwap(Index, 1, false);
+	Params.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Headings.RemoveAtSwap(Index, 1, false);
+	Speeds.RemoveAtSwap(Index, 1, false);
+	Paths.RemoveAtSwap(Index, 1, false);
+	NextWaypoints.RemoveAtSwap(Index, 1, false);
+	Parked.RemoveAtSwap(Index, 1, false);
+}
+
+void UGroundVehicleSubsystem::DriveAlong(const AActor* Vehicle, TArrayView<const FVector> Waypoints)
+{
+	const int32* Index = VehicleSlots.Find(Vehicle);
+	if (Index == nullptr || Waypoints.Num() == 0)
+	{
+		return;
+	}
+
+	Paths[*Index] = TArray<FVector>(Waypoints.GetData(), Waypoints.Num());
+	NextWaypoints[*Index] = 0;
+	if (Parked[*Index])
+	{
+		Parked[*Index] = false;
+		NumMoving++;
+	}
+}
+
+void UGroundVehicleSubsystem::Park(const AActor* Vehicle)
+{
+	if (const int32* Index = VehicleSlots.Find(Vehicle))
+	{
+		ParkAtIndex(*Index);
+	}
+}
+
+void UGroundVehicleSubsystem::ParkAtIndex(int32 Index)
+{
+	if (!Parked[Index])
+	{
+		Parked[Index] = true;
+		NumMoving--;
+	}
+	Speeds[Index] = 0.f;
+	Paths[Index].Reset();
+	NextWaypoints[Index] = 0;
+}
+
+bool UGroundVehicleSubsystem::IsParked(const AActor* Vehicle) const
+{
+	const int32* Index = VehicleSlots.Find(Vehicle);
+	return Index == nullptr || Parked[*Index];
+}
+
+float UGroundVehicleSubsystem::GetSpeed(const AActor* Vehicle) const
+{
+	const int32* Index = VehicleSlots.Find(Vehicle);
+	return Index ? Speeds[*Index] : 0.f;
+}
+
+void UGroundVehicleSubsystem::Drive(float DeltaTime)
+{
+	for (int32 Index : MovingIndices)
+	{
+		const FGroundVehicleParams& Vehicle = Params[Index];
+		const TArray<FVector>& Path = Paths[Index];
+		FVector& Location = Locations[Index];
+
+		int32& Next = NextWaypoints[Index];
+		while (Next < Path.Num() && FVector::DistSquared2D(Location, Path[Next]) < FMath::Square(Vehicle.Radius))
+		{
+			Next++;
+		}
+		if (Next >= Path.Num())
+		{
+			ParkAtIndex(Index);
+			continue;
+		}
+
+		const FVector ToTarget = Path[Next] - Location;
+		const float DesiredHeading = FMath::RadiansToDegrees(FMath::Atan2(ToTarget.Y, ToTarget.X));
+		const float HeadingError = FMath::FindDeltaAngleDegrees(Headings[Index], DesiredHeading);
+		const float MaxTurn = Vehicle.TurnRate * DeltaTime;
+		Headings[Index] = FRotator::NormalizeAxis(Headings[Index] + FMath::Clamp(HeadingError, -MaxTurn, MaxTurn));
+
+		// Slow down for sharp turns, and in time to stop at the end of the route
+		float TargetSpeed = Vehicle.MaxSpeed * FMath::Clamp(1.f - FMath::Abs(HeadingError) / 90.f, 0.25f, 1.f);
+		if (Next == Path.Num() - 1)
+		{
+			TargetSpeed = FMath::Min(TargetSpeed, FMath::Sqrt(2.f * Vehicle.Acceleration * ToTarget.Size2D()));
+		}
+		Speeds[Index] = FMath::FInterpConstantTo(Speeds[Index], TargetSpeed, DeltaTime, Vehicle.Acceleration);
+
+		float SinHeading, CosHeading;
+		FMath::SinCos(&SinHeading, &CosHeading, FMath::DegreesToRadians(Headings[Index]));
+		Location.X += CosHeading * Speeds[Index] * DeltaTime;
+		Location.Y += SinHeading * Speeds[Index] * DeltaTime;
+	}
+}
+
+void UGroundVehicleSubsystem::Separate()
+{
+	float CellSize = 1.f;
+	for (const FGroundVehicleParams& Vehicle : Params)
+	{
+		CellSize = FMath::Max(CellSize, 2.f * Vehicle.Radius);
+	}
+
+	// Hash every vehicle, parked ones included, so moving vehicles only look at their neighbours
+	CellEntries.Reset();
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		const int32 CellX = FMath::FloorToInt(Locations[Index].X / CellSize);
+		const int32 CellY = FMath::FloorToInt(Locations[Index].Y / CellSize);
+		CellEntries.Emplace(GroundVehicle::CellKey(CellX, CellY), Index);
+	}
+	CellEntries.Sort([](const TPair<uint64, int32>& A, const TPair<uint64, int32>& B) { return A.Key < B.Key; });
+
+	for (int32 Index : MovingIndices)
+	{
+		FVector& Location = Locations[Index];
+		const int32 CellX = FMath::FloorToInt(Location.X / CellSize);
+		const int32 CellY = FMath::FloorToInt(Location.Y / CellSize);
+		for (int32 OffsetY = -1; OffsetY <= 1; OffsetY++)
+		{
+			for (int32 OffsetX = -1; OffsetX <= 1; OffsetX++)
+			{
+				const uint64 Key = GroundVehicle::CellKey(CellX + OffsetX, CellY + OffsetY);
+				int32 Entry = Algo::LowerBoundBy(CellEntries, Key, [](const TPair<uint64, int32>& CellEntry) { return CellEntry.Key; });
+				for (; Entry < CellEntries.Num() && CellEntries[Entry].Key == Key; Entry++)
+				{
+					const int32 Other = CellEntries[Entry].Value;
+					if (Other == Index)
+					{
+						continue;
+					}
+
+					const FVector2D Away = FVector2D(Location - Locations[Other]);
+					const float MinDistance = Params[Index].Radius + Params[Other].Radius;
+					const float DistanceSquared = Away.SizeSquared();
+					if (DistanceSquared < FMath::Square(MinDistance) && DistanceSquared > KINDA_SMALL_NUMBER)
+					{
+						// A parked vehicle does not give way, two moving ones share the push
+						const float Distance = FMath::Sqrt(DistanceSquared);
+						const float Push = (MinDistance - Distance) * (Parked[Other] ? 1.f : 0.5f);
+						Location += FVector(Away / Distance * Push, 0.f);
+					}
+				}
+			}
+		}
+	}
+}
+
+void UGroundVehicleSubsystem::FollowTerrain()
+{
+	UTerrainHeightfieldSubsystem* Terrain = GetWorld()->GetSubsystem<UTerrainHeightfieldSubsystem>();
+	const FTerrainHeightfieldPtr Heightfield = Terrain ? Terrain->GetHeightfield() : FTerrainHeightfieldPtr();
+	const bool bHasTerrain = Heightfield.IsValid() && Heightfield->IsValid();
+
+	// Sample the centre, the front and the right side of every moving hull in one batch
+	TerrainPoints.Reset();
+	for (int32 Index : MovingIndices)
+	{
+		float SinHeading, CosHeading;
+		FMath::SinCos(&SinHeading, &CosHeading, FMath::DegreesToRadians(Headings[Index]));
+		const FVector& Location = Locations[Index];
+		TerrainPoints.Add(Location);
+		TerrainPoints.Add(Location + FVector(CosHeading, SinHeading, 0.f) * Params[Index].HalfLength);
+		TerrainPoints.Add(Location + FVector(-SinHeading, CosHeading, 0.f) * Params[Index].HalfWidth);
+	}
+	TerrainHeights.SetNumUninitialized(TerrainPoints.Num(), false);
+	if (bHasTerrain)
+	{
+		Heightfield->GetHeights(TerrainPoints, TerrainHeights);
+	}
+
+	for (int32 MovingIndex = 0; MovingIndex < MovingIndices.Num(); MovingIndex++)
+	{
+		const int32 Index = MovingIndices[MovingIndex];
+		const FGroundVehicleParams& Vehicle = Params[Index];
+		float Pitch = 0.f;
+		float Roll = 0.f;
+		if (bHasTerrain)
+		{
+			const float CentreHeight = TerrainHeights[MovingIndex * 3];
+			const float FrontHeight = TerrainHeights[MovingIndex * 3 + 1];
+			const float RightHeight = TerrainHeights[MovingIndex * 3 + 2];
+			if (CentreHeight > -MAX_flt)
+			{
+				Locations[Index].Z = CentreHeight + Vehicle.RideHeight;
+				if (FrontHeight > -MAX_flt && Vehicle.HalfLength > 0.f)
+				{
+					Pitch = FMath::RadiansToDegrees(FMath::Atan2(FrontHeight - CentreHeight, Vehicle.HalfLength));
+				}
+				if (RightHeight > -MAX_flt && Vehicle.HalfWidth > 0.f)
+				{
+					Roll = -FMath::RadiansToDegrees(FMath::Atan2(RightHeight - CentreHeight, Vehicle.HalfWidth));
+				}
+			}
+		}
+
+		if (AActor* Actor = Vehicles[Index].Get())
+		{
+			Actor->SetActorLocationAndRotation(Locations[Index], FRotator(Pitch, Headings[Index], Roll), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+}
+
+void UGroundVehicleSubsystem::Tick(float DeltaTime)
+{
+	// Drop vehicles whose actor has gone, walking backwards so the swap does not skip any
+	for (int32 Index = Vehicles.Num() - 1; Index >= 0; Index--)
+	{
+		if (!Vehicles[Index].IsValid())
+		{
+			RemoveVehicleAtSwap(Index);
+		}
+	}
+
+	MovingIndices.Reset();
+	for (int32 Index = 0; Index < Parked.Num(); Index++)
+	{
+		if (!Parked[Index])
+		{
+			MovingIndices.Add(Index);
+		}
+	}
+
+	// Vehicles that arrive this frame still get their final transform written
+	Drive(DeltaTime);
+	Separate();
+	FollowTerrain();
+}
@@ -0,0 +1,131 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ActorSlotMap.h"
+#include "GroundVehicleSubsystem.generated.h"
+
+/** Driving limits of a ground vehicle */
+struct FGroundVehicleParams
+{
+	/** Top road speed, in cm/s */
+	float MaxSpeed = 2200.f;
+
+	/** Speed gained or lost per second, in cm/s */
+	float Acceleration = 300.f;
+
+	/** Heading change at any speed, in degrees per second */
+	float TurnRate = 30.f;
+
+	/** Radius kept clear of other vehicles */
+	float Radius = 400.f;
+
+	/** Distance from the centre to the front and side terrain samples used to tilt the hull */
+	float HalfLength = 350.f;
+	float HalfWidth = 150.f;
+
+	/** Height of the actor origin above the terrain */
+	float RideHeight = 0.f;
+};
+
+/**
+ * Drives ground vehicles in bulk instead of one movement component each.
+ * Every vehicle's state lives in parallel arrays. Moving vehicles steer along their waypoints, follow the
+ * terrain from the baked heightfield, and are only pushed apart when they come within reach of another vehicle.
+ * Parked vehicles cost nothing per frame beyond being an obstacle, and the subsystem stops ticking when all are parked.
+ */
+UCLASS()
+class FIRSTPROJECT_API UGroundVehicleSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UGroundVehicleSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Adds Vehicle parked where it stands, does nothing if it is already registered */
+	void AddVehicle(AActor* Vehicle, const FGroundVehicleParams& Params);
+
+	/** Forgets Vehicle, it stays where it was last moved */
+	void RemoveVehicle(AActor* Vehicle);
+
+	/** Drives Vehicle along Waypoints, it parks at the last one */
+	void DriveAlong(const AActor* Vehicle, TArrayView<const FVector> Waypoints);
+
+	/** Stops Vehicle where it is */
+	void Park(const AActor* Vehicle);
+
+	/** Returns whether Vehicle is standing still, true for vehicles that are not registered */
+	bool IsParked(const AActor* Vehicle) const;
+
+	/** Returns the current speed of Vehicle, in cm/s */
+	float GetSpeed(const AActor* Vehicle) const;
+
+	FORCEINLINE int32 GetNumMoving() const { return NumMoving; }
+
+private:
+	/** Removes vehicle Index, keeping VehicleSlots in line with the swap */
+	void RemoveVehicleAtSwap(int32 Index);
+
+	/** Steers and moves every moving vehicle along its path in the ground plane */
+	void Drive(float DeltaTime);
+
+	/** Pushes moving vehicles out of any vehicle they overlap */
+	void Separate();
+
+	/** Puts moving vehicles on the terrain and writes their actor transforms */
+	void FollowTerrain();
+
+	/** Marks vehicle Index as parked */
+	void ParkAtIndex(int32 Index);
+
+	/** Actor of each vehicle */
+	TArray<TWeakObjectPtr<AActor>> Vehicles;
+
+	/** Index of each vehicle's actor */
+	FActorSlotMap VehicleSlots;
+
+	TArray<FGroundVehicleParams> Params;
+
+	/** Location of each vehicle, Z follows the terrain */
+	TArray<FVector> Locations;
+
+	/** Heading of each vehicle, in degrees */
+	TArray<float> Headings;
+
+	TArray<float> Speeds;
+
+	/** Waypoints of each vehicle's route */
+	TArray<TArray<FVector>> Paths;
+
+	/** Index into Paths of each vehicle's current target */
+	TArray<int32> NextWaypoints;
+
+	TArray<bool> Parked;
+
+	/** Vehicles not parked */
+	int32 NumMoving;
+
+	/** Scratch list of the vehicles moving this frame */
+	TArray<int32> MovingIndices;
+
+	/** Scratch terrain sample points and heights, three per moving vehicle */
+	TArray<FVector> TerrainPoints;
+	TArray<float> TerrainHeights;
+
+	/** Scratch spatial hash of every vehicle, sorted by cell */
+	TArray<TPair<uint64, int32>> CellEntries;
+};
@@ -0,0 +1,130 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "GunsightSubsystem.h"
+#include "FirstProjectPawn.h"
+#include "MGunBulletManager.h"
+#include "TargetIndexSubsystem.h"
+#include "Engine/World.h"
+
+UGunsightSubsystem::UGunsightSubsystem()
+{
+	SearchHalfAngle = 60.f;
+}
+
+void UGunsightSubsystem::Deinitialize()
+{
+	ShooterSolutions.Empty();
+	TargetScratch.Empty();
+	TargetLocations.Empty();
+	TargetVelocities.Empty();
+	TargetRadii.Empty();
+
+	Super::Deinitialize();
+}
+
+const UGunsightSubsystem::FShooterSolutions& UGunsightSubsystem::Solve(AFirstProjectPawn* Shooter)
+{
+	FShooterSolutions& Cached = ShooterSolutions.FindOrAdd(Shooter);
+	if (Cached.Frame == GFrameCounter)
+	{
+		return Cached;
+	}
+
+	// Shooters that were not asked about last frame are no longer being tracked
+	for (auto It = ShooterSolutions.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || It.Value().Frame + 1 < GFrameCounter)
+		{
+			if (It.Key() != Shooter)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	FShooterSolutions& Solutions = ShooterSolutions.FindChecked(Shooter);
+	Solutions.Frame = GFrameCounter;
+	Solutions.Targets.Reset();
+	Solutions.Solutions.Reset();
+
+	// Same launch state as the rounds the pawn fires
+	FInterceptShooter Gun;
+	Gun.AimDirection = Shooter->GetActorForwardVector();
+	Gun.MuzzleLocation = Shooter->GetActorLocation() + Shooter->GetActorQuat().RotateVector(Shooter->GunOffset);
+	Gun.RoundSpeed = UMGunBulletManager::MuzzleSpeed + Shooter->CurrentForwardSpeed;
+	Gun.Gravity = FVector(0.f, 0.f, GetWorld()->GetGravityZ());
+	Gun.DispersionCone = Shooter->MGunCone;
+	Gun.MaxFlightTime = UMGunBulletManager::RoundLifeSpan;
+
+	const UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>();
+	if (TargetIndex == nullptr)
+	{
+		return Solutions;
+	}
+
+	const float Range = Gun.RoundSpeed * Gun.MaxFlightTime;
+	TargetIndex->FindTargetsInCone(Gun.MuzzleLocation, Gun.AimDirection, SearchHalfAngle, Range, TargetScratch, Shooter);
+
+	TargetLocations.Reset();
+	TargetVelocities.Reset();
+	TargetRadii.Reset();
+	for (AActor* Target : TargetScratch)
+	{
+		FVector Location, Velocity;
+		float Radius;
+		if (TargetIndex->GetTargetState(Target, Location, Velocity, Radius))
+		{
+			Solutions.Targets.Add(Target);
+			TargetLocations.Add(Location);
+			TargetVelocities.Add(Velocity);
+			TargetRadii.Add(Radius);
+		}
+	}
+
+	Solutions.Solutions.SetNumUninitialized(TargetLocations.Num());
+	FInterceptSolver::SolveBatch(Gun, TargetLocations, TargetVelocities, TargetRadii, Solutions.Solutions);
+	return Solutions;
+}
+
+void UGunsightSubsystem::GetLeadSolutions(AFirstProjectPawn* Shooter, TArray<FGunsightSolution>& OutSolutions)
+{
+	OutSolutions.Reset();
+	if (Shooter == nullptr)
+	{
+		return;
+	}
+
+	const FShooterSolutions& Solutions = Solve(Shooter);
+	for (int32 Index = 0; Index < Solutions.Targets.Num(); Index++)
+	{
+		if (AActor* Target = Solutions.Targets[Index].Get())
+		{
+			FGunsightSolution& Solution = OutSolutions.AddDefaulted_GetRef();
+			Solution.Target = Target;
+			Solution.AimPoint = Solutions.Solutions[Index].AimPoint;
+			Solution.FlightTime = Solutions.Solutions[Index].FlightTime;
+			Solution.HitProbability = Solutions.Solutions[Index].HitProbability;
+		}
+	}
+}
+
+bool UGunsightSubsystem::GetLeadSolution(AFirstProjectPawn* Shooter, AActor* Target, FGunsightSolution& OutSolution)
+{
+	if (Shooter == nullptr || Target == nullptr)
+	{
+		return false;
+	}
+
+	const FShooterSolutions& Solutions = Solve(Shooter);
+	const int32 Index = Solutions.Targets.IndexOfByKey(Target);
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutSolution.Target = Target;
+	OutSolution.AimPoint = Solutions.Solutions[Index].AimPoint;
+	OutSolution.FlightTime = Solutions.Solutions[Index].FlightTime;
+	OutSolution.HitProbability = Solutions.Solutions[Index].HitProbability;
+	return true;
+}
@@ -0,0 +1,85 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InterceptSolver.h"
+#include "GunsightSubsystem.generated.h"
+
+class AFirstProjectPawn;
+
+/** Lead solution for one target, as handed to Blueprint */
+USTRUCT(BlueprintType)
+struct FGunsightSolution
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category = Gunsight, BlueprintReadOnly)
+	AActor* Target = nullptr;
+
+	/** Point to aim the cannon at to hit Target */
+	UPROPERTY(Category = Gunsight, BlueprintReadOnly)
+	FVector AimPoint = FVector::ZeroVector;
+
+	/** Seconds a round takes to reach Target */
+	UPROPERTY(Category = Gunsight, BlueprintReadOnly)
+	float FlightTime = 0.f;
+
+	/** Chance of a round fired along the current aim hitting Target */
+	UPROPERTY(Category = Gunsight, BlueprintReadOnly)
+	float HitProbability = 0.f;
+};
+
+/**
+ * Lead computing gunsight for the cannon, shared by the HUD and AI.
+ * The first request for a shooter in a frame solves every target in range ahead of it in one batch,
+ * later requests in the same frame read the cached result.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UGunsightSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UGunsightSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	/** Returns the lead solution of every target in range ahead of Shooter */
+	UFUNCTION(BlueprintCallable, Category = Gunsight)
+	void GetLeadSolutions(AFirstProjectPawn* Shooter, TArray<FGunsightSolution>& OutSolutions);
+
+	/**
+	 * Returns the lead solution of Shooter on Target.
+	 * @return Whether Target is in range ahead of Shooter
+	 */
+	UFUNCTION(BlueprintCallable, Category = Gunsight)
+	bool GetLeadSolution(AFirstProjectPawn* Shooter, AActor* Target, FGunsightSolution& OutSolution);
+
+private:
+	/** Solutions of one shooter for one frame */
+	struct FShooterSolutions
+	{
+		uint64 Frame = 0;
+		TArray<TWeakObjectPtr<AActor>> Targets;
+		TArray<FInterceptSolution> Solutions;
+	};
+
+	/** Returns the solutions of Shooter for this frame, solving them if this is the first request */
+	const FShooterSolutions& Solve(AFirstProjectPawn* Shooter);
+
+	/** Targets further off the nose than this are not solved, in degrees */
+	UPROPERTY(Config)
+	float SearchHalfAngle;
+
+	/** Solutions by shooter */
+	TMap<TWeakObjectPtr<AFirstProjectPawn>, FShooterSolutions> ShooterSolutions;
+
+	/** Scratch target states for one batch */
+	TArray<AActor*> TargetScratch;
+	TArray<FVector> TargetLocations;
+	TArray<FVector> TargetVelocities;
+	TArray<float> TargetRadii;
+};
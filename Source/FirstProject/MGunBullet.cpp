@@ -2,24 +2,28 @@
 
 
 #include "MGunBullet.h"
+#include "FirstProject.h"
 #include "GameFramework/ProjectileMovementComponent.h"
-#include "UObject/ConstructorHelpers.h"
 #include "Components/StaticMeshComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Materials/MaterialInterface.h"
+#include "Sound/SoundBase.h"
 
 // Sets default values
 AMGunBullet::AMGunBullet()
 {
-	// Static reference to the mesh to use for the projectile
-	static ConstructorHelpers::FObjectFinder<UStaticMesh> ProjectileMeshAsset(TEXT("/Game/Effects/Sphere.Sphere"));
+	const FScopedDefaultObjectTimer ConstructTimer(this, AMGunBullet::StaticClass());
+
+	// Soft reference to the mesh to use for the projectile, set on the component once the actor is created
+	ProjectileMeshAsset = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/Effects/Sphere.Sphere")));
 
 	// Create mesh component for the projectile sphere
 	ProjectileMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("ProjectileMesh0"));
 	ProjectileMesh->SetWorldScale3D(FVector(1.f, 0.3f, 0.3f));
 	ProjectileMesh->SetCollisionProfileName("IgnoreOnlyPawn");
 	ProjectileMesh->CastShadow = false;
-	ProjectileMesh->SetStaticMesh(ProjectileMeshAsset.Object);
 	ProjectileMesh->SetupAttachment(RootComponent);
 	ProjectileMesh->BodyInstance.SetCollisionProfileName("Projectile");
 	ProjectileMesh->OnComponentHit.AddDynamic(this, &AMGunBullet::OnHit);		// set up a notification for when this component hits something
@@ -37,16 +41,96 @@ AMGunBullet::AMGunBullet()
 	// Die after 2 seconds if no collision
 	InitialLifeSpan = 2.0f;
 
+	ImpactDecalMaterial = nullptr;
+	ImpactDecalSize = FVector(10.f, 40.f, 40.f);
+	ImpactDecalLifeSpan = 10.f;
+	ImpactSound = nullptr;
+}
+
+void AMGunBullet::GetStreamedAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	OutAssets.Add(ProjectileMeshAsset.ToSoftObjectPath());
+}
+
+void AMGunBullet::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	if (ProjectileMesh->GetStaticMesh() == nullptr && !ProjectileMeshAsset.IsNull())
+	{
+		UStaticMesh* Mesh = ProjectileMeshAsset.Get();
+		if (Mesh == nullptr)
+		{
+			// Without its mesh the round would not collide, so a hitch is the lesser evil
+			UE_LOG(LogFlying, Warning, TEXT("%s was not preloaded, loading it synchronously"), *ProjectileMeshAsset.ToString());
+			Mesh = ProjectileMeshAsset.LoadSynchronous();
+		}
+		ProjectileMesh->SetStaticMesh(Mesh);
+	}
 }
 
 void AMGunBullet::SetVelocity(double vel)
 {
 	ProjectileMovement->InitialSpeed = vel + 103000.f;
 	ProjectileMovement->MaxSpeed = vel + 103000.f;
+	// Pooled rounds are already initialized, so launch them along their current facing
+	ProjectileMovement->Velocity = GetActorForwardVector() * ProjectileMovement->InitialSpeed;
 }
 
 void AMGunBullet::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	//Destroy object for now if it hits something
-	Destroy();
+	ACRL_SCOPE_CYCLE_COUNTER(RoundHit);
+	ACRL_INC_COUNTER(RoundHits, 1);
+
+	SpawnImpactEffects(GetWorld(), Hit);
+
+	//Return object to the pool for now if it hits something
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+	if (Pool == nullptr || !Pool->ReleaseActor(this))
+	{
+		Destroy();
+	}
+}
+
+void AMGunBullet::LifeSpanExpired()
+{
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+	if (Pool == nullptr || !Pool->ReleaseActor(this))
+	{
+		Super::LifeSpanExpired();
+	}
+}
+
+void AMGunBullet::OnAcquiredFromPool()
+{
+	// Movement stops simulating after a hit, so hand it the mesh again
+	ProjectileMovement->SetUpdatedComponent(ProjectileMesh);
+	ProjectileMovement->SetComponentTickEnabled(true);
+	SetLifeSpan(InitialLifeSpan);
+}
+
+void AMGunBullet::OnReleasedToPool()
+{
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->SetComponentTickEnabled(false);
+}
+
+void AMGunBullet::SpawnImpactEffects(UWorld* World, const FHitResult& Hit)
+{
+	UActorPoolSubsystem* Pool = World ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr;
+	if (Pool == nullptr)
+	{
+		return;
+	}
+
+	const AMGunBullet* Defaults = GetDefault<AMGunBullet>();
+	if (Defaults->ImpactDecalMaterial != nullptr)
+	{
+		// Decals project along their X axis, so face it into the surface
+		Pool->SpawnDecalAtLocation(Defaults->ImpactDecalMaterial, Defaults->ImpactDecalSize, Hit.ImpactPoint, (-Hit.ImpactNormal).Rotation(), Defaults->ImpactDecalLifeSpan);
+	}
+	if (Defaults->ImpactSound != nullptr)
+	{
+		Pool->PlaySoundAtLocation(Defaults->ImpactSound, Hit.ImpactPoint);
+	}
 }
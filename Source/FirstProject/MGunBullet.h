@@ -4,13 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "ActorPoolSubsystem.h"
 #include "MGunBullet.generated.h"
 
 class UProjectileMovementComponent;
 class UStaticMeshComponent;
+class UStaticMesh;
+class UMaterialInterface;
+class USoundBase;
 
 UCLASS(config=Game)
-class FIRSTPROJECT_API AMGunBullet : public AActor
+class FIRSTPROJECT_API AMGunBullet : public AActor, public IPoolableActor
 {
 	GENERATED_BODY()
 
@@ -32,6 +36,42 @@ public:
 	UFUNCTION()
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+	/** Places the impact decal and sound for a round hitting something, shared with the bullet manager */
+	static void SpawnImpactEffects(UWorld* World, const FHitResult& Hit);
+
+	/** Appends the soft referenced assets rounds load in the background, for the game mode to preload */
+	void GetStreamedAssets(TArray<FSoftObjectPath>& OutAssets) const;
+
+	// Begin AActor overrides
+	virtual void PostInitializeComponents() override;
+	virtual void LifeSpanExpired() override;
+	// End AActor overrides
+
+	// Begin IPoolableActor overrides
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+	// End IPoolableActor overrides
+
+	/** Round model, which is also what collides, so it is loaded on the spot if the preload has not brought it in */
+	UPROPERTY(Category = Projectile, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> ProjectileMeshAsset;
+
+	/** Decal left where a round hits, built from BulletDecal_D */
+	UPROPERTY(Category = Impact, Config, EditDefaultsOnly)
+	UMaterialInterface* ImpactDecalMaterial;
+
+	/** Size of the impact decal */
+	UPROPERTY(Category = Impact, Config, EditDefaultsOnly)
+	FVector ImpactDecalSize;
+
+	/** Seconds before the impact decal is returned to the pool */
+	UPROPERTY(Category = Impact, Config, EditDefaultsOnly)
+	float ImpactDecalLifeSpan;
+
+	/** One-shot sound played where a round hits */
+	UPROPERTY(Category = Impact, Config, EditDefaultsOnly)
+	USoundBase* ImpactSound;
+
 
 	/** Returns ProjectileMesh subobject **/
 	FORCEINLINE UStaticMeshComponent* GetProjectileMesh() const { return ProjectileMesh; }
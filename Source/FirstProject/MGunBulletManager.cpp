@@ -0,0 +1,425 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MGunBulletManager.h"
+#include "FirstProject.h"
+#include "MGunBullet.h"
+#include "Engine/World.h"
+#include "TargetIndexSubsystem.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+const float UMGunBulletManager::MuzzleSpeed = 103000.f;
+const float UMGunBulletManager::RoundLifeSpan = 2.0f;
+
+UMGunBulletManager::UMGunBulletManager()
+{
+	StaticSweepSegments = 4;
+	MoverQueryCellSize = 50000.f;
+	TargetQueryMargin = 5000.f;
+	TracerScale = FVector(1.f, 0.3f, 0.3f);
+	Gravity = FVector::ZeroVector;
+	TracerHost = nullptr;
+}
+
+void UMGunBulletManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UMGunBulletManager::OnLevelsChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UMGunBulletManager::OnLevelsChanged);
+}
+
+void UMGunBulletManager::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	DEC_DWORD_STAT_BY(STAT_ACRL_LiveRounds, Origins.Num());
+
+	Origins.Empty();
+	Velocities.Empty();
+	SpawnTimes.Empty();
+	ImpactTimes.Empty();
+	ImpactPoints.Empty();
+	ImpactNormals.Empty();
+	HitsStatic.Empty();
+	CheckedTimes.Empty();
+	Owners.Empty();
+	MovingTargetBounds.Empty();
+	MoverQueryCells.Empty();
+	TracerTypes.Empty();
+	TracerComponents.Empty();
+	TracerTransforms.Empty();
+	TracerHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool UMGunBulletManager::IsTickable() const
+{
+	return Origins.Num() > 0;
+}
+
+ETickableTickType UMGunBulletManager::GetTickableTickType() const
+{
+	// The class default object never simulates anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UMGunBulletManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UMGunBulletManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMGunBulletManager, STATGROUP_Tickables);
+}
+
+void UMGunBulletManager::SpawnRound(const FVector& Location, const FVector& Velocity, AActor* RoundOwner, float TimeIntoFrame, UStaticMesh* TracerMesh)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	Gravity = FVector(0.f, 0.f, World->GetGravityZ());
+	const float SpawnTime = World->GetTimeSeconds() - World->GetDeltaSeconds() + TimeIntoFrame;
+
+	Origins.Add(Location);
+	Velocities.Add(Velocity);
+	SpawnTimes.Add(SpawnTime);
+	CheckedTimes.Add(SpawnTime);
+	Owners.Add(RoundOwner);
+	TracerTypes.Add(TracerMesh ? FindOrAddTracerType(TracerMesh) : INDEX_NONE);
+	INC_DWORD_STAT(STAT_ACRL_LiveRounds);
+
+	ImpactTimes.Add(SpawnTime + RoundLifeSpan);
+	HitsStatic.Add(false);
+	ImpactPoints.Add(FVector::ZeroVector);
+	ImpactNormals.Add(FVector::UpVector);
+
+	// Sweep the whole arc against static geometry now
+	SolveStaticArc(Origins.Num() - 1, SpawnTime);
+}
+
+void UMGunBulletManager::SolveStaticArc(int32 Index, float FromTime)
+{
+	ACRL_SCOPE_CYCLE_COUNTER(RoundArcSweep);
+
+	// A few chords of the parabola over what is left of the round's life
+	const float EndTime = SpawnTimes[Index] + RoundLifeSpan;
+	const int32 NumSegments = FMath::Max(1, StaticSweepSegments);
+	const float SegmentTime = (EndTime - FromTime) / NumSegments;
+	const FCollisionObjectQueryParams StaticObjects(ECC_WorldStatic);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MGunBulletArcSweep), false, Owners[Index].Get());
+	FHitResult Hit;
+
+	ImpactTimes[Index] = EndTime;
+	HitsStatic[Index] = false;
+	FVector SegmentStart = GetRoundLocation(Index, FromTime);
+	for (int32 Segment = 0; Segment < NumSegments; Segment++)
+	{
+		const FVector SegmentEnd = GetRoundLocation(Index, FromTime + SegmentTime * (Segment + 1));
+		ACRL_INC_COUNTER(Sweeps, 1);
+		if (GetWorld()->LineTraceSingleByObjectType(Hit, SegmentStart, SegmentEnd, StaticObjects, QueryParams))
+		{
+			// Time along the chord is a close enough estimate of time along the arc
+			ImpactTimes[Index] = FromTime + SegmentTime * (Segment + Hit.Time);
+			HitsStatic[Index] = true;
+			ImpactPoints[Index] = Hit.ImpactPoint;
+			ImpactNormals[Index] = Hit.ImpactNormal;
+			break;
+		}
+		SegmentStart = SegmentEnd;
+	}
+}
+
+void UMGunBulletManager::OnLevelsChanged(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	// Geometry may now stand in an arc that was clear, or an impact may be scheduled on geometry that is gone
+	for (int32 Index = 0; Index < Origins.Num(); Index++)
+	{
+		SolveStaticArc(Index, CheckedTimes[Index]);
+	}
+}
+
+void UMGunBulletManager::RemoveRoundAtSwap(int32 Index)
+{
+	Origins.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	SpawnTimes.RemoveAtSwap(Index, 1, false);
+	ImpactTimes.RemoveAtSwap(Index, 1, false);
+	ImpactPoints.RemoveAtSwap(Index, 1, false);
+	ImpactNormals.RemoveAtSwap(Index, 1, false);
+	HitsStatic.RemoveAtSwap(Index, 1, false);
+	CheckedTimes.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+	TracerTypes.RemoveAtSwap(Index, 1, false);
+	DEC_DWORD_STAT(STAT_ACRL_LiveRounds);
+}
+
+void UMGunBulletManager::HandleImpact(int32 Index, const FHitResult& Hit)
+{
+	ACRL_SCOPE_CYCLE_COUNTER(RoundHit);
+	ACRL_INC_COUNTER(RoundHits, 1);
+
+	UWorld* World = GetWorld();
+	AMGunBullet::SpawnImpactEffects(World, Hit);
+
+	if (World->GetNetMode() != NM_Client)
+	{
+		OnRoundHit.Broadcast(Hit, Owners[Index].Get());
+	}
+}
+
+void UMGunBulletManager::GatherMovingTargets(float Now)
+{
+	MovingTargetBounds.Reset();
+
+	// Targets are looked up in the target index and everything else by one overlap, once per cube of rounds
+	MoverQueryCells.Reset();
+	const float CellSize = FMath::Max(1.f, MoverQueryCellSize);
+	for (int32 Index = 0; Index < Origins.Num(); Index++)
+	{
+		const float CheckEndTime = FMath::Min(Now, ImpactTimes[Index]);
+		if (CheckEndTime <= CheckedTimes[Index])
+		{
+			continue;
+		}
+
+		const FVector SegmentStart = GetRoundLocation(Index, CheckedTimes[Index]);
+		const FVector SegmentEnd = GetRoundLocation(Index, CheckEndTime);
+		const FVector Middle = (SegmentStart + SegmentEnd) * 0.5f;
+		const FIntVector Cell(FMath::FloorToInt(Middle.X / CellSize), FMath::FloorToInt(Middle.Y / CellSize), FMath::FloorToInt(Middle.Z / CellSize));
+		FBox* CellBounds = MoverQueryCells.Find(Cell);
+		if (CellBounds == nullptr)
+		{
+			CellBounds = &MoverQueryCells.Add(Cell, FBox(ForceInit));
+		}
+		*CellBounds += SegmentStart;
+		*CellBounds += SegmentEnd;
+	}
+	if (MoverQueryCells.Num() == 0)
+	{
+		return;
+	}
+
+	// The index knows where targets were at the end of last frame, so cover the ground they make up this one
+	UWorld* World = GetWorld();
+	const UTargetIndexSubsystem* TargetIndex = World->GetSubsystem<UTargetIndexSubsystem>();
+	const float DeltaTime = World->GetDeltaSeconds();
+	TArray<AActor*> Targets;
+	TSet<const AActor*> GatheredTargets;
+
+	FCollisionObjectQueryParams OtherMovers;
+	OtherMovers.AddObjectTypesToQuery(ECC_PhysicsBody);
+	OtherMovers.AddObjectTypesToQuery(ECC_WorldDynamic);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MGunBulletMoverQuery), false);
+	TArray<FOverlapResult> Overlaps;
+	TSet<const UPrimitiveComponent*> Gathered;
+	for (const TPair<FIntVector, FBox>& Pair : MoverQueryCells)
+	{
+		if (TargetIndex)
+		{
+			Targets.Reset();
+			TargetIndex->FindTargetsInRadius(Pair.Value.GetCenter(), Pair.Value.GetExtent().Size() + TargetQueryMargin, Targets);
+			for (const AActor* Target : Targets)
+			{
+				bool bAlreadyGathered = false;
+				GatheredTargets.Add(Target, &bAlreadyGathered);
+				FVector Location, Velocity;
+				float Radius;
+				if (!bAlreadyGathered && TargetIndex->GetTargetState(Target, Location, Velocity, Radius))
+				{
+					FBox TargetBounds(Location - FVector(Radius), Location + FVector(Radius));
+					TargetBounds += TargetBounds.ShiftBy(Velocity * DeltaTime);
+					MovingTargetBounds.Add(TargetBounds);
+				}
+			}
+		}
+
+		Overlaps.Reset();
+		ACRL_INC_COUNTER(Sweeps, 1);
+		World->OverlapMultiByObjectType(Overlaps, Pair.Value.GetCenter(), FQuat::Identity, OtherMovers, FCollisionShape::MakeBox(Pair.Value.GetExtent()), QueryParams);
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			const UPrimitiveComponent* Component = Overlap.GetComponent();
+			bool bAlreadyGathered = false;
+			Gathered.Add(Component, &bAlreadyGathered);
+			if (Component && !bAlreadyGathered)
+			{
+				MovingTargetBounds.Add(Component->Bounds.GetBox());
+			}
+		}
+	}
+}
+
+int32 UMGunBulletManager::FindOrAddTracerType(UStaticMesh* TracerMesh)
+{
+	for (int32 Type = 0; Type < TracerComponents.Num(); Type++)
+	{
+		if (TracerComponents[Type] && TracerComponents[Type]->GetStaticMesh() == TracerMesh)
+		{
+			return Type;
+		}
+	}
+
+	if (TracerHost == nullptr || TracerHost->IsPendingKill())
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		TracerHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		if (TracerHost == nullptr)
+		{
+			return INDEX_NONE;
+		}
+	}
+
+	// Plain instanced rather than hierarchical: every instance moves every frame, so there is no cluster tree worth keeping
+	UInstancedStaticMeshComponent* Tracers = NewObject<UInstancedStaticMeshComponent>(TracerHost, NAME_None, RF_Transient);
+	Tracers->SetStaticMesh(TracerMesh);
+	Tracers->SetMobility(EComponentMobility::Movable);
+	Tracers->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Tracers->SetCanEverAffectNavigation(false);
+	Tracers->CastShadow = false;
+	Tracers->RegisterComponent();
+
+	TracerTransforms.AddDefaulted();
+	return TracerComponents.Add(Tracers);
+}
+
+void UMGunBulletManager::UpdateTracers(float Now)
+{
+	for (TArray<FTransform>& Transforms : TracerTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Origins.Num(); Index++)
+	{
+		const int32 Type = TracerTypes[Index];
+		if (Type != INDEX_NONE)
+		{
+			const FVector Direction = FBallistics::EvaluateVelocity(Velocities[Index], Gravity, Now - SpawnTimes[Index]);
+			TracerTransforms[Type].Emplace(Direction.Rotation(), GetRoundLocation(Index, Now), TracerScale);
+		}
+	}
+
+	for (int32 Type = 0; Type < TracerComponents.Num(); Type++)
+	{
+		UInstancedStaticMeshComponent* Tracers = TracerComponents[Type];
+		if (Tracers == nullptr)
+		{
+			continue;
+		}
+
+		// Instances are only ever added; spare ones are collapsed to zero scale so the buffer is not reallocated
+		TArray<FTransform>& Transforms = TracerTransforms[Type];
+		const int32 NumLive = Transforms.Num();
+		for (int32 Instance = Tracers->GetInstanceCount(); Instance < NumLive; Instance++)
+		{
+			Tracers->AddInstance(FTransform::Identity);
+		}
+		Transforms.SetNum(Tracers->GetInstanceCount(), false);
+		for (int32 Instance = NumLive; Instance < Transforms.Num(); Instance++)
+		{
+			Transforms[Instance] = FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+		}
+
+		if (Transforms.Num() > 0)
+		{
+			Tracers->BatchUpdateInstancesTransforms(0, Transforms, true, true, true);
+		}
+	}
+}
+
+void UMGunBulletManager::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	ACRL_SCOPE_CYCLE_COUNTER(BulletManagerTick);
+	CSV_CUSTOM_STAT(ACRL, LiveRounds, Origins.Num(), ECsvCustomStatOp::Set);
+
+	const float Now = World->GetTimeSeconds();
+	GatherMovingTargets(Now);
+
+	FCollisionObjectQueryParams MovingObjects;
+	MovingObjects.AddObjectTypesToQuery(ECC_Pawn);
+	MovingObjects.AddObjectTypesToQuery(ECC_PhysicsBody);
+	MovingObjects.AddObjectTypesToQuery(ECC_Vehicle);
+	MovingObjects.AddObjectTypesToQuery(ECC_WorldDynamic);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MGunBulletSweep), false);
+	FHitResult Hit;
+
+	// Walk backwards so swapping a dead round out does not skip any live one
+	for (int32 Index = Origins.Num() - 1; Index >= 0; Index--)
+	{
+		// Only the part of the arc covered since the last check, and never past the static impact
+		const float CheckEndTime = FMath::Min(Now, ImpactTimes[Index]);
+		if (CheckEndTime > CheckedTimes[Index] && MovingTargetBounds.Num() > 0)
+		{
+			const FVector SegmentStart = GetRoundLocation(Index, CheckedTimes[Index]);
+			const FVector SegmentEnd = GetRoundLocation(Index, CheckEndTime);
+			const FBox SegmentBounds(SegmentStart.ComponentMin(SegmentEnd), SegmentStart.ComponentMax(SegmentEnd));
+
+			bool bNearTarget = false;
+			for (const FBox& TargetBounds : MovingTargetBounds)
+			{
+				if (TargetBounds.Intersect(SegmentBounds))
+				{
+					bNearTarget = true;
+					break;
+				}
+			}
+
+			if (bNearTarget)
+			{
+				QueryParams.ClearIgnoredActors();
+				if (AActor* RoundOwner = Owners[Index].Get())
+				{
+					QueryParams.AddIgnoredActor(RoundOwner);
+				}
+
+				ACRL_INC_COUNTER(Sweeps, 1);
+				if (World->LineTraceSingleByObjectType(Hit, SegmentStart, SegmentEnd, MovingObjects, QueryParams))
+				{
+					HandleImpact(Index, Hit);
+					RemoveRoundAtSwap(Index);
+					continue;
+				}
+			}
+		}
+		CheckedTimes[Index] = CheckEndTime;
+
+		if (ImpactTimes[Index] <= Now)
+		{
+			if (HitsStatic[Index])
+			{
+				Hit.Init(GetRoundLocation(Index, ImpactTimes[Index]), ImpactPoints[Index]);
+				Hit.bBlockingHit = true;
+				Hit.ImpactPoint = ImpactPoints[Index];
+				Hit.ImpactNormal = ImpactNormals[Index];
+				HandleImpact(Index, Hit);
+			}
+			//Remove round for now if it hits something
+			RemoveRoundAtSwap(Index);
+		}
+	}
+
+	// Runs on the tick that removes the last round too, so no tracer is left behind
+	UpdateTracers(Now);
+}
@@ -0,0 +1,160 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Ballistics.h"
+#include "MGunBulletManager.generated.h"
+
+class UStaticMesh;
+class UInstancedStaticMeshComponent;
+
+/** Broadcast when a round hits something, on the server or in standalone games only */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnMGunRoundHit, const FHitResult& /*Hit*/, AActor* /*RoundOwner*/);
+
+/**
+ * Simulates cannon rounds without spawning an actor per round.
+ * Rounds only feel gravity, so their path is solved in closed form when they are fired: the arc is swept
+ * against static geometry in a few long segments and the impact is scheduled, and solved again whenever a level
+ * streams in or out. Per frame the manager only checks the part of each arc covered that frame against moving
+ * objects near it, and fires the impacts that are due.
+ * Tracers are drawn through one instanced mesh component per tracer mesh, updated in bulk once per frame.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UMGunBulletManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMGunBulletManager();
+
+	/** Muzzle velocity added to the shooter's forward speed, matches AMGunBullet */
+	static const float MuzzleSpeed;
+
+	/** Rounds are removed after this many seconds if they did not hit anything, matches AMGunBullet */
+	static const float RoundLifeSpan;
+
+	// Begin USubsystem overrides
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/**
+	 * Adds a live round and solves its arc against static geometry.
+	 * @param TimeIntoFrame	Seconds after the start of the current frame at which the round left the muzzle
+	 * @param TracerMesh	Mesh drawn along the round's path, or null for a round without a tracer
+	 */
+	void SpawnRound(const FVector& Location, const FVector& Velocity, AActor* RoundOwner, float TimeIntoFrame = 0.f, UStaticMesh* TracerMesh = nullptr);
+
+	/** Hits are authoritative only where this fires; clients simulate their rounds for visuals alone */
+	FOnMGunRoundHit OnRoundHit;
+
+	/** Returns the number of rounds currently in flight */
+	FORCEINLINE int32 GetNumLiveRounds() const { return Origins.Num(); }
+
+	/** Returns where round Index is at world time Time */
+	FORCEINLINE FVector GetRoundLocation(int32 Index, float Time) const
+	{
+		return FBallistics::EvaluateLocation(Origins[Index], Velocities[Index], Gravity, Time - SpawnTimes[Index]);
+	}
+
+private:
+	/** Removes a round by swapping the last round into its slot */
+	void RemoveRoundAtSwap(int32 Index);
+
+	/** Sweeps the rest of round Index's arc from world time FromTime against static geometry and schedules its impact */
+	void SolveStaticArc(int32 Index, float FromTime);
+
+	/** Bound to levels streaming in and out, which changes the static geometry every live arc was solved against */
+	void OnLevelsChanged(ULevel* Level, UWorld* World);
+
+	/** Plays the impact effects of round Index and reports the hit if this machine is authoritative */
+	void HandleImpact(int32 Index, const FHitResult& Hit);
+
+	/** Collects the bounds of everything a round could hit this frame that is not solved for at fire time */
+	void GatherMovingTargets(float Now);
+
+	/** Returns the index of the instanced component drawing TracerMesh, creating it on first use */
+	int32 FindOrAddTracerType(UStaticMesh* TracerMesh);
+
+	/** Writes the transform of every live tracer into its instanced component */
+	void UpdateTracers(float Now);
+
+	/** Number of straight segments used to sweep a round's arc against static geometry */
+	UPROPERTY(Config)
+	int32 StaticSweepSegments;
+
+	/** Rounds are grouped into cubes this wide to look for moving objects near them, in cm */
+	UPROPERTY(Config)
+	float MoverQueryCellSize;
+
+	/** Indexed targets whose centre is up to this far outside a cube of rounds are still looked at, in cm */
+	UPROPERTY(Config)
+	float TargetQueryMargin;
+
+	/** Scale applied to tracer meshes, matches the AMGunBullet projectile mesh */
+	UPROPERTY(Config)
+	FVector TracerScale;
+
+	/** World gravity when the last round was fired */
+	FVector Gravity;
+
+	/** Where each round left the muzzle */
+	TArray<FVector> Origins;
+
+	/** Velocity of each round as it left the muzzle */
+	TArray<FVector> Velocities;
+
+	/** World time each round left the muzzle */
+	TArray<float> SpawnTimes;
+
+	/** World time each round hits static geometry, or expires if it hits nothing */
+	TArray<float> ImpactTimes;
+
+	/** Where each round hits static geometry, valid when HitsStatic is set */
+	TArray<FVector> ImpactPoints;
+
+	/** Surface normal at each static impact */
+	TArray<FVector> ImpactNormals;
+
+	/** Whether each round's arc ends on static geometry rather than expiring in the air */
+	TArray<bool> HitsStatic;
+
+	/** World time up to which each round has been checked against moving targets */
+	TArray<float> CheckedTimes;
+
+	/** Actor that fired each round, ignored by the round's sweeps */
+	TArray<TWeakObjectPtr<AActor>> Owners;
+
+	/** Bounds of moving targets this frame, rounds only sweep against dynamic objects when they cross one */
+	TArray<FBox> MovingTargetBounds;
+
+	/** Index into TracerComponents for each round, INDEX_NONE for rounds without a tracer */
+	TArray<int32> TracerTypes;
+
+	/** Actor owning the tracer components */
+	UPROPERTY()
+	AActor* TracerHost;
+
+	/** One instanced component per tracer mesh */
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> TracerComponents;
+
+	/** Per tracer component, scratch transforms rebuilt every frame */
+	TArray<TArray<FTransform>> TracerTransforms;
+
+	/** Bounds of this frame's round segments in each query cube, kept to avoid reallocating every tick */
+	TMap<FIntVector, FBox> MoverQueryCells;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
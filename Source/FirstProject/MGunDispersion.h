@@ -0,0 +1,44 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Counter-based random stream for weapon dispersion.
+ * Every value is a pure function of (seed, shot index), so any round of any burst can be regenerated
+ * on another machine, in a replay or from a network fire event without sending per-round data.
+ */
+struct FMGunDispersion
+{
+	/** Number of random values consumed by one round: pitch, yaw and roll */
+	static const int32 ValuesPerShot = 3;
+
+	/** PCG output permutation applied to a single 32 bit word */
+	static FORCEINLINE uint32 Hash(uint32 Input)
+	{
+		const uint32 State = Input * 747796405u + 2891336453u;
+		const uint32 Word = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+		return (Word >> 22u) ^ Word;
+	}
+
+	/**
+	 * Fills OutOffsets with the cone offsets of NumShots consecutive shots starting at FirstShotIndex,
+	 * each axis uniform in [-Cone, Cone) degrees. Shot N takes values 3N to 3N + 2 of the stream Seed.
+	 */
+	static void GetBurstOffsets(uint32 Seed, uint32 FirstShotIndex, int32 NumShots, float Cone, TArray<FRotator>& OutOffsets)
+	{
+		OutOffsets.SetNumUninitialized(NumShots, false);
+
+		// Keep 24 bits of each hash so the value is exact in a float
+		const uint32 SeedHash = Hash(Seed);
+		const float Scale = 2.f * Cone / 16777216.f;
+		uint32 Counter = FirstShotIndex * ValuesPerShot;
+		for (FRotator& Offset : OutOffsets)
+		{
+			Offset.Pitch = float(Hash(SeedHash + Counter) >> 8) * Scale - Cone;
+			Offset.Yaw = float(Hash(SeedHash + Counter + 1) >> 8) * Scale - Cone;
+			Offset.Roll = float(Hash(SeedHash + Counter + 2) >> 8) * Scale - Cone;
+			Counter += ValuesPerShot;
+		}
+	}
+};
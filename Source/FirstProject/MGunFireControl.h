@@ -0,0 +1,59 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Frame-rate independent fire scheduler for automatic weapons.
+ * Accumulates elapsed time and reports every round owed in a frame, with each round's
+ * time offset from the start of that frame, so the weapon fires at its configured rate
+ * regardless of how often it is ticked.
+ */
+struct FMGunFireControl
+{
+	FMGunFireControl()
+		: TimeToNextShot(0.f)
+	{
+	}
+
+	/**
+	 * Advances the scheduler by one frame.
+	 * @param DeltaTime		Length of the frame in seconds
+	 * @param ShotInterval	Seconds between two rounds
+	 * @param bTriggerDown	Whether the weapon is trying to fire this frame
+	 * @param MaxShots		Upper bound on rounds to emit, e.g. the remaining ammunition
+	 * @param OutShotTimes	Receives the time of each round owed, in seconds since the start of the frame
+	 * @return Number of rounds owed this frame
+	 */
+	int32 Advance(float DeltaTime, float ShotInterval, bool bTriggerDown, int32 MaxShots, TArray<float>& OutShotTimes)
+	{
+		OutShotTimes.Reset();
+
+		if (!bTriggerDown || ShotInterval <= 0.f || MaxShots <= 0)
+		{
+			// Keep cooling down while the trigger is released so tapping it cannot beat the fire rate
+			TimeToNextShot = FMath::Max(0.f, TimeToNextShot - DeltaTime);
+			return 0;
+		}
+
+		float ShotTime = TimeToNextShot;
+		while (ShotTime < DeltaTime && OutShotTimes.Num() < MaxShots)
+		{
+			OutShotTimes.Add(ShotTime);
+			ShotTime += ShotInterval;
+		}
+		TimeToNextShot = FMath::Max(0.f, ShotTime - DeltaTime);
+
+		return OutShotTimes.Num();
+	}
+
+	/** Clears any pending cool down, the next trigger pull fires immediately */
+	void Reset()
+	{
+		TimeToNextShot = 0.f;
+	}
+
+private:
+	/** Seconds from the start of the next frame until the next round may be fired */
+	float TimeToNextShot;
+};
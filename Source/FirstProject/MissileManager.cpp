@@ -0,0 +1,405 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MissileManager.h"
+#include "ActorPoolSubsystem.h"
+#include "TargetIndexSubsystem.h"
+#include "TerrainHeightfieldSubsystem.h"
+#include "TerrainHeightfield.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/DamageType.h"
+#include "Components/AudioComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Kismet/GameplayStatics.h"
+
+UMissileManager::UMissileManager()
+{
+	InfraredMissile.Speed = 80000.f;
+	InfraredMissile.MaxAcceleration = 35000.f;
+	InfraredMissile.NavigationConstant = 4.f;
+	InfraredMissile.SeekerHalfAngle = 45.f;
+	InfraredMissile.SeekerRange = 1500000.f;
+	InfraredMissile.LifeSpan = 20.f;
+	InfraredMissile.ProximityRadius = 800.f;
+	InfraredMissile.Damage = 100.f;
+	InfraredMissile.DamageRadius = 1500.f;
+
+	RadarMissile.Speed = 120000.f;
+	RadarMissile.MaxAcceleration = 25000.f;
+	RadarMissile.NavigationConstant = 3.f;
+	RadarMissile.SeekerHalfAngle = 60.f;
+	RadarMissile.SeekerRange = 4000000.f;
+	RadarMissile.LifeSpan = 40.f;
+	RadarMissile.ProximityRadius = 1200.f;
+	RadarMissile.Damage = 100.f;
+	RadarMissile.DamageRadius = 2000.f;
+
+	SeekerInterval = 0.1f;
+	MeshScale = FVector(4.f, 0.4f, 0.4f);
+	NextSeekerTime = 0.f;
+	MeshHost = nullptr;
+}
+
+void UMissileManager::Deinitialize()
+{
+	for (const TWeakObjectPtr<UAudioComponent>& MotorSound : MotorSounds)
+	{
+		if (UAudioComponent* AudioComponent = MotorSound.Get())
+		{
+			AudioComponent->OnAudioFinishedNative.RemoveAll(this);
+		}
+	}
+
+	Guidance.Empty();
+	Seekers.Empty();
+	Locations.Empty();
+	Velocities.Empty();
+	ExpireTimes.Empty();
+	Targets.Empty();
+	TargetLocations.Empty();
+	TargetVelocities.Empty();
+	Tracking.Empty();
+	Launchers.Empty();
+	Explosions.Empty();
+	MotorSounds.Empty();
+	MeshTypes.Empty();
+	ClosestApproach.Empty();
+	ApproachTimes.Empty();
+	StepStarts.Empty();
+	TerrainHitTimes.Empty();
+	SeekerCandidates.Empty();
+	MeshComponents.Empty();
+	MeshTransforms.Empty();
+	MeshHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool UMissileManager::IsTickable() const
+{
+	return Locations.Num() > 0;
+}
+
+ETickableTickType UMissileManager::GetTickableTickType() const
+{
+	// The class default object never simulates anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UMissileManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UMissileManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMissileManager, STATGROUP_Tickables);
+}
+
+const FMissileParams& UMissileManager::GetParams(EMissileSeeker Seeker) const
+{
+	return Seeker == EMissileSeeker::Radar ? RadarMissile : InfraredMissile;
+}
+
+void UMissileManager::LaunchMissile(const FMissileLaunch& Launch)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	const FMissileParams& Params = GetParams(Launch.Seeker);
+	FMissileGuidanceParams& MissileGuidance = Guidance.AddDefaulted_GetRef();
+	MissileGuidance.Speed = Params.Speed + FMath::Max(0.f, Launch.LaunchSpeed);
+	MissileGuidance.MaxAcceleration = Params.MaxAcceleration;
+	MissileGuidance.NavigationConstant = Params.NavigationConstant;
+
+	Seekers.Add(Launch.Seeker);
+	Locations.Add(Launch.Location);
+	Velocities.Add(Launch.Direction.GetSafeNormal() * MissileGuidance.Speed);
+	ExpireTimes.Add(World->GetTimeSeconds() + Params.LifeSpan);
+	Targets.Add(Launch.Target);
+	TargetLocations.Add(Launch.Location);
+	TargetVelocities.Add(FVector::ZeroVector);
+	// Without a lock at launch the seeker looks for one at its next update
+	Tracking.Add(Launch.Target != nullptr);
+	Launchers.Add(Launch.Launcher);
+	Explosions.Add(Launch.Explosion);
+	MeshTypes.Add(Launch.Mesh ? FindOrAddMeshType(Launch.Mesh) : INDEX_NONE);
+
+	UAudioComponent* MotorSound = nullptr;
+	if (UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>())
+	{
+		MotorSound = Pool->PlaySoundAtLocation(Launch.MotorSound, Launch.Location);
+		if (MotorSound)
+		{
+			MotorSound->OnAudioFinishedNative.AddUObject(this, &UMissileManager::OnMotorSoundFinished);
+		}
+	}
+	MotorSounds.Add(MotorSound);
+}
+
+AActor* UMissileManager::FindSeekerTarget(EMissileSeeker Seeker, const FVector& Location, const FVector& Direction, const AActor* Ignore) const
+{
+	const UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>();
+	if (TargetIndex == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FMissileParams& Params = GetParams(Seeker);
+	TargetIndex->FindTargetsInCone(Location, Direction, Params.SeekerHalfAngle, Params.SeekerRange, SeekerCandidates, Ignore);
+
+	// The seeker locks whatever is closest to its boresight
+	const FVector Boresight = Direction.GetSafeNormal();
+	AActor* BestTarget = nullptr;
+	float BestAlignment = -MAX_flt;
+	for (AActor* Candidate : SeekerCandidates)
+	{
+		FVector TargetLocation, TargetVelocity;
+		float TargetRadius;
+		if (TargetIndex->GetTargetState(Candidate, TargetLocation, TargetVelocity, TargetRadius))
+		{
+			const float Alignment = FVector::DotProduct((TargetLocation - Location).GetSafeNormal(), Boresight);
+			if (Alignment > BestAlignment)
+			{
+				BestAlignment = Alignment;
+				BestTarget = Candidate;
+			}
+		}
+	}
+	return BestTarget;
+}
+
+void UMissileManager::UpdateSeekers()
+{
+	const UTargetIndexSubsystem* TargetIndex = GetWorld()->GetSubsystem<UTargetIndexSubsystem>();
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		const FMissileParams& Params = GetParams(Seekers[Index]);
+		const FVector Nose = Velocities[Index].GetSafeNormal();
+
+		// Hold the current target while it stays inside the seeker's field of view
+		bool bHolding = false;
+		FVector TargetLocation, TargetVelocity;
+		float TargetRadius;
+		if (TargetIndex && TargetIndex->GetTargetState(Targets[Index].Get(), TargetLocation, TargetVelocity, TargetRadius))
+		{
+			const FVector ToTarget = TargetLocation - Locations[Index];
+			bHolding = ToTarget.SizeSquared() <= FMath::Square(Params.SeekerRange)
+				&& FVector::DotProduct(ToTarget.GetSafeNormal(), Nose) >= FMath::Cos(FMath::DegreesToRadians(Params.SeekerHalfAngle));
+		}
+
+		if (!bHolding)
+		{
+			Targets[Index] = FindSeekerTarget(Seekers[Index], Locations[Index], Nose, Launchers[Index].Get());
+		}
+		Tracking[Index] = Targets[Index].IsValid();
+	}
+}
+
+void UMissileManager::RemoveMissileAtSwap(int32 Index)
+{
+	// Stopping the motor hands its component back to the pool
+	if (UAudioComponent* MotorSound = MotorSounds[Index].Get())
+	{
+		MotorSound->OnAudioFinishedNative.RemoveAll(this);
+		MotorSound->Stop();
+	}
+
+	Guidance.RemoveAtSwap(Index, 1, false);
+	Seekers.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	ExpireTimes.RemoveAtSwap(Index, 1, false);
+	Targets.RemoveAtSwap(Index, 1, false);
+	TargetLocations.RemoveAtSwap(Index, 1, false);
+	TargetVelocities.RemoveAtSwap(Index, 1, false);
+	Tracking.RemoveAtSwap(Index, 1, false);
+	Launchers.RemoveAtSwap(Index, 1, false);
+	Explosions.RemoveAtSwap(Index, 1, false);
+	MotorSounds.RemoveAtSwap(Index, 1, false);
+	MeshTypes.RemoveAtSwap(Index, 1, false);
+}
+
+void UMissileManager::Detonate(int32 Index, const FVector& Location)
+{
+	UWorld* World = GetWorld();
+	if (UParticleSystem* Explosion = Explosions[Index].Get())
+	{
+		UGameplayStatics::SpawnEmitterAtLocation(World, Explosion, Location, FRotator::ZeroRotator, FVector(1.f), true, EPSCPoolMethod::AutoRelease);
+	}
+
+	if (World->GetNetMode() != NM_Client)
+	{
+		const FMissileParams& Params = GetParams(Seekers[Index]);
+		AActor* Launcher = Launchers[Index].Get();
+		UGameplayStatics::ApplyRadialDamage(World, Params.Damage, Location, Params.DamageRadius, UDamageType::StaticClass(), TArray<AActor*>(),
+			Launcher, Launcher ? Launcher->GetInstigatorController() : nullptr, true);
+		OnMissileDetonated.Broadcast(Location, Targets[Index].Get(), Launcher);
+	}
+}
+
+void UMissileManager::OnMotorSoundFinished(UAudioComponent* AudioComponent)
+{
+	AudioComponent->OnAudioFinishedNative.RemoveAll(this);
+	for (TWeakObjectPtr<UAudioComponent>& MotorSound : MotorSounds)
+	{
+		if (MotorSound == AudioComponent)
+		{
+			MotorSound.Reset();
+		}
+	}
+}
+
+int32 UMissileManager::FindOrAddMeshType(UStaticMesh* Mesh)
+{
+	for (int32 Type = 0; Type < MeshComponents.Num(); Type++)
+	{
+		if (MeshComponents[Type] && MeshComponents[Type]->GetStaticMesh() == Mesh)
+		{
+			return Type;
+		}
+	}
+
+	if (MeshHost == nullptr || MeshHost->IsPendingKill())
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		MeshHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		if (MeshHost == nullptr)
+		{
+			return INDEX_NONE;
+		}
+	}
+
+	UInstancedStaticMeshComponent* Meshes = NewObject<UInstancedStaticMeshComponent>(MeshHost, NAME_None, RF_Transient);
+	Meshes->SetStaticMesh(Mesh);
+	Meshes->SetMobility(EComponentMobility::Movable);
+	Meshes->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Meshes->SetCanEverAffectNavigation(false);
+	Meshes->RegisterComponent();
+
+	MeshTransforms.AddDefaulted();
+	return MeshComponents.Add(Meshes);
+}
+
+void UMissileManager::UpdateVisuals()
+{
+	for (TArray<FTransform>& Transforms : MeshTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		const int32 Type = MeshTypes[Index];
+		if (Type != INDEX_NONE)
+		{
+			MeshTransforms[Type].Emplace(Velocities[Index].Rotation(), Locations[Index], MeshScale);
+		}
+
+		if (UAudioComponent* MotorSound = MotorSounds[Index].Get())
+		{
+			MotorSound->SetWorldLocation(Locations[Index]);
+		}
+	}
+
+	for (int32 Type = 0; Type < MeshComponents.Num(); Type++)
+	{
+		UInstancedStaticMeshComponent* Meshes = MeshComponents[Type];
+		if (Meshes == nullptr)
+		{
+			continue;
+		}
+
+		// Same as the cannon tracers: spare instances are collapsed rather than removed
+		TArray<FTransform>& Transforms = MeshTransforms[Type];
+		const int32 NumLive = Transforms.Num();
+		for (int32 Instance = Meshes->GetInstanceCount(); Instance < NumLive; Instance++)
+		{
+			Meshes->AddInstance(FTransform::Identity);
+		}
+		Transforms.SetNum(Meshes->GetInstanceCount(), false);
+		for (int32 Instance = NumLive; Instance < Transforms.Num(); Instance++)
+		{
+			Transforms[Instance] = FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+		}
+
+		if (Transforms.Num() > 0)
+		{
+			Meshes->BatchUpdateInstancesTransforms(0, Transforms, true, true, true);
+		}
+	}
+}
+
+void UMissileManager::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	const float Now = World->GetTimeSeconds();
+	if (Now >= NextSeekerTime)
+	{
+		UpdateSeekers();
+		NextSeekerTime = Now + SeekerInterval;
+	}
+
+	// Locked targets are followed every frame, a target that left the index is lost until the next seeker update
+	const UTargetIndexSubsystem* TargetIndex = World->GetSubsystem<UTargetIndexSubsystem>();
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		if (Tracking[Index])
+		{
+			float TargetRadius;
+			Tracking[Index] = TargetIndex && TargetIndex->GetTargetState(Targets[Index].Get(), TargetLocations[Index], TargetVelocities[Index], TargetRadius);
+		}
+	}
+
+	StepStarts = Locations;
+	ClosestApproach.SetNumUninitialized(Locations.Num(), false);
+	ApproachTimes.SetNumUninitialized(Locations.Num(), false);
+	FMissileGuidance::StepBatch(Guidance, Locations, Velocities, TargetLocations, TargetVelocities, Tracking, ClosestApproach, ApproachTimes, DeltaTime);
+
+	TerrainHitTimes.Init(1.f, Locations.Num());
+	if (UTerrainHeightfieldSubsystem* Terrain = World->GetSubsystem<UTerrainHeightfieldSubsystem>())
+	{
+		const FTerrainHeightfieldPtr Heightfield = Terrain->GetHeightfield();
+		if (Heightfield.IsValid())
+		{
+			Heightfield->IntersectSegments(StepStarts, Locations, TerrainHitTimes);
+		}
+	}
+
+	// Walk backwards so swapping a spent missile out does not skip any live one
+	for (int32 Index = Locations.Num() - 1; Index >= 0; Index--)
+	{
+		// The fuse goes off where the missile passed closest to the target, unless the terrain got in the way first
+		const float ApproachAlpha = DeltaTime > 0.f ? ApproachTimes[Index] / DeltaTime : 1.f;
+		if (ClosestApproach[Index] <= GetParams(Seekers[Index]).ProximityRadius && ApproachAlpha <= TerrainHitTimes[Index])
+		{
+			Detonate(Index, FMath::Lerp(StepStarts[Index], Locations[Index], ApproachAlpha));
+		}
+		else if (TerrainHitTimes[Index] < 1.f)
+		{
+			Detonate(Index, FMath::Lerp(StepStarts[Index], Locations[Index], TerrainHitTimes[Index]));
+		}
+		else if (Now >= ExpireTimes[Index])
+		{
+			Detonate(Index, Locations[Index]);
+		}
+		else
+		{
+			continue;
+		}
+		RemoveMissileAtSwap(Index);
+	}
+
+	// Runs on the tick that removes the last missile too, so no mesh is left behind
+	UpdateVisuals();
+}
@@ -0,0 +1,219 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "MissileGuidance.h"
+#include "MissileManager.generated.h"
+
+class UStaticMesh;
+class USoundBase;
+class UAudioComponent;
+class UParticleSystem;
+class UInstancedStaticMeshComponent;
+
+UENUM(BlueprintType)
+enum class EMissileSeeker : uint8
+{
+	/** Heat seeker, short ranged and narrow but agile */
+	Infrared,
+	/** Radar seeker, long ranged with a wide field of view */
+	Radar,
+};
+
+/** Performance and warhead of one kind of missile */
+USTRUCT()
+struct FMissileParams
+{
+	GENERATED_BODY()
+
+	/** Speed the missile holds on top of the launcher's forward speed, in cm/s */
+	UPROPERTY(Config)
+	float Speed = 80000.f;
+
+	/** Most lateral acceleration the airframe can pull, in cm/s^2 */
+	UPROPERTY(Config)
+	float MaxAcceleration = 30000.f;
+
+	/** Proportional navigation constant */
+	UPROPERTY(Config)
+	float NavigationConstant = 4.f;
+
+	/** Largest angle off the missile's nose at which the seeker holds or finds a target, in degrees */
+	UPROPERTY(Config)
+	float SeekerHalfAngle = 45.f;
+
+	/** Furthest the seeker sees a target, in cm */
+	UPROPERTY(Config)
+	float SeekerRange = 1500000.f;
+
+	/** Seconds before the missile self destructs */
+	UPROPERTY(Config)
+	float LifeSpan = 20.f;
+
+	/** Distance from the target at which the proximity fuse detonates the warhead, in cm */
+	UPROPERTY(Config)
+	float ProximityRadius = 800.f;
+
+	UPROPERTY(Config)
+	float Damage = 100.f;
+
+	/** Radius of the blast, in cm */
+	UPROPERTY(Config)
+	float DamageRadius = 1500.f;
+};
+
+/** Everything needed to put a missile in the air */
+struct FMissileLaunch
+{
+	EMissileSeeker Seeker = EMissileSeeker::Infrared;
+
+	AActor* Launcher = nullptr;
+
+	/** Target locked at launch, or null to let the seeker find one */
+	AActor* Target = nullptr;
+
+	FVector Location = FVector::ZeroVector;
+
+	/** Launch direction, normalized */
+	FVector Direction = FVector::ForwardVector;
+
+	/** Speed of the launcher, added to the missile's own */
+	float LaunchSpeed = 0.f;
+
+	UStaticMesh* Mesh = nullptr;
+	USoundBase* MotorSound = nullptr;
+	UParticleSystem* Explosion = nullptr;
+};
+
+/** Broadcast when a missile detonates, on the server or in standalone games only */
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnMissileDetonated, const FVector& /*Location*/, AActor* /*Target*/, AActor* /*Launcher*/);
+
+/**
+ * Flies guided missiles without an actor per missile.
+ * Missile state lives in parallel arrays and every missile in flight is guided and moved in one batch per frame.
+ * Seekers look for and hold targets through the target index a few times per second rather than every frame.
+ * Missiles detonate on their proximity fuse, on hitting the terrain, or when they run out of time.
+ * Missile bodies are drawn through one instanced mesh component per mesh, and motor sounds play on pooled audio components.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UMissileManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMissileManager();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Puts a missile in the air */
+	void LaunchMissile(const FMissileLaunch& Launch);
+
+	/** Returns the target a Seeker missile would lock looking along Direction from Location, or null */
+	AActor* FindSeekerTarget(EMissileSeeker Seeker, const FVector& Location, const FVector& Direction, const AActor* Ignore) const;
+
+	/** Returns the performance of Seeker missiles */
+	const FMissileParams& GetParams(EMissileSeeker Seeker) const;
+
+	/** Damage is applied and this fires only on the server or in standalone games */
+	FOnMissileDetonated OnMissileDetonated;
+
+	/** Returns the number of missiles in flight */
+	FORCEINLINE int32 GetNumMissiles() const { return Locations.Num(); }
+
+private:
+	/** Removes a missile by swapping the last missile into its slot */
+	void RemoveMissileAtSwap(int32 Index);
+
+	/** Plays the explosion of missile Index at Location, and applies its damage if this machine is authoritative */
+	void Detonate(int32 Index, const FVector& Location);
+
+	/** Refreshes the lock of every missile from the target index */
+	void UpdateSeekers();
+
+	/** Returns the index of the instanced component drawing Mesh, creating it on first use */
+	int32 FindOrAddMeshType(UStaticMesh* Mesh);
+
+	/** Writes the transform of every missile into its instanced component, and moves the motor sounds along */
+	void UpdateVisuals();
+
+	/** Bound to motor sounds that end before their missile does, so the pooled component is not stopped after reuse */
+	void OnMotorSoundFinished(UAudioComponent* AudioComponent);
+
+	UPROPERTY(Config)
+	FMissileParams InfraredMissile;
+
+	UPROPERTY(Config)
+	FMissileParams RadarMissile;
+
+	/** Seconds between seeker updates */
+	UPROPERTY(Config)
+	float SeekerInterval;
+
+	/** Scale applied to missile meshes */
+	UPROPERTY(Config)
+	FVector MeshScale;
+
+	/** World time of the next seeker update */
+	float NextSeekerTime;
+
+	TArray<FMissileGuidanceParams> Guidance;
+	TArray<EMissileSeeker> Seekers;
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+
+	/** World time each missile self destructs */
+	TArray<float> ExpireTimes;
+
+	/** Target of each missile, null while its seeker has nothing */
+	TArray<TWeakObjectPtr<AActor>> Targets;
+	TArray<FVector> TargetLocations;
+	TArray<FVector> TargetVelocities;
+
+	/** Whether each missile is steering for its target */
+	TArray<bool> Tracking;
+
+	/** Actor that launched each missile, never targeted by it */
+	TArray<TWeakObjectPtr<AActor>> Launchers;
+
+	TArray<TWeakObjectPtr<UParticleSystem>> Explosions;
+
+	/** Pooled audio component playing each missile's motor, if still playing */
+	TArray<TWeakObjectPtr<UAudioComponent>> MotorSounds;
+
+	/** Index into MeshComponents for each missile, INDEX_NONE for missiles without a mesh */
+	TArray<int32> MeshTypes;
+
+	/** Scratch closest approach of each missile to its target over the step, and when in the step it came */
+	TArray<float> ClosestApproach;
+	TArray<float> ApproachTimes;
+
+	/** Scratch start of each missile's step and its hit fraction against the terrain */
+	TArray<FVector> StepStarts;
+	TArray<float> TerrainHitTimes;
+
+	/** Scratch seeker candidates */
+	mutable TArray<AActor*> SeekerCandidates;
+
+	/** Actor owning the mesh components */
+	UPROPERTY()
+	AActor* MeshHost;
+
+	/** One instanced component per missile mesh */
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> MeshComponents;
+
+	/** Per mesh component, scratch transforms rebuilt every frame */
+	TArray<TArray<FTransform>> MeshTransforms;
+};
@@ -0,0 +1,371 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "PredictiveStreamingSubsystem.h"
+#include "FirstProject.h"
+#include "FirstProjectPawn.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Engine/LevelBounds.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/LevelStreamingAlwaysLoaded.h"
+#include "Engine/LevelStreamingDynamic.h"
+#include "Engine/WorldComposition.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+static FAutoConsoleCommandWithWorld LogStreamingCellsCommand(
+	TEXT("acrl.Streaming.Cells"),
+	TEXT("Logs the state of every cell streamed ahead of the aircraft in the current world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UPredictiveStreamingSubsystem* Streaming = World ? World->GetSubsystem<UPredictiveStreamingSubsystem>() : nullptr)
+		{
+			Streaming->LogCells();
+		}
+	}));
+
+namespace PredictiveStreaming
+{
+	/** Returns the bounds of everything in a loaded level */
+	static FBox GetLevelBounds(ULevel* Level)
+	{
+		if (Level->LevelBoundsActor.IsValid())
+		{
+			return Level->LevelBoundsActor->GetComponentsBoundingBox();
+		}
+
+		FBox Bounds(ForceInit);
+		for (AActor* Actor : Level->Actors)
+		{
+			if (Actor && Actor->IsLevelBoundsRelevant())
+			{
+				Bounds += Actor->GetComponentsBoundingBox(true);
+			}
+		}
+		return Bounds;
+	}
+}
+
+UPredictiveStreamingSubsystem::UPredictiveStreamingSubsystem()
+{
+	bEnabled = true;
+	PredictionTime = 6.f;
+	PredictionStep = 0.25f;
+	CorridorRadius = 50000.f;
+	CorridorGrowth = 10000.f;
+	UnloadDistance = 200000.f;
+	MaxLoadsPerFrame = 1;
+	MaxUnloadsPerFrame = 1;
+
+	bChecked = false;
+	bActive = false;
+	NumStreamingLevels = 0;
+	NumMisses = 0;
+}
+
+void UPredictiveStreamingSubsystem::Deinitialize()
+{
+	Cells.Empty();
+	SourceLocations.Empty();
+	SourceForwards.Empty();
+	Paths.Empty();
+	LoadQueue.Empty();
+	bActive = false;
+
+	Super::Deinitialize();
+}
+
+bool UPredictiveStreamingSubsystem::IsTickable() const
+{
+	return bEnabled && (!bChecked || bActive);
+}
+
+ETickableTickType UPredictiveStreamingSubsystem::GetTickableTickType() const
+{
+	// The class default object never streams anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UPredictiveStreamingSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UPredictiveStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPredictiveStreamingSubsystem, STATGROUP_Tickables);
+}
+
+void UPredictiveStreamingSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	if (!bChecked)
+	{
+		bChecked = true;
+		bActive = World->IsGameWorld() && World->WorldComposition == nullptr && PredictionStep > 0.f;
+		if (World->WorldComposition)
+		{
+			UE_LOG(LogFlying, Log, TEXT("%s uses world composition, which streams its own tiles"), *World->GetMapName());
+		}
+		if (!bActive)
+		{
+			return;
+		}
+	}
+
+	ACRL_SCOPE_CYCLE_COUNTER(PredictiveStreaming);
+
+	UpdateCells();
+	PredictPaths();
+	ScoreCells();
+	RequestStreaming();
+	DetectMisses();
+}
+
+void UPredictiveStreamingSubsystem::UpdateCells()
+{
+	UWorld* World = GetWorld();
+	const TArray<ULevelStreaming*>& StreamingLevels = World->GetStreamingLevels();
+	if (StreamingLevels.Num() != NumStreamingLevels)
+	{
+		NumStreamingLevels = StreamingLevels.Num();
+		Cells.RemoveAll([](const FCell& Cell) { return !Cell.StreamingLevel.IsValid(); });
+
+		for (ULevelStreaming* StreamingLevel : StreamingLevels)
+		{
+			// Always loaded levels never stream, and level instances are streamed by whoever spawned them
+			if (StreamingLevel == nullptr || StreamingLevel->IsA<ULevelStreamingAlwaysLoaded>() || StreamingLevel->IsA<ULevelStreamingDynamic>()
+				|| Cells.ContainsByPredicate([StreamingLevel](const FCell& Cell) { return Cell.StreamingLevel == StreamingLevel; }))
+			{
+				continue;
+			}
+
+			FCell& Cell = Cells.AddDefaulted_GetRef();
+			Cell.StreamingLevel = StreamingLevel;
+			Cell.bRequested = StreamingLevel->ShouldBeLoaded();
+			const FName PackageName = StreamingLevel->GetWorldAssetPackageFName();
+			if (const FStreamingCellBounds* Configured = CellBounds.FindByPredicate([PackageName](const FStreamingCellBounds& Entry) { return Entry.PackageName == PackageName; }))
+			{
+				Cell.Bounds = Configured->Bounds;
+			}
+			else if (!StreamingLevel->ShouldBeLoaded())
+			{
+				UE_LOG(LogFlying, Warning, TEXT("%s has no CellBounds entry and starts unloaded, it is only streamed ahead of aircraft once something else has loaded it"), *PackageName.ToString());
+			}
+		}
+	}
+
+	// Learn the bounds of cells that were not configured as soon as they are loaded
+	for (FCell& Cell : Cells)
+	{
+		ULevelStreaming* StreamingLevel = Cell.StreamingLevel.Get();
+		if (!Cell.Bounds.IsValid && StreamingLevel && StreamingLevel->GetLoadedLevel())
+		{
+			Cell.Bounds = PredictiveStreaming::GetLevelBounds(StreamingLevel->GetLoadedLevel());
+		}
+	}
+}
+
+void UPredictiveStreamingSubsystem::PredictPaths()
+{
+	SourceLocations.Reset();
+	SourceForwards.Reset();
+
+	// Every aircraft a player flies here, the server streams for all of them and a client for its own
+	const int32 NumSteps = FMath::CeilToInt(PredictionTime / PredictionStep);
+	int32 NumSources = 0;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		AFirstProjectPawn* Aircraft = PlayerController ? Cast<AFirstProjectPawn>(PlayerController->GetPawn()) : nullptr;
+		if (Aircraft == nullptr)
+		{
+			continue;
+		}
+
+		FAircraftState State;
+		State.Location = Aircraft->GetActorLocation();
+		State.Rotation = Aircraft->GetActorQuat();
+		State.Flight = Aircraft->GetFlightState();
+
+		if (Paths.Num() <= NumSources)
+		{
+			Paths.AddDefaulted();
+		}
+		FFlightModel::PredictPath(State, PredictionStep, NumSteps, Paths[NumSources]);
+		SourceLocations.Add(State.Location);
+		SourceForwards.Add(State.Rotation.GetForwardVector());
+		NumSources++;
+	}
+	Paths.SetNum(NumSources, false);
+}
+
+void UPredictiveStreamingSubsystem::ScoreCells()
+{
+	for (FCell& Cell : Cells)
+	{
+		Cell.TimeToReach = -1.f;
+		if (!Cell.Bounds.IsValid)
+		{
+			continue;
+		}
+
+		for (int32 Source = 0; Source < SourceLocations.Num(); Source++)
+		{
+			if (Cell.Bounds.ComputeSquaredDistanceToPoint(SourceLocations[Source]) <= FMath::Square(CorridorRadius))
+			{
+				Cell.TimeToReach = 0.f;
+				break;
+			}
+
+			// Points are in time order, so the first one in reach is the earliest
+			const TArray<FVector>& Path = Paths[Source];
+			const int32 NumPoints = Cell.TimeToReach < 0.f ? Path.Num() : FMath::Min(Path.Num(), FMath::CeilToInt(Cell.TimeToReach / PredictionStep));
+			for (int32 Point = 0; Point < NumPoints; Point++)
+			{
+				const float Time = (Point + 1) * PredictionStep;
+				if (Cell.Bounds.ComputeSquaredDistanceToPoint(Path[Point]) <= FMath::Square(GetCorridorRadius(Time)))
+				{
+					Cell.TimeToReach = Time;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void UPredictiveStreamingSubsystem::RequestStreaming()
+{
+	LoadQueue.Reset();
+	int32 NumUnloads = 0;
+	int32 NumLoaded = 0;
+
+	for (int32 Index = 0; Index < Cells.Num(); Index++)
+	{
+		FCell& Cell = Cells[Index];
+		ULevelStreaming* StreamingLevel = Cell.StreamingLevel.Get();
+		if (StreamingLevel == nullptr || !Cell.Bounds.IsValid)
+		{
+			continue;
+		}
+		NumLoaded += StreamingLevel->IsLevelLoaded() ? 1 : 0;
+
+		if (Cell.TimeToReach >= 0.f)
+		{
+			if (!Cell.bRequested)
+			{
+				LoadQueue.Add(Index);
+			}
+			else
+			{
+				// Cells needed sooner are processed first by level streaming
+				StreamingLevel->SetPriority(FMath::RoundToInt((PredictionTime - Cell.TimeToReach) * 10.f));
+			}
+			continue;
+		}
+
+		if (!Cell.bLoadedHere || NumUnloads >= MaxUnloadsPerFrame)
+		{
+			continue;
+		}
+
+		// Only drop what every aircraft has left behind, so a cell to the side is not thrown away and streamed back
+		bool bBehindAll = true;
+		for (int32 Source = 0; Source < SourceLocations.Num() && bBehindAll; Source++)
+		{
+			const FVector ToCell = Cell.Bounds.GetClosestPointTo(SourceLocations[Source]) - SourceLocations[Source];
+			bBehindAll = (ToCell | SourceForwards[Source]) <= 0.f && ToCell.SizeSquared() > FMath::Square(UnloadDistance);
+		}
+		if (bBehindAll && SourceLocations.Num() > 0)
+		{
+			StreamingLevel->SetShouldBeVisible(false);
+			StreamingLevel->SetShouldBeLoaded(false);
+			Cell.bRequested = false;
+			Cell.bLoadedHere = false;
+			NumUnloads++;
+		}
+	}
+
+	// Soonest first, the rest wait for the next frames
+	LoadQueue.Sort([this](int32 A, int32 B) { return Cells[A].TimeToReach < Cells[B].TimeToReach; });
+	const int32 NumLoads = FMath::Min(LoadQueue.Num(), MaxLoadsPerFrame);
+	for (int32 Queued = 0; Queued < NumLoads; Queued++)
+	{
+		FCell& Cell = Cells[LoadQueue[Queued]];
+		ULevelStreaming* StreamingLevel = Cell.StreamingLevel.Get();
+		StreamingLevel->SetPriority(FMath::RoundToInt((PredictionTime - Cell.TimeToReach) * 10.f));
+		StreamingLevel->SetShouldBeLoaded(true);
+		StreamingLevel->SetShouldBeVisible(true);
+		Cell.bRequested = true;
+		Cell.bLoadedHere = true;
+	}
+
+	ACRL_INC_COUNTER(StreamingLoads, NumLoads);
+	ACRL_INC_COUNTER(StreamingUnloads, NumUnloads);
+	SET_DWORD_STAT(STAT_ACRL_StreamingCellsLoaded, NumLoaded);
+	CSV_CUSTOM_STAT(ACRL, StreamingCellsLoaded, NumLoaded, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ACRL, StreamingQueued, LoadQueue.Num() - NumLoads, ECsvCustomStatOp::Set);
+}
+
+void UPredictiveStreamingSubsystem::DetectMisses()
+{
+	for (FCell& Cell : Cells)
+	{
+		ULevelStreaming* StreamingLevel = Cell.StreamingLevel.Get();
+		if (StreamingLevel == nullptr || Cell.TimeToReach != 0.f)
+		{
+			Cell.bMissed = false;
+			continue;
+		}
+		if (StreamingLevel->IsLevelVisible())
+		{
+			Cell.bMissed = false;
+			continue;
+		}
+
+		bool bInside = false;
+		for (const FVector& Location : SourceLocations)
+		{
+			bInside |= Cell.Bounds.IsInsideOrOn(Location);
+		}
+		if (bInside && !Cell.bMissed)
+		{
+			Cell.bMissed = true;
+			NumMisses++;
+			ACRL_INC_COUNTER(StreamingMisses, 1);
+			UE_LOG(LogFlying, Warning, TEXT("Streaming miss, flew into %s before it was visible"), *StreamingLevel->GetWorldAssetPackageName());
+		}
+	}
+}
+
+void UPredictiveStreamingSubsystem::LogCells() const
+{
+	UE_LOG(LogFlying, Log, TEXT("%d streaming cells, %d misses"), Cells.Num(), NumMisses);
+	for (const FCell& Cell : Cells)
+	{
+		const ULevelStreaming* StreamingLevel = Cell.StreamingLevel.Get();
+		if (StreamingLevel == nullptr)
+		{
+			continue;
+		}
+
+		const TCHAR* State = StreamingLevel->IsLevelVisible() ? TEXT("visible") : StreamingLevel->IsLevelLoaded() ? TEXT("loaded") : Cell.bRequested ? TEXT("loading") : TEXT("unloaded");
+		if (!Cell.Bounds.IsValid)
+		{
+			UE_LOG(LogFlying, Log, TEXT("  %s: %s, bounds unknown"), *StreamingLevel->GetWorldAssetPackageName(), State);
+		}
+		else if (Cell.TimeToReach >= 0.f)
+		{
+			UE_LOG(LogFlying, Log, TEXT("  %s: %s, reached in %.2f s"), *StreamingLevel->GetWorldAssetPackageName(), State, Cell.TimeToReach);
+		}
+		else
+		{
+			UE_LOG(LogFlying, Log, TEXT("  %s: %s, off the predicted paths"), *StreamingLevel->GetWorldAssetPackageName(), State);
+		}
+	}
+}
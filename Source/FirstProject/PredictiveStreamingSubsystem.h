@@ -0,0 +1,161 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PredictiveStreamingSubsystem.generated.h"
+
+class ULevelStreaming;
+
+/** World space bounds of a streaming level that the game cannot learn before the level has been loaded once */
+USTRUCT()
+struct FStreamingCellBounds
+{
+	GENERATED_BODY()
+
+	/** Long package name of the streaming level, /Game/Levels/LakeCanyonTest_North for example */
+	UPROPERTY()
+	FName PackageName;
+
+	UPROPERTY()
+	FBox Bounds = FBox(ForceInit);
+};
+
+/**
+ * Streams the sublevels of the world ahead of player aircraft instead of around them.
+ * Every player pawn's path is predicted PredictionTime seconds ahead from its speed and turn rates, and a cell is
+ * wanted as soon as the corridor around that path reaches it; the corridor widens with time to cover a change
+ * of course. Load requests go out soonest first, a few per frame, and cells behind the aircraft and far from any
+ * corridor are unloaded. Flying into a cell that is not visible yet counts as a streaming miss.
+ * Cells are the world's streaming levels whose bounds are known, either from CellBounds or from having been loaded;
+ * a warning is logged for every cell that starts out with neither, as nothing will stream it in ahead of time.
+ * Cells loaded by Blueprints, volumes or the level itself are never unloaded here.
+ * World composition maps are left to world composition, which streams its tiles itself.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UPredictiveStreamingSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPredictiveStreamingSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Returns how many times an aircraft has flown into a cell that was not visible yet */
+	int32 GetNumMisses() const { return NumMisses; }
+
+	/** Logs the state of every cell */
+	void LogCells() const;
+
+private:
+	/** One streaming level managed by the subsystem */
+	struct FCell
+	{
+		TWeakObjectPtr<ULevelStreaming> StreamingLevel;
+
+		/** World space bounds, invalid until known */
+		FBox Bounds = FBox(ForceInit);
+
+		/** Seconds until the earliest predicted pass through the cell, negative when no corridor reaches it */
+		float TimeToReach = -1.f;
+
+		/** Whether the cell has been asked to load, by this subsystem or by whatever loaded it before */
+		bool bRequested = false;
+
+		/** Whether this subsystem asked for the load, only such cells are ever unloaded by it */
+		bool bLoadedHere = false;
+
+		/** Whether an aircraft is inside the cell while it is not visible, counted once per entry */
+		bool bMissed = false;
+	};
+
+	/** Picks up streaming levels added since the last frame and learns the bounds of loaded ones */
+	void UpdateCells();
+
+	/** Predicts the path of every player aircraft, each ahead of its current location */
+	void PredictPaths();
+
+	/** Sets TimeToReach of every cell from the predicted paths */
+	void ScoreCells();
+
+	/** Sends out the load and unload requests of this frame, within the budgets */
+	void RequestStreaming();
+
+	/** Counts aircraft inside cells that are not visible */
+	void DetectMisses();
+
+	/** Returns the radius of the corridor Time seconds ahead */
+	float GetCorridorRadius(float Time) const { return CorridorRadius + Time * CorridorGrowth; }
+
+	/** Turn the subsystem off without removing its config */
+	UPROPERTY(Config)
+	bool bEnabled;
+
+	/** Seconds of flight predicted ahead of each aircraft */
+	UPROPERTY(Config)
+	float PredictionTime;
+
+	/** Seconds between two points of a predicted path */
+	UPROPERTY(Config)
+	float PredictionStep;
+
+	/** Radius of the corridor at the aircraft, cells this close are wanted right away, in cm */
+	UPROPERTY(Config)
+	float CorridorRadius;
+
+	/** How fast the corridor widens ahead of the aircraft, in cm per second of prediction */
+	UPROPERTY(Config)
+	float CorridorGrowth;
+
+	/** Unwanted cells are only unloaded when behind every aircraft and at least this far from all of them, in cm */
+	UPROPERTY(Config)
+	float UnloadDistance;
+
+	/** Most cells asked to load in one frame */
+	UPROPERTY(Config)
+	int32 MaxLoadsPerFrame;
+
+	/** Most cells asked to unload in one frame */
+	UPROPERTY(Config)
+	int32 MaxUnloadsPerFrame;
+
+	/** Bounds of streaming levels that are not loaded when the world starts */
+	UPROPERTY(Config)
+	TArray<FStreamingCellBounds> CellBounds;
+
+	/** Whether the world has been checked for streaming levels to manage */
+	bool bChecked;
+
+	/** Whether the world has streaming levels this subsystem manages */
+	bool bActive;
+
+	/** Streaming levels of the world when the cells were last gathered */
+	int32 NumStreamingLevels;
+
+	TArray<FCell> Cells;
+
+	/** Current location and facing of each player aircraft */
+	TArray<FVector> SourceLocations;
+	TArray<FVector> SourceForwards;
+
+	/** Predicted path of each player aircraft, PredictionStep seconds apart */
+	TArray<TArray<FVector>> Paths;
+
+	/** Cells waiting for a load request, kept to avoid reallocating every tick */
+	TArray<int32> LoadQueue;
+
+	/** Streaming misses since the world started */
+	int32 NumMisses;
+};
@@ -0,0 +1,134 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "ScriptedTraffic.h"
+#include "FirstProjectPawn.h"
+#include "TerrainHeightfieldSubsystem.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/UObjectGlobals.h"
+
+FVector FScriptedTraffic::FindCenter(UWorld* World)
+{
+	APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (PlayerController && PlayerController->GetPawn())
+	{
+		return PlayerController->GetPawn()->GetActorLocation();
+	}
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		return It->GetActorLocation();
+	}
+	return FVector::ZeroVector;
+}
+
+UClass* FScriptedTraffic::GetAircraftClass(UWorld* World)
+{
+	UClass* AircraftClass = AFirstProjectPawn::StaticClass();
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (GameMode && GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf(AircraftClass))
+	{
+		AircraftClass = GameMode->DefaultPawnClass;
+	}
+	return AircraftClass;
+}
+
+float FScriptedTraffic::GetGroundHeight(UWorld* World, float X, float Y, float Fallback)
+{
+	UTerrainHeightfieldSubsystem* Terrain = World->GetSubsystem<UTerrainHeightfieldSubsystem>();
+	const FTerrainHeightfieldPtr Heightfield = Terrain ? Terrain->GetHeightfield() : FTerrainHeightfieldPtr();
+	float Height;
+	return Heightfield.IsValid() && Heightfield->GetHeight(X, Y, Height) ? Height : Fallback;
+}
+
+void FScriptedTraffic::SpawnAircraftRing(UWorld* World, const FVector& Center, const FScriptedAircraftRing& Ring, TArray<AFirstProjectPawn*>& OutAircraft)
+{
+	UClass* AircraftClass = GetAircraftClass(World);
+	for (int32 Index = 0; Index < Ring.NumAircraft; Index++)
+	{
+		// Spread around the ring, heading along it
+		const float Angle = 2.f * PI * Index / Ring.NumAircraft;
+		FVector Location = Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * Ring.Radius;
+		Location.Z = GetGroundHeight(World, Location.X, Location.Y, Center.Z) + Ring.Altitude + Index * Ring.AltitudeStep;
+		const FTransform Transform(FRotator(0.f, FMath::RadiansToDegrees(Angle) + 90.f, 0.f), Location);
+
+		// Deferred so the round path is chosen before BeginPlay prewarms the pools for it
+		AFirstProjectPawn* Pawn = World->SpawnActorDeferred<AFirstProjectPawn>(AircraftClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (Pawn)
+		{
+			if (Ring.bOverrideUseBulletManager)
+			{
+				Pawn->bUseBulletManager = Ring.bUseBulletManager;
+			}
+			Pawn->FinishSpawning(Transform);
+
+			// An AI controller hands the pawn to the aircraft swarm; the run decides when the cannon fires, not the AI
+			Pawn->SpawnDefaultController();
+			Pawn->SetScriptedInput(Ring.Input);
+			Pawn->SetScriptedMGunFiring(false);
+			OutAircraft.Add(Pawn);
+		}
+	}
+}
+
+TSharedRef<FJsonObject> FScriptedTraffic::MakeReport(UWorld* World)
+{
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetStringField(TEXT("map"), World->GetMapName());
+	Report->SetStringField(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+	return Report;
+}
+
+bool FScriptedTraffic::WriteReport(const TSharedRef<FJsonObject>& Report, const FString& Filename)
+{
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if (!FJsonSerializer::Serialize(Report, Writer))
+	{
+		return false;
+	}
+	return FFileHelper::SaveStringToFile(Json, *Filename);
+}
+
+void FGarbageCollectTimer::Start(TFunction<void(float)> InOnCollected)
+{
+	Stop();
+	OnCollected = MoveTemp(InOnCollected);
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddRaw(this, &FGarbageCollectTimer::OnPreGarbageCollect);
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FGarbageCollectTimer::OnPostGarbageCollect);
+}
+
+void FGarbageCollectTimer::Stop()
+{
+	if (PreGarbageCollectHandle.IsValid())
+	{
+		FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+		FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+		PreGarbageCollectHandle.Reset();
+		PostGarbageCollectHandle.Reset();
+	}
+	OnCollected = nullptr;
+	CollectStart = 0.0;
+}
+
+void FGarbageCollectTimer::OnPreGarbageCollect()
+{
+	CollectStart = FPlatformTime::Seconds();
+}
+
+void FGarbageCollectTimer::OnPostGarbageCollect()
+{
+	// A collection already running when the timer started is not measured
+	if (CollectStart > 0.0 && OnCollected)
+	{
+		OnCollected((FPlatformTime::Seconds() - CollectStart) * 1000.0);
+	}
+	CollectStart = 0.0;
+}
@@ -0,0 +1,83 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FlightModel.h"
+
+class UWorld;
+class AFirstProjectPawn;
+class FJsonObject;
+
+/** A ring of scripted aircraft, all flying the same held input */
+struct FScriptedAircraftRing
+{
+	/** Number of aircraft spread evenly around the ring */
+	int32 NumAircraft = 0;
+
+	/** Distance of the start points from the center, in cm */
+	float Radius = 0.f;
+
+	/** Height of the first aircraft above the ground, in cm */
+	float Altitude = 0.f;
+
+	/** Height added for each following aircraft, in cm */
+	float AltitudeStep = 0.f;
+
+	/** Controls held by every aircraft */
+	FFlightModelInput Input;
+
+	/** Whether to set the round path of the aircraft rather than keep their class default */
+	bool bOverrideUseBulletManager = false;
+	bool bUseBulletManager = true;
+};
+
+/**
+ * Setup shared by the command line test runs, which fly scripted aircraft around the player and watch the cost.
+ */
+struct FScriptedTraffic
+{
+	/** Returns where the player is, or else the first player start, or else the origin */
+	static FVector FindCenter(UWorld* World);
+
+	/** Returns the game mode's default pawn class when it is an aircraft, so Blueprint setups are tested, or else the native aircraft */
+	static UClass* GetAircraftClass(UWorld* World);
+
+	/** Returns the height of the terrain below X, Y, or Fallback where there is no terrain or it has not been baked */
+	static float GetGroundHeight(UWorld* World, float X, float Y, float Fallback);
+
+	/**
+	 * Spawns the aircraft of Ring around Center, heading along it, each under an AI controller flying the ring's input.
+	 * @param OutAircraft	Receives the aircraft spawned
+	 */
+	static void SpawnAircraftRing(UWorld* World, const FVector& Center, const FScriptedAircraftRing& Ring, TArray<AFirstProjectPawn*>& OutAircraft);
+
+	/** Returns a report holding the map and the date, for the run to add its results to */
+	static TSharedRef<FJsonObject> MakeReport(UWorld* World);
+
+	/** Writes Report as JSON to Filename */
+	static bool WriteReport(const TSharedRef<FJsonObject>& Report, const FString& Filename);
+};
+
+/** Measures every garbage collection between Start and Stop */
+class FGarbageCollectTimer
+{
+public:
+	~FGarbageCollectTimer() { Stop(); }
+
+	/** Starts timing, OnCollected is called with the length of each collection that finishes, in ms */
+	void Start(TFunction<void(float)> InOnCollected);
+
+	void Stop();
+
+private:
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+
+	TFunction<void(float)> OnCollected;
+
+	/** Platform time the running collection started */
+	double CollectStart = 0.0;
+
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+};
@@ -0,0 +1,330 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "SoakTestSubsystem.h"
+#include "FirstProject.h"
+#include "FirstProjectPawn.h"
+#include "MGunBullet.h"
+#include "ActorPoolSubsystem.h"
+#include "TerrainHeightfieldSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "UObject/UObjectArray.h"
+
+USoakTestSubsystem::USoakTestSubsystem()
+{
+	NumShooters = 4;
+	bUseRoundActors = true;
+	WarmupTime = 60.f;
+	Duration = 1800.f;
+	SampleInterval = 30.f;
+	ShooterRingRadius = 100000.f;
+	ShooterAltitude = 20000.f;
+	TurnYawInput = 1.f;
+	TurnUpInput = -0.08f;
+	MaxObjectGrowth = 2000;
+	MaxActorGrowth = 100;
+	MaxRoundActorGrowth = 100;
+	MaxMemoryGrowthMB = 64.f;
+	MaxGarbageCollectGrowth = 20.f;
+
+	bChecked = false;
+	bRunning = false;
+	bExitWhenDone = false;
+	NextSampleTime = 0.f;
+	bSamplePending = false;
+	bGarbageCollected = false;
+	LastGarbageCollectTime = 0.f;
+	EndTime = 0.f;
+	ShooterAmmo = 0;
+}
+
+void USoakTestSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		// An unfinished run proves nothing, so it fails rather than leave the caller waiting or reading a pass
+		TArray<FString> Failures;
+		Failures.Add(FString::Printf(TEXT("Abandoned after %d samples, the world ended before the run did"), Samples.Num()));
+		UE_LOG(LogFlying, Error, TEXT("Soak test failed: %s"), *Failures[0]);
+		if (!WriteReport(OutputFilename, Failures))
+		{
+			UE_LOG(LogFlying, Error, TEXT("Soak test report cannot be written to %s"), *OutputFilename);
+		}
+		if (bExitWhenDone)
+		{
+			FPlatformMisc::RequestExitWithStatus(false, 1);
+		}
+	}
+
+	GarbageCollectTimer.Stop();
+
+	bRunning = false;
+	Shooters.Empty();
+	Samples.Empty();
+
+	Super::Deinitialize();
+}
+
+bool USoakTestSubsystem::IsTickable() const
+{
+	return !bChecked || bRunning;
+}
+
+ETickableTickType USoakTestSubsystem::GetTickableTickType() const
+{
+	// The class default object never runs a test
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* USoakTestSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USoakTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USoakTestSubsystem, STATGROUP_Tickables);
+}
+
+void USoakTestSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	if (!bChecked)
+	{
+		// Aircraft are placed over the terrain, so wait for its first bake
+		UTerrainHeightfieldSubsystem* Terrain = World->GetSubsystem<UTerrainHeightfieldSubsystem>();
+		if (Terrain && !Terrain->GetHeightfield().IsValid())
+		{
+			return;
+		}
+
+		bChecked = true;
+		if (World->IsGameWorld() && FParse::Param(FCommandLine::Get(), TEXT("FlightSoak")))
+		{
+			bExitWhenDone = true;
+			StartSoak();
+		}
+		return;
+	}
+
+	// Keep every trigger held, the test is about sustained fire
+	for (AFirstProjectPawn* Shooter : Shooters)
+	{
+		if (Shooter && !Shooter->IsPendingKill())
+		{
+			Shooter->MGunAmmo = ShooterAmmo;
+			Shooter->SetScriptedMGunFiring(true);
+		}
+	}
+
+	const float Now = World->GetTimeSeconds();
+	if (!bSamplePending)
+	{
+		if (Now >= NextSampleTime)
+		{
+			// Collecting in the middle of the world tick is not safe, so ask for a full purge at the end of this one
+			GEngine->ForceGarbageCollection(true);
+			bSamplePending = true;
+			bGarbageCollected = false;
+		}
+		return;
+	}
+	if (!bGarbageCollected)
+	{
+		return;
+	}
+	bSamplePending = false;
+	NextSampleTime = Now + SampleInterval;
+
+	const FSoakSample Sample = TakeSample();
+	Samples.Add(Sample);
+	UE_LOG(LogFlying, Log, TEXT("Soak sample at %.0f s: %d objects, %d actors, %d round actors (%d pooled), %.1f MB used, GC %.1f ms"),
+		Sample.Time, Sample.NumObjects, Sample.NumActors, Sample.NumRoundActors, Sample.NumPooledRounds, Sample.UsedMemoryMB, Sample.GarbageCollectTime);
+
+	TArray<FString> Failures;
+	CheckSample(Sample, Failures);
+	if (Failures.Num() > 0 || Now >= EndTime)
+	{
+		FinishSoak(Failures);
+	}
+}
+
+void USoakTestSubsystem::StartSoak()
+{
+	UWorld* World = GetWorld();
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("SoakShooters="), NumShooters);
+	float Minutes = 0.f;
+	if (FParse::Value(CommandLine, TEXT("SoakMinutes="), Minutes))
+	{
+		Duration = Minutes * 60.f;
+	}
+	if (!FParse::Value(CommandLine, TEXT("SoakOutput="), OutputFilename))
+	{
+		OutputFilename = FPaths::ProjectSavedDir() / TEXT("Soak") / FString::Printf(TEXT("FlightSoak_%s_%s.json"), *World->GetMapName(), *FDateTime::Now().ToString());
+	}
+
+	// The shooters circle the player start, or wherever the player already is
+	ShooterAmmo = FScriptedTraffic::GetAircraftClass(World)->GetDefaultObject<AFirstProjectPawn>()->MGunAmmo;
+
+	FScriptedAircraftRing Ring;
+	Ring.NumAircraft = NumShooters;
+	Ring.Radius = ShooterRingRadius;
+	Ring.Altitude = ShooterAltitude;
+	Ring.Input.Yaw = TurnYawInput;
+	Ring.Input.Up = TurnUpInput;
+	Ring.bOverrideUseBulletManager = true;
+	Ring.bUseBulletManager = !bUseRoundActors;
+	FScriptedTraffic::SpawnAircraftRing(World, FScriptedTraffic::FindCenter(World), Ring, Shooters);
+
+	GarbageCollectTimer.Start([this](float GarbageCollectTime)
+	{
+		LastGarbageCollectTime = GarbageCollectTime;
+		bGarbageCollected = true;
+	});
+
+	const float Now = World->GetTimeSeconds();
+	NextSampleTime = Now + WarmupTime;
+	EndTime = NextSampleTime + Duration;
+	bRunning = true;
+
+	UE_LOG(LogFlying, Log, TEXT("Soak test started with %d shooters firing %s, baseline in %.0f s, running %.0f s"),
+		Shooters.Num(), bUseRoundActors ? TEXT("round actors") : TEXT("managed rounds"), WarmupTime, Duration);
+}
+
+FSoakSample USoakTestSubsystem::TakeSample() const
+{
+	UWorld* World = GetWorld();
+	FSoakSample Sample;
+	Sample.Time = World->GetTimeSeconds();
+
+	// Taken right after a full collection, so garbage waiting for the next pass is not mistaken for a leak
+	Sample.GarbageCollectTime = LastGarbageCollectTime;
+
+	Sample.NumObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		Sample.NumActors++;
+		Sample.NumRoundActors += It->IsA<AMGunBullet>() ? 1 : 0;
+	}
+
+	if (UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>())
+	{
+		Sample.NumPooledRounds = Pool->GetPoolStats(AMGunBullet::StaticClass()).Free;
+	}
+
+	Sample.UsedMemoryMB = FPlatformMemory::GetStats().UsedPhysical / (1024.f * 1024.f);
+	return Sample;
+}
+
+void USoakTestSubsystem::CheckSample(const FSoakSample& Sample, TArray<FString>& OutFailures) const
+{
+	if (Samples.Num() < 2)
+	{
+		// This is the baseline
+		return;
+	}
+
+	const FSoakSample& Baseline = Samples[0];
+	if (Sample.NumObjects - Baseline.NumObjects > MaxObjectGrowth)
+	{
+		OutFailures.Add(FString::Printf(TEXT("UObjects grew by %d, from %d to %d"), Sample.NumObjects - Baseline.NumObjects, Baseline.NumObjects, Sample.NumObjects));
+	}
+	if (Sample.NumActors - Baseline.NumActors > MaxActorGrowth)
+	{
+		OutFailures.Add(FString::Printf(TEXT("Actors grew by %d, from %d to %d"), Sample.NumActors - Baseline.NumActors, Baseline.NumActors, Sample.NumActors));
+	}
+	if (Sample.NumRoundActors - Baseline.NumRoundActors > MaxRoundActorGrowth)
+	{
+		OutFailures.Add(FString::Printf(TEXT("Round actors grew by %d, from %d to %d"), Sample.NumRoundActors - Baseline.NumRoundActors, Baseline.NumRoundActors, Sample.NumRoundActors));
+	}
+	if (Sample.UsedMemoryMB - Baseline.UsedMemoryMB > MaxMemoryGrowthMB)
+	{
+		OutFailures.Add(FString::Printf(TEXT("Used memory grew by %.1f MB, from %.1f to %.1f MB"), Sample.UsedMemoryMB - Baseline.UsedMemoryMB, Baseline.UsedMemoryMB, Sample.UsedMemoryMB));
+	}
+	if (Sample.GarbageCollectTime - Baseline.GarbageCollectTime > MaxGarbageCollectGrowth)
+	{
+		OutFailures.Add(FString::Printf(TEXT("Garbage collection grew by %.1f ms, from %.1f to %.1f ms"), Sample.GarbageCollectTime - Baseline.GarbageCollectTime, Baseline.GarbageCollectTime, Sample.GarbageCollectTime));
+	}
+}
+
+void USoakTestSubsystem::FinishSoak(const TArray<FString>& Failures)
+{
+	bRunning = false;
+	GarbageCollectTimer.Stop();
+
+	for (const FString& Failure : Failures)
+	{
+		UE_LOG(LogFlying, Error, TEXT("Soak test failed: %s"), *Failure);
+	}
+	if (!WriteReport(OutputFilename, Failures))
+	{
+		UE_LOG(LogFlying, Error, TEXT("Soak test report cannot be written to %s"), *OutputFilename);
+	}
+	UE_LOG(LogFlying, Log, TEXT("Soak test %s after %d samples, report written to %s"), Failures.Num() > 0 ? TEXT("failed") : TEXT("passed"), Samples.Num(), *OutputFilename);
+
+	for (AFirstProjectPawn* Shooter : Shooters)
+	{
+		if (Shooter)
+		{
+			Shooter->Destroy();
+		}
+	}
+	Shooters.Empty();
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, Failures.Num() > 0 ? 1 : 0);
+	}
+}
+
+bool USoakTestSubsystem::WriteReport(const FString& Filename, const TArray<FString>& Failures) const
+{
+	TSharedRef<FJsonObject> Root = FScriptedTraffic::MakeReport(GetWorld());
+	Root->SetBoolField(TEXT("passed"), Failures.Num() == 0);
+	Root->SetNumberField(TEXT("shooters"), NumShooters);
+	Root->SetBoolField(TEXT("roundActors"), bUseRoundActors);
+
+	TArray<TSharedPtr<FJsonValue>> FailureValues;
+	for (const FString& Failure : Failures)
+	{
+		FailureValues.Add(MakeShared<FJsonValueString>(Failure));
+	}
+	Root->SetArrayField(TEXT("failures"), FailureValues);
+
+	TSharedRef<FJsonObject> Thresholds = MakeShared<FJsonObject>();
+	Thresholds->SetNumberField(TEXT("objects"), MaxObjectGrowth);
+	Thresholds->SetNumberField(TEXT("actors"), MaxActorGrowth);
+	Thresholds->SetNumberField(TEXT("roundActors"), MaxRoundActorGrowth);
+	Thresholds->SetNumberField(TEXT("usedMemoryMB"), MaxMemoryGrowthMB);
+	Thresholds->SetNumberField(TEXT("gcMs"), MaxGarbageCollectGrowth);
+	Root->SetObjectField(TEXT("maxGrowth"), Thresholds);
+
+	TArray<TSharedPtr<FJsonValue>> SampleValues;
+	for (const FSoakSample& Sample : Samples)
+	{
+		TSharedRef<FJsonObject> Value = MakeShared<FJsonObject>();
+		Value->SetNumberField(TEXT("time"), Sample.Time);
+		Value->SetNumberField(TEXT("objects"), Sample.NumObjects);
+		Value->SetNumberField(TEXT("actors"), Sample.NumActors);
+		Value->SetNumberField(TEXT("roundActors"), Sample.NumRoundActors);
+		Value->SetNumberField(TEXT("pooledRounds"), Sample.NumPooledRounds);
+		Value->SetNumberField(TEXT("usedMemoryMB"), Sample.UsedMemoryMB);
+		Value->SetNumberField(TEXT("gcMs"), Sample.GarbageCollectTime);
+		SampleValues.Add(MakeShared<FJsonValueObject>(Value));
+	}
+	Root->SetArrayField(TEXT("samples"), SampleValues);
+
+	return FScriptedTraffic::WriteReport(Root, Filename);
+}
@@ -0,0 +1,175 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ScriptedTraffic.h"
+#include "SoakTestSubsystem.generated.h"
+
+class AFirstProjectPawn;
+
+/** Resource usage at one point of a soak run */
+struct FSoakSample
+{
+	/** World time of the sample */
+	float Time = 0.f;
+
+	/** Live UObjects after a full collection */
+	int32 NumObjects = 0;
+
+	int32 NumActors = 0;
+
+	/** AMGunBullet actors in the world, handed out or waiting in the pool */
+	int32 NumRoundActors = 0;
+
+	/** AMGunBullet actors waiting in the pool */
+	int32 NumPooledRounds = 0;
+
+	/** Physical memory used by the process, in MB */
+	float UsedMemoryMB = 0.f;
+
+	/** Length of the full collection run before the sample, in ms */
+	float GarbageCollectTime = 0.f;
+};
+
+/**
+ * Long running churn test, started by -FlightSoak on the command line of a game run, for example
+ *   FirstProject LakeCanyonTest -game -nullrhi -benchmark -fps=30 -unattended -FlightSoak -SoakMinutes=30
+ * Spawns scripted shooters that fire without pause, by default through one AMGunBullet actor per round, and samples
+ * UObject, actor and pooled round counts, used memory and the length of a forced garbage collection at intervals.
+ * The first sample after the warmup is the baseline; the run fails as soon as any of them grows past its threshold.
+ * A JSON report is written either way, and the game exits with a non-zero code on failure, or when the world ends
+ * before the run does.
+ * -SoakShooters=, -SoakMinutes= and -SoakOutput= override the config.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API USoakTestSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	USoakTestSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+private:
+	/** Spawns the shooters and starts the warmup */
+	void StartSoak();
+
+	/** Measures everything the test watches, right after the forced garbage collection */
+	FSoakSample TakeSample() const;
+
+	/** Compares Sample against the baseline, appending a line per exceeded threshold to OutFailures */
+	void CheckSample(const FSoakSample& Sample, TArray<FString>& OutFailures) const;
+
+	/** Writes the report, removes the shooters and exits if the command line started the run */
+	void FinishSoak(const TArray<FString>& Failures);
+
+	/** Writes the samples and the verdict as JSON to Filename */
+	bool WriteReport(const FString& Filename, const TArray<FString>& Failures) const;
+
+	/** Scripted shooters spawned by a run */
+	UPROPERTY(Config)
+	int32 NumShooters;
+
+	/** Fire through AMGunBullet actors rather than the bullet manager, which is where actor churn happens */
+	UPROPERTY(Config)
+	bool bUseRoundActors;
+
+	/** Seconds run before the baseline is taken, so pools and caches have filled */
+	UPROPERTY(Config)
+	float WarmupTime;
+
+	/** Seconds of the whole run after the warmup */
+	UPROPERTY(Config)
+	float Duration;
+
+	/** Seconds between two samples */
+	UPROPERTY(Config)
+	float SampleInterval;
+
+	/** Distance of the shooter start points from the player start, in cm */
+	UPROPERTY(Config)
+	float ShooterRingRadius;
+
+	/** Height of the shooters above the ground, in cm */
+	UPROPERTY(Config)
+	float ShooterAltitude;
+
+	/** Yaw axis held by the shooters, they fly a steady circle */
+	UPROPERTY(Config)
+	float TurnYawInput;
+
+	/** Pitch axis held by the shooters, balances the nose drop of the turn */
+	UPROPERTY(Config)
+	float TurnUpInput;
+
+	/** Most live UObjects a sample may have above the baseline */
+	UPROPERTY(Config)
+	int32 MaxObjectGrowth;
+
+	/** Most actors a sample may have above the baseline */
+	UPROPERTY(Config)
+	int32 MaxActorGrowth;
+
+	/** Most AMGunBullet actors a sample may have above the baseline */
+	UPROPERTY(Config)
+	int32 MaxRoundActorGrowth;
+
+	/** Most used memory a sample may have above the baseline, in MB */
+	UPROPERTY(Config)
+	float MaxMemoryGrowthMB;
+
+	/** Longest a sample's garbage collection may take beyond the baseline's, in ms */
+	UPROPERTY(Config)
+	float MaxGarbageCollectGrowth;
+
+	/** Whether a run has been looked for in this world */
+	bool bChecked;
+
+	/** Whether the shooters are out and the run is in progress */
+	bool bRunning;
+
+	/** Whether the run was started from the command line, which then exits when it is done */
+	bool bExitWhenDone;
+
+	/** World time of the next sample, the first one is the baseline */
+	float NextSampleTime;
+
+	/** Whether a full collection has been requested for the next sample */
+	bool bSamplePending;
+
+	/** Whether a collection has finished since the sample was requested */
+	bool bGarbageCollected;
+
+	/** Length of the last collection, in ms */
+	float LastGarbageCollectTime;
+
+	/** World time the run ends */
+	float EndTime;
+
+	/** Where the report goes */
+	FString OutputFilename;
+
+	UPROPERTY()
+	TArray<AFirstProjectPawn*> Shooters;
+
+	/** Ammunition given back to the shooters every frame */
+	int32 ShooterAmmo;
+
+	/** Baseline first, then one per interval */
+	TArray<FSoakSample> Samples;
+
+	FGarbageCollectTimer GarbageCollectTimer;
+};
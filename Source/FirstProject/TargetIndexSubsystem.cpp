@@ -0,0 +1,281 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "TargetIndexSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+
+namespace TargetIndex
+{
+	/** Packs a grid column into one key */
+	static FORCEINLINE uint64 CellKey(int32 CellX, int32 CellY)
+	{
+		return (uint64(uint32(CellX)) << 32) | uint64(uint32(CellY));
+	}
+}
+
+UTargetIndexSubsystem::UTargetIndexSubsystem()
+{
+	CellSize = 100000.f;
+}
+
+void UTargetIndexSubsystem::Deinitialize()
+{
+	Targets.Empty();
+	TargetSlots.Empty();
+	Locations.Empty();
+	Velocities.Empty();
+	Radii.Empty();
+	Cells.Empty();
+	CellTargets.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UTargetIndexSubsystem::IsTickable() const
+{
+	return Targets.Num() > 0;
+}
+
+ETickableTickType UTargetIndexSubsystem::GetTickableTickType() const
+{
+	// The class default object never indexes anything
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UTargetIndexSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UTargetIndexSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTargetIndexSubsystem, STATGROUP_Tickables);
+}
+
+uint64 UTargetIndexSubsystem::GetCellKey(const FVector& Location) const
+{
+	return TargetIndex::CellKey(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UTargetIndexSubsystem::AddTarget(AActor* Target)
+{
+	if (Target == nullptr || TargetSlots.Contains(Target))
+	{
+		return;
+	}
+
+	const int32 Index = Targets.Add(Target);
+	TargetSlots.Add(Target);
+	Locations.Add(Target->GetActorLocation());
+	Velocities.Add(FVector::ZeroVector);
+	Radii.Add(Target->GetRootComponent() ? Target->GetRootComponent()->Bounds.SphereRadius : 0.f);
+	Cells.Add(GetCellKey(Locations[Index]));
+	CellTargets.FindOrAdd(Cells[Index]).Add(Index);
+}
+
+void UTargetIndexSubsystem::RemoveTarget(AActor* Target)
+{
+	if (const int32* Index = TargetSlots.Find(Target))
+	{
+		RemoveTargetAtSwap(*Index);
+	}
+}
+
+void UTargetIndexSubsystem::MoveToCell(int32 Index, uint64 NewCell)
+{
+	TArray<int32>& OldCellTargets = CellTargets.FindChecked(Cells[Index]);
+	OldCellTargets.RemoveSingleSwap(Index, false);
+	if (OldCellTargets.Num() == 0)
+	{
+		CellTargets.Remove(Cells[Index]);
+	}
+
+	Cells[Index] = NewCell;
+	CellTargets.FindOrAdd(NewCell).Add(Index);
+}
+
+void UTargetIndexSubsystem::RemoveTargetAtSwap(int32 Index)
+{
+	TArray<int32>& CellIndices = CellTargets.FindChecked(Cells[Index]);
+	CellIndices.RemoveSingleSwap(Index, false);
+	if (CellIndices.Num() == 0)
+	{
+		CellTargets.Remove(Cells[Index]);
+	}
+
+	const int32 LastIndex = Targets.Num() - 1;
+	TargetSlots.RemoveAtSwap(Index);
+	if (Index != LastIndex)
+	{
+		// The last target takes over Index in its column too
+		TArray<int32>& LastCellIndices = CellTargets.FindChecked(Cells[LastIndex]);
+		LastCellIndices[LastCellIndices.IndexOfByKey(LastIndex)] = Index;
+	}
+
+	Targets.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	Radii.RemoveAtSwap(Index, 1, false);
+	Cells.RemoveAtSwap(Index, 1, false);
+}
+
+bool UTargetIndexSubsystem::GetTargetState(const AActor* Target, FVector& OutLocation, FVector& OutVelocity, float& OutRadius) const
+{
+	const int32* Index = TargetSlots.Find(Target);
+	if (Index == nullptr)
+	{
+		return false;
+	}
+
+	OutLocation = Locations[*Index];
+	OutVelocity = Velocities[*Index];
+	OutRadius = Radii[*Index];
+	return true;
+}
+
+void UTargetIndexSubsystem::Tick(float DeltaTime)
+{
+	for (int32 Index = Targets.Num() - 1; Index >= 0; Index--)
+	{
+		const AActor* Target = Targets[Index].Get();
+		if (Target == nullptr)
+		{
+			RemoveTargetAtSwap(Index);
+			continue;
+		}
+
+		const FVector Location = Target->GetActorLocation();
+		Velocities[Index] = DeltaTime > 0.f ? (Location - Locations[Index]) / DeltaTime : FVector::ZeroVector;
+		Locations[Index] = Location;
+		const uint64 Cell = GetCellKey(Locations[Index]);
+		if (Cell != Cells[Index])
+		{
+			MoveToCell(Index, Cell);
+		}
+	}
+}
+
+void UTargetIndexSubsystem::ForEachTargetNear(const FVector& Center, float HalfExtent, TFunctionRef<void(int32)> Visitor) const
+{
+	const int32 MinX = FMath::FloorToInt((Center.X - HalfExtent) / CellSize);
+	const int32 MaxX = FMath::FloorToInt((Center.X + HalfExtent) / CellSize);
+	const int32 MinY = FMath::FloorToInt((Center.Y - HalfExtent) / CellSize);
+	const int32 MaxY = FMath::FloorToInt((Center.Y + HalfExtent) / CellSize);
+
+	// Wide queries such as long range radar sweeps are cheaper over the occupied columns than over the covered ones
+	if ((int64(MaxX) - MinX + 1) * (int64(MaxY) - MinY + 1) > CellTargets.Num())
+	{
+		for (const TPair<uint64, TArray<int32>>& Cell : CellTargets)
+		{
+			const int32 CellX = int32(uint32(Cell.Key >> 32));
+			const int32 CellY = int32(uint32(Cell.Key));
+			if (CellX >= MinX && CellX <= MaxX && CellY >= MinY && CellY <= MaxY)
+			{
+				for (const int32 Index : Cell.Value)
+				{
+					Visitor(Index);
+				}
+			}
+		}
+		return;
+	}
+
+	for (int32 CellY = MinY; CellY <= MaxY; CellY++)
+	{
+		for (int32 CellX = MinX; CellX <= MaxX; CellX++)
+		{
+			if (const TArray<int32>* CellIndices = CellTargets.Find(TargetIndex::CellKey(CellX, CellY)))
+			{
+				for (const int32 Index : *CellIndices)
+				{
+					Visitor(Index);
+				}
+			}
+		}
+	}
+}
+
+void UTargetIndexSubsystem::FindTargetsInRadius(FVector Center, float Radius, TArray<AActor*>& OutTargets, const AActor* Ignore) const
+{
+	OutTargets.Reset();
+	const float RadiusSquared = FMath::Square(Radius);
+	ForEachTargetNear(Center, Radius, [&](int32 Index)
+	{
+		AActor* Target = Targets[Index].Get();
+		if (Target && Target != Ignore && FVector::DistSquared(Locations[Index], Center) <= RadiusSquared)
+		{
+			OutTargets.Add(Target);
+		}
+	});
+}
+
+void UTargetIndexSubsystem::FindTargetsInCone(FVector Origin, FVector Direction, float HalfAngle, float Range, TArray<AActor*>& OutTargets, const AActor* Ignore) const
+{
+	OutTargets.Reset();
+	const FVector Axis = Direction.GetSafeNormal();
+	const float CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(HalfAngle, 0.f, 180.f)));
+	const float RangeSquared = FMath::Square(Range);
+	ForEachTargetNear(Origin, Range, [&](int32 Index)
+	{
+		AActor* Target = Targets[Index].Get();
+		if (Target == nullptr || Target == Ignore)
+		{
+			return;
+		}
+
+		const FVector Offset = Locations[Index] - Origin;
+		const float DistanceSquared = Offset.SizeSquared();
+		if (DistanceSquared > RangeSquared)
+		{
+			return;
+		}
+
+		if (FVector::DotProduct(Axis, Offset) >= CosHalfAngle * FMath::Sqrt(DistanceSquared))
+		{
+			OutTargets.Add(Target);
+		}
+	});
+}
+
+void UTargetIndexSubsystem::FindNearestTargets(FVector Center, int32 Count, float MaxRadius, TArray<AActor*>& OutTargets, const AActor* Ignore) const
+{
+	OutTargets.Reset();
+	if (Count <= 0 || Targets.Num() == 0)
+	{
+		return;
+	}
+
+	// Grow the search from one column until it holds enough targets, everything within a radius is exact
+	TArray<TPair<float, int32>> Candidates;
+	for (float Radius = FMath::Min(CellSize, MaxRadius); ; Radius = FMath::Min(Radius * 2.f, MaxRadius))
+	{
+		Candidates.Reset();
+		int32 NumVisited = 0;
+		const float RadiusSquared = FMath::Square(Radius);
+		ForEachTargetNear(Center, Radius, [&](int32 Index)
+		{
+			const float DistanceSquared = FVector::DistSquared(Locations[Index], Center);
+			if (DistanceSquared <= RadiusSquared)
+			{
+				NumVisited++;
+				const AActor* Target = Targets[Index].Get();
+				if (Target && Target != Ignore)
+				{
+					Candidates.Emplace(DistanceSquared, Index);
+				}
+			}
+		});
+
+		if (Candidates.Num() >= Count || Radius >= MaxRadius || NumVisited == Targets.Num())
+		{
+			break;
+		}
+	}
+
+	Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+	for (int32 Index = 0; Index < FMath::Min(Count, Candidates.Num()); Index++)
+	{
+		OutTargets.Add(Targets[Candidates[Index].Value].Get());
+	}
+}
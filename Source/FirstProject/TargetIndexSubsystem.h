@@ -0,0 +1,104 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ActorSlotMap.h"
+#include "TargetIndexSubsystem.generated.h"
+
+/**
+ * Spatial index of every targetable actor, for targeting, radar and AI to query instead of scanning the world.
+ * Targets are bucketed into a uniform grid of columns over the ground plane. Each frame their locations are
+ * read back once, and a target only changes bucket when it crosses into another column. Velocities are
+ * estimated from the change in location, since most targets are moved kinematically.
+ * Queries see target locations as of the end of the previous frame.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UTargetIndexSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UTargetIndexSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/** Adds Target to the index, does nothing if it is already indexed */
+	void AddTarget(AActor* Target);
+
+	/** Removes Target from the index */
+	void RemoveTarget(AActor* Target);
+
+	/** Finds every target within Radius of Center */
+	UFUNCTION(BlueprintCallable, Category = Targeting)
+	void FindTargetsInRadius(FVector Center, float Radius, TArray<AActor*>& OutTargets, const AActor* Ignore = nullptr) const;
+
+	/**
+	 * Finds every target within Range of Origin and HalfAngle degrees of Direction.
+	 * @param Direction	Axis of the cone, need not be normalized
+	 */
+	UFUNCTION(BlueprintCallable, Category = Targeting)
+	void FindTargetsInCone(FVector Origin, FVector Direction, float HalfAngle, float Range, TArray<AActor*>& OutTargets, const AActor* Ignore = nullptr) const;
+
+	/** Finds up to Count targets nearest to Center and within MaxRadius of it, nearest first */
+	UFUNCTION(BlueprintCallable, Category = Targeting)
+	void FindNearestTargets(FVector Center, int32 Count, float MaxRadius, TArray<AActor*>& OutTargets, const AActor* Ignore = nullptr) const;
+
+	/**
+	 * Returns what the index knows of Target.
+	 * @param OutRadius	Bounding sphere radius of the target's root component
+	 * @return Whether Target is indexed
+	 */
+	bool GetTargetState(const AActor* Target, FVector& OutLocation, FVector& OutVelocity, float& OutRadius) const;
+
+	FORCEINLINE int32 GetNumTargets() const { return Targets.Num(); }
+
+private:
+	/** Returns the key of the column holding Location */
+	uint64 GetCellKey(const FVector& Location) const;
+
+	/** Moves target Index from the column it was in to the column at NewCell */
+	void MoveToCell(int32 Index, uint64 NewCell);
+
+	/** Removes target Index, keeping TargetSlots and the columns in line with the swap */
+	void RemoveTargetAtSwap(int32 Index);
+
+	/** Calls Visitor with every target in the columns overlapping the square of HalfExtent around Center */
+	void ForEachTargetNear(const FVector& Center, float HalfExtent, TFunctionRef<void(int32)> Visitor) const;
+
+	/** Width of a grid column, in cm */
+	UPROPERTY(Config)
+	float CellSize;
+
+	/** Actor of each target */
+	TArray<TWeakObjectPtr<AActor>> Targets;
+
+	/** Index of each target's actor */
+	FActorSlotMap TargetSlots;
+
+	/** Location of each target as last read back */
+	TArray<FVector> Locations;
+
+	/** Velocity of each target over the last frame */
+	TArray<FVector> Velocities;
+
+	/** Bounding sphere radius of each target */
+	TArray<float> Radii;
+
+	/** Column key of each target */
+	TArray<uint64> Cells;
+
+	/** Targets in each occupied column */
+	TMap<uint64, TArray<int32>> CellTargets;
+};
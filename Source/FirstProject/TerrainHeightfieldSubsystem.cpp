@@ -0,0 +1,261 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "TerrainHeightfieldSubsystem.h"
+#include "FirstProject.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "EngineUtils.h"
+#include "CollisionQueryParams.h"
+#include "LandscapeProxy.h"
+#include "LandscapeHeightfieldCollisionComponent.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/IConsoleManager.h"
+
+static FAutoConsoleCommandWithWorld RebakeHeightfieldCommand(
+	TEXT("acrl.Terrain.Rebake"),
+	TEXT("Bakes the terrain heightfield of the current world again and logs its size"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UTerrainHeightfieldSubsystem* Terrain = World ? World->GetSubsystem<UTerrainHeightfieldSubsystem>() : nullptr)
+		{
+			Terrain->Invalidate();
+		}
+	}));
+
+UTerrainHeightfieldSubsystem::UTerrainHeightfieldSubsystem()
+{
+	BakeSpacing = 200.f;
+	MaxBakeSamplesPerAxis = 2049;
+	MaxBakeTracesPerFrame = 32768;
+	BakeGridSpacing = 0.f;
+	BakeNumX = 0;
+	BakeNumY = 0;
+	NextBakeSample = 0;
+	PendingBakeTraces = 0;
+	BakeGeneration = 0;
+	BakeStartTime = 0.0;
+	bTracing = false;
+}
+
+void UTerrainHeightfieldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ActorsInitializedHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UTerrainHeightfieldSubsystem::OnWorldInitializedActors);
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UTerrainHeightfieldSubsystem::OnLevelsChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UTerrainHeightfieldSubsystem::OnLevelsChanged);
+}
+
+void UTerrainHeightfieldSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(ActorsInitializedHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	// Traces still in flight answer to a generation that no longer exists
+	BakeGeneration++;
+	BakeTraceDelegate.Unbind();
+	bTracing = false;
+	BakeHeights.Empty();
+
+	// The build only reads its own copy of the heights
+	if (PendingBuild.IsValid())
+	{
+		PendingBuild.Wait();
+		PendingBuild = TFuture<FTerrainHeightfieldPtr>();
+	}
+	Heightfield.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTerrainHeightfieldSubsystem::IsTickable() const
+{
+	return IsBaking();
+}
+
+ETickableTickType UTerrainHeightfieldSubsystem::GetTickableTickType() const
+{
+	// The class default object never bakes
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UTerrainHeightfieldSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UTerrainHeightfieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTerrainHeightfieldSubsystem, STATGROUP_Tickables);
+}
+
+void UTerrainHeightfieldSubsystem::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	if (Params.World == GetWorld() && Params.World->IsGameWorld() && !Heightfield.IsValid() && !IsBaking())
+	{
+		StartBake();
+	}
+}
+
+void UTerrainHeightfieldSubsystem::OnLevelsChanged(ULevel* InLevel, UWorld* InWorld)
+{
+	// A null level means the whole world is going away
+	if (InLevel == nullptr || InWorld != GetWorld() || !InWorld->IsGameWorld())
+	{
+		return;
+	}
+
+	// Sublevels without landscape leave the heightfield as it is
+	for (AActor* Actor : InLevel->Actors)
+	{
+		if (Cast<ALandscapeProxy>(Actor))
+		{
+			Invalidate();
+			return;
+		}
+	}
+}
+
+FTerrainHeightfieldPtr UTerrainHeightfieldSubsystem::GetHeightfield()
+{
+	check(IsInGameThread());
+	if (!Heightfield.IsValid() && !IsBaking())
+	{
+		// Worlds that never initialize actors for play, editor previews for example, bake on first use
+		StartBake();
+	}
+	return Heightfield;
+}
+
+bool UTerrainHeightfieldSubsystem::GetHeightAboveGround(const FVector& Location, float& OutHeight)
+{
+	const FTerrainHeightfieldPtr Current = GetHeightfield();
+	return Current.IsValid() && Current->GetHeightAboveGround(Location, OutHeight);
+}
+
+bool UTerrainHeightfieldSubsystem::IntersectSegment(const FVector& Start, const FVector& End, FVector& OutLocation)
+{
+	const FTerrainHeightfieldPtr Current = GetHeightfield();
+	float Time;
+	if (!Current.IsValid() || !Current->IntersectSegment(Start, End, Time))
+	{
+		return false;
+	}
+	OutLocation = FMath::Lerp(Start, End, Time);
+	return true;
+}
+
+void UTerrainHeightfieldSubsystem::Invalidate()
+{
+	StartBake();
+}
+
+void UTerrainHeightfieldSubsystem::StartBake()
+{
+	check(IsInGameThread());
+	UWorld* World = GetWorld();
+
+	// Starting over drops the traces of any bake running, their answers no longer match the landscape
+	BakeGeneration++;
+	BakeTraceDelegate.BindUObject(this, &UTerrainHeightfieldSubsystem::OnBakeTrace, BakeGeneration);
+	PendingBakeTraces = 0;
+	NextBakeSample = 0;
+	bTracing = false;
+
+	FBox LandscapeBounds(ForceInit);
+	for (TActorIterator<ALandscapeProxy> It(World); It; ++It)
+	{
+		LandscapeBounds += It->GetComponentsBoundingBox();
+	}
+	if (!LandscapeBounds.IsValid)
+	{
+		BakeHeights.Empty();
+		Heightfield = MakeShared<FTerrainHeightfield, ESPMode::ThreadSafe>();
+		return;
+	}
+
+	const FVector Size = LandscapeBounds.GetSize();
+	const int32 MaxSamples = FMath::Max(2, MaxBakeSamplesPerAxis);
+	BakeBounds = LandscapeBounds;
+	BakeGridSpacing = FMath::Max3(BakeSpacing, Size.X / (MaxSamples - 1), Size.Y / (MaxSamples - 1));
+	BakeNumX = FMath::Clamp(FMath::CeilToInt(Size.X / BakeGridSpacing) + 1, 2, MaxSamples);
+	BakeNumY = FMath::Clamp(FMath::CeilToInt(Size.Y / BakeGridSpacing) + 1, 2, MaxSamples);
+	BakeHeights.Reset();
+	BakeHeights.SetNumUninitialized(BakeNumX * BakeNumY);
+	BakeStartTime = FPlatformTime::Seconds();
+	bTracing = true;
+}
+
+void UTerrainHeightfieldSubsystem::Tick(float DeltaTime)
+{
+	if (PendingBuild.IsValid() && PendingBuild.IsReady())
+	{
+		Heightfield = PendingBuild.Get();
+		PendingBuild = TFuture<FTerrainHeightfieldPtr>();
+	}
+
+	if (!bTracing)
+	{
+		return;
+	}
+
+	// Up to millions of traces, so a batch per frame; the scene queries run on task threads and answer next frame
+	const int32 NumSamples = BakeNumX * BakeNumY;
+	const int32 EndSample = FMath::Min(NextBakeSample + FMath::Max(1, MaxBakeTracesPerFrame), NumSamples);
+	const float TraceTop = BakeBounds.Max.Z + 100.f;
+	const float TraceBottom = BakeBounds.Min.Z - 100.f;
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TerrainHeightfieldBake), false);
+	const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+	UWorld* World = GetWorld();
+	for (; NextBakeSample < EndSample; NextBakeSample++)
+	{
+		const float SampleX = BakeBounds.Min.X + (NextBakeSample % BakeNumX) * BakeGridSpacing;
+		const float SampleY = BakeBounds.Min.Y + (NextBakeSample / BakeNumX) * BakeGridSpacing;
+		World->AsyncLineTraceByObjectType(EAsyncTraceType::Multi, FVector(SampleX, SampleY, TraceTop), FVector(SampleX, SampleY, TraceBottom), ObjectParams, QueryParams, &BakeTraceDelegate, NextBakeSample);
+		PendingBakeTraces++;
+	}
+
+	// A build still running for an earlier bake is picked up first, so heightfields are served in order
+	if (NextBakeSample < NumSamples || PendingBakeTraces > 0 || PendingBuild.IsValid())
+	{
+		return;
+	}
+
+	bTracing = false;
+	const FVector2D Origin(BakeBounds.Min);
+	const float Spacing = BakeGridSpacing;
+	const int32 NumX = BakeNumX;
+	const int32 NumY = BakeNumY;
+	const double StartTime = BakeStartTime;
+	PendingBuild = Async(EAsyncExecution::ThreadPool, [Heights = MoveTemp(BakeHeights), Origin, Spacing, NumX, NumY, StartTime]()
+	{
+		TSharedRef<FTerrainHeightfield, ESPMode::ThreadSafe> NewHeightfield = MakeShared<FTerrainHeightfield, ESPMode::ThreadSafe>();
+		NewHeightfield->Build(Origin, Spacing, NumX, NumY, Heights);
+		UE_LOG(LogFlying, Log, TEXT("Baked terrain heightfield: %d x %d samples %.0f cm apart, %llu bytes, in %.2f s"), NumX, NumY, Spacing, (uint64)NewHeightfield->GetAllocatedSize(), FPlatformTime::Seconds() - StartTime);
+		return FTerrainHeightfieldPtr(NewHeightfield);
+	});
+	BakeHeights.Reset();
+}
+
+void UTerrainHeightfieldSubsystem::OnBakeTrace(const FTraceHandle& Handle, FTraceDatum& Datum, uint32 Generation)
+{
+	if (Generation != BakeGeneration || !BakeHeights.IsValidIndex((int32)Datum.UserData))
+	{
+		return;
+	}
+
+	// Only the landscape counts, not whatever stands on it; a point with none under it has no terrain rather than a pit
+	float Height = FTerrainHeightfield::NoTerrain;
+	for (const FHitResult& Hit : Datum.OutHits)
+	{
+		if (Cast<ULandscapeHeightfieldCollisionComponent>(Hit.GetComponent()))
+		{
+			Height = Hit.ImpactPoint.Z;
+			break;
+		}
+	}
+	BakeHeights[Datum.UserData] = Height;
+	PendingBakeTraces--;
+}
@@ -0,0 +1,126 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/World.h"
+#include "WorldCollision.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "TerrainHeightfield.h"
+#include "TerrainHeightfieldSubsystem.generated.h"
+
+typedef TSharedPtr<const FTerrainHeightfield, ESPMode::ThreadSafe> FTerrainHeightfieldPtr;
+
+/**
+ * Bakes the world's landscapes into an FTerrainHeightfield once the world's actors are initialized, and again
+ * whenever a streaming level brings landscape in or takes it out.
+ * The bake traces the landscape collision once on a grid, as batches of async traces spread over a few frames;
+ * their hits are checked on the game thread, so the bake never touches components while streaming or garbage
+ * collection runs. After that, altitude, ground snapping and terrain impact questions are answered from the
+ * heightfield without touching the physics scene. Grid points the traces find no landscape under are baked as
+ * having no terrain.
+ * The heightfield is shared by reference and never modified after the bake, so worker threads may hold and
+ * query it freely.
+ */
+UCLASS(Config=Game)
+class FIRSTPROJECT_API UTerrainHeightfieldSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UTerrainHeightfieldSubsystem();
+
+	// Begin USubsystem overrides
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem overrides
+
+	// Begin FTickableGameObject overrides
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual bool IsTickableInEditor() const override { return true; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject overrides
+
+	/**
+	 * Returns the heightfield of the world's landscapes, or null while the first bake is still running.
+	 * Must be called from the game thread; the returned pointer may then be handed to any thread.
+	 * The heightfield is invalid when the world has no landscape.
+	 */
+	FTerrainHeightfieldPtr GetHeightfield();
+
+	/** Returns whether a bake is running, the previous heightfield, if any, is served meanwhile */
+	bool IsBaking() const { return bTracing || PendingBuild.IsValid(); }
+
+	/** Returns how far Location is above the terrain, or false where there is no terrain */
+	bool GetHeightAboveGround(const FVector& Location, float& OutHeight);
+
+	/** Returns where the segment from Start to End first crosses the terrain, or false if it does not */
+	bool IntersectSegment(const FVector& Start, const FVector& End, FVector& OutLocation);
+
+	/** Bakes the heightfield again, e.g. after editing the landscape; the current one is served until it is done, a bake already running starts over */
+	void Invalidate();
+
+private:
+	/** Bound to the world's actors being initialized for play, starts the first bake */
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+
+	/** Bound to levels being added to and removed from any world, rebakes when this world's landscape changed */
+	void OnLevelsChanged(ULevel* InLevel, UWorld* InWorld);
+
+	/** Sizes the bake grid, the traces are issued from Tick */
+	void StartBake();
+
+	/** Receives the hits under one grid point, on the game thread; results of bakes since started over are dropped */
+	void OnBakeTrace(const FTraceHandle& Handle, FTraceDatum& Datum, uint32 Generation);
+
+	/** Distance between baked samples, in cm */
+	UPROPERTY(Config)
+	float BakeSpacing;
+
+	/** Most samples along either axis, the spacing grows to fit larger landscapes */
+	UPROPERTY(Config)
+	int32 MaxBakeSamplesPerAxis;
+
+	/** Most async traces issued per frame while baking */
+	UPROPERTY(Config)
+	int32 MaxBakeTracesPerFrame;
+
+	FTerrainHeightfieldPtr Heightfield;
+
+	/** Grid being traced */
+	FBox BakeBounds;
+	float BakeGridSpacing;
+	int32 BakeNumX;
+	int32 BakeNumY;
+
+	/** Height under each grid point traced so far, row by row along X */
+	TArray<float> BakeHeights;
+
+	/** Next grid point to trace */
+	int32 NextBakeSample;
+
+	/** Traces issued but not answered yet */
+	int32 PendingBakeTraces;
+
+	/** Counts bakes started, so traces of a bake that started over are told apart */
+	uint32 BakeGeneration;
+
+	/** Bound with the current generation and handed to every trace */
+	FTraceDelegate BakeTraceDelegate;
+
+	double BakeStartTime;
+
+	/** Whether grid points are still being traced */
+	bool bTracing;
+
+	/** Heightfield being built from the traced heights on a worker thread */
+	TFuture<FTerrainHeightfieldPtr> PendingBuild;
+
+	FDelegateHandle ActorsInitializedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
@@ -0,0 +1,78 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "ConvoyNavGrid.h"
+#include "TerrainHeightfield.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ConvoyNavGridTests
+{
+	static const int32 NumSamples = 101;
+	static const float Spacing = 100.f;
+
+	/**
+	 * Flat 100 m square split down X = 50 m by a wall, with a gap from Y = 40 m to 60 m.
+	 * @param GapHeight	Height of the samples in the gap, NoTerrain to leave a hole in the terrain there
+	 */
+	static void BuildWalledHeightfield(float GapHeight, FTerrainHeightfield& OutHeightfield)
+	{
+		TArray<float> Heights;
+		Heights.SetNumZeroed(NumSamples * NumSamples);
+		for (int32 Y = 0; Y < NumSamples; Y++)
+		{
+			for (int32 X = 48; X <= 52; X++)
+			{
+				Heights[Y * NumSamples + X] = Y >= 40 && Y <= 60 ? GapHeight : 5000.f;
+			}
+		}
+		OutHeightfield.Build(FVector2D::ZeroVector, Spacing, NumSamples, NumSamples, Heights);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FConvoyNavGridRoutesTest, "ACRL.Convoy.NavGridRoutes", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FConvoyNavGridRoutesTest::RunTest(const FString& Parameters)
+{
+	const FVector Start(1000.f, 5000.f, 0.f);
+	const FVector Goal(9000.f, 1000.f, 0.f);
+
+	// Through the gap: every cell on the wall line must lie inside it
+	{
+		FTerrainHeightfield Heightfield;
+		ConvoyNavGridTests::BuildWalledHeightfield(0.f, Heightfield);
+		FConvoyNavGrid Grid;
+		Grid.Build(Heightfield, 200.f, 25.f, 5);
+		TestTrue(TEXT("Grid valid"), Grid.IsValid());
+
+		TArray<FIntPoint> Cells;
+		if (TestTrue(TEXT("Route through the gap"), Grid.FindCellPath(Grid.GetCell(Start), Grid.GetCell(Goal), nullptr, Cells)))
+		{
+			TestTrue(TEXT("Route starts at the start"), Cells[0] == Grid.GetCell(Start));
+			TestTrue(TEXT("Route ends at the goal"), Cells.Last() == Grid.GetCell(Goal));
+			for (const FIntPoint& Cell : Cells)
+			{
+				const FVector Center = Grid.GetCellCenter(Cell);
+				if (Center.X > 4800.f && Center.X < 5200.f)
+				{
+					TestTrue(*FString::Printf(TEXT("Cell %s crosses the wall in the gap"), *Cell.ToString()), Center.Y > 4000.f && Center.Y < 6000.f);
+				}
+			}
+		}
+	}
+
+	// A closed wall is too steep to drive, and a hole in the terrain cannot be driven either
+	for (float GapHeight : { 5000.f, FTerrainHeightfield::NoTerrain })
+	{
+		FTerrainHeightfield Heightfield;
+		ConvoyNavGridTests::BuildWalledHeightfield(GapHeight, Heightfield);
+		FConvoyNavGrid Grid;
+		Grid.Build(Heightfield, 200.f, 25.f, 5);
+
+		TArray<FIntPoint> Cells;
+		TestFalse(GapHeight == FTerrainHeightfield::NoTerrain ? TEXT("Route through a hole in the terrain") : TEXT("Route over a closed wall"), Grid.FindCellPath(Grid.GetCell(Start), Grid.GetCell(Goal), nullptr, Cells));
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,14 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class FlightCore : ModuleRules
+{
+	public FlightCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// Plain C++ on top of Core only, so it can be stepped, tested and benchmarked without a world
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
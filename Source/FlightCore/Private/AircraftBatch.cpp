@@ -0,0 +1,142 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "AircraftBatch.h"
+
+int32 FAircraftBatch::Add(const FFlightModelParams& InParams, const FVector& Location, const FQuat& Rotation, const FFlightModelState& State)
+{
+	Params.Add(InParams);
+	ThrustInputs.Add(0.f);
+	UpInputs.Add(0.f);
+	RightInputs.Add(0.f);
+	YawInputs.Add(0.f);
+	ForwardSpeeds.Add(State.ForwardSpeed);
+	Accelerations.Add(State.Acceleration);
+	PitchSpeeds.Add(State.PitchSpeed);
+	YawSpeeds.Add(State.YawSpeed);
+	RollSpeeds.Add(State.RollSpeed);
+	Locations.Add(Location);
+	Rotations.Add(Rotation);
+	PreviousLocations.Add(Location);
+	return PreviousRotations.Add(Rotation);
+}
+
+void FAircraftBatch::RemoveAtSwap(int32 Index)
+{
+	Params.RemoveAtSwap(Index, 1, false);
+	ThrustInputs.RemoveAtSwap(Index, 1, false);
+	UpInputs.RemoveAtSwap(Index, 1, false);
+	RightInputs.RemoveAtSwap(Index, 1, false);
+	YawInputs.RemoveAtSwap(Index, 1, false);
+	ForwardSpeeds.RemoveAtSwap(Index, 1, false);
+	Accelerations.RemoveAtSwap(Index, 1, false);
+	PitchSpeeds.RemoveAtSwap(Index, 1, false);
+	YawSpeeds.RemoveAtSwap(Index, 1, false);
+	RollSpeeds.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Rotations.RemoveAtSwap(Index, 1, false);
+	PreviousLocations.RemoveAtSwap(Index, 1, false);
+	PreviousRotations.RemoveAtSwap(Index, 1, false);
+}
+
+void FAircraftBatch::Empty()
+{
+	Params.Empty();
+	ThrustInputs.Empty();
+	UpInputs.Empty();
+	RightInputs.Empty();
+	YawInputs.Empty();
+	ForwardSpeeds.Empty();
+	Accelerations.Empty();
+	PitchSpeeds.Empty();
+	YawSpeeds.Empty();
+	RollSpeeds.Empty();
+	Locations.Empty();
+	Rotations.Empty();
+	PreviousLocations.Empty();
+	PreviousRotations.Empty();
+}
+
+void FAircraftBatch::SetInput(int32 Index, const FFlightModelInput& Input)
+{
+	ThrustInputs[Index] = Input.Thrust;
+	UpInputs[Index] = Input.Up;
+	RightInputs[Index] = Input.Right;
+	YawInputs[Index] = Input.Yaw;
+}
+
+FFlightModelState FAircraftBatch::GetState(int32 Index) const
+{
+	FFlightModelState State;
+	State.ForwardSpeed = ForwardSpeeds[Index];
+	State.Acceleration = Accelerations[Index];
+	State.PitchSpeed = PitchSpeeds[Index];
+	State.YawSpeed = YawSpeeds[Index];
+	State.RollSpeed = RollSpeeds[Index];
+	return State;
+}
+
+void FAircraftBatch::Step(float StepTime, int32 BeginIndex, int32 EndIndex)
+{
+	check(BeginIndex >= 0 && EndIndex <= Num());
+	if (BeginIndex >= EndIndex)
+	{
+		return;
+	}
+
+	// FInterpTo at speed 2, without its snap to the target, so the speed loops carry no branches
+	const float InterpAlpha = FMath::Clamp(StepTime * 2.f, 0.f, 1.f);
+
+	const FFlightModelParams* RESTRICT Limits = Params.GetData();
+	const float* RESTRICT Thrust = ThrustInputs.GetData();
+	const float* RESTRICT Up = UpInputs.GetData();
+	const float* RESTRICT Right = RightInputs.GetData();
+	const float* RESTRICT Yaw = YawInputs.GetData();
+	float* RESTRICT Forward = ForwardSpeeds.GetData();
+	float* RESTRICT Acceleration = Accelerations.GetData();
+	float* RESTRICT Pitch = PitchSpeeds.GetData();
+	float* RESTRICT YawRate = YawSpeeds.GetData();
+	float* RESTRICT Roll = RollSpeeds.GetData();
+
+	// Same order as FFlightModel::Step: thrust, then pitch from the old yaw rate, roll and yaw, then speed
+	for (int32 Index = BeginIndex; Index < EndIndex; Index++)
+	{
+		const float ThrustChange = FMath::Abs(Thrust[Index]) > KINDA_SMALL_NUMBER ? Thrust[Index] * Limits[Index].Acceleration : -0.4f * Acceleration[Index];
+		Acceleration[Index] = FMath::Clamp(Acceleration[Index] + StepTime * ThrustChange, Limits[Index].MinAcceleration, Limits[Index].MaxAcceleration);
+	}
+	for (int32 Index = BeginIndex; Index < EndIndex; Index++)
+	{
+		const float TargetPitchSpeed = -Up[Index] * Limits[Index].TurnSpeed - FMath::Abs(YawRate[Index]) * 0.2f;
+		Pitch[Index] += (TargetPitchSpeed - Pitch[Index]) * InterpAlpha;
+		Roll[Index] += (2.f * Right[Index] * Limits[Index].TurnSpeed - Roll[Index]) * InterpAlpha;
+		YawRate[Index] += (2.f * Yaw[Index] * Limits[Index].YawSpeed - YawRate[Index]) * InterpAlpha;
+	}
+	for (int32 Index = BeginIndex; Index < EndIndex; Index++)
+	{
+		Forward[Index] = FMath::Clamp(Forward[Index] + StepTime * Acceleration[Index], Limits[Index].MinSpeed, Limits[Index].MaxSpeed);
+	}
+
+	FMemory::Memcpy(&PreviousLocations[BeginIndex], &Locations[BeginIndex], (EndIndex - BeginIndex) * sizeof(FVector));
+	FMemory::Memcpy(&PreviousRotations[BeginIndex], &Rotations[BeginIndex], (EndIndex - BeginIndex) * sizeof(FQuat));
+
+	const VectorRegister StepTimeVector = VectorSetFloat1(StepTime);
+	for (int32 Index = BeginIndex; Index < EndIndex; Index++)
+	{
+		const VectorRegister Rotation = VectorLoad(&Rotations[Index]);
+
+		// Move along the old facing, then rotate in local space, as a pawn does
+		const VectorRegister LocalMove = VectorMultiply(VectorSet(Forward[Index], 0.f, 0.f, 0.f), StepTimeVector);
+		const VectorRegister Location = VectorAdd(VectorLoadFloat3(&Locations[Index]), VectorQuaternionRotateVector(Rotation, LocalMove));
+		VectorStoreFloat3(Location, &Locations[Index]);
+
+		const FQuat DeltaRotation = FRotator(Pitch[Index] * StepTime, YawRate[Index] * StepTime, Roll[Index] * StepTime).Quaternion();
+		const VectorRegister NewRotation = VectorQuaternionMultiply2(Rotation, VectorLoad(&DeltaRotation));
+		VectorStore(VectorNormalizeQuaternion(NewRotation), &Rotations[Index]);
+	}
+}
+
+FTransform FAircraftBatch::GetInterpolatedTransform(int32 Index, float Alpha) const
+{
+	const FVector Location = FMath::Lerp(PreviousLocations[Index], Locations[Index], Alpha);
+	const FQuat Rotation = FQuat::FastLerp(PreviousRotations[Index], Rotations[Index], Alpha).GetNormalized();
+	return FTransform(Rotation, Location);
+}
@@ -0,0 +1,121 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "FlightModel.h"
+#include "Ballistics.h"
+#include "InterceptSolver.h"
+#include "MissileGuidance.h"
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, FlightCore);
+
+void FFlightModel::StepBatch(const FFlightModelParams& Params, TArrayView<const FFlightModelInput> Inputs, TArrayView<FAircraftState> States, float StepTime)
+{
+	check(Inputs.Num() == States.Num());
+
+	FVector LocalMove;
+	FRotator DeltaRotation;
+	for (int32 Index = 0; Index < States.Num(); Index++)
+	{
+		FAircraftState& Aircraft = States[Index];
+		Step(Params, Inputs[Index], StepTime, Aircraft.Flight, LocalMove, DeltaRotation);
+
+		// Same order as a pawn: move along the old facing, then rotate in local space
+		Aircraft.Location += Aircraft.Rotation.RotateVector(LocalMove);
+		Aircraft.Rotation = Aircraft.Rotation * DeltaRotation.Quaternion();
+		Aircraft.Rotation.Normalize();
+	}
+}
+
+void FBallistics::StepBatch(TArrayView<FVector> Locations, TArrayView<FVector> Velocities, const FVector& Gravity, float StepTime)
+{
+	check(Locations.Num() == Velocities.Num());
+
+	const FVector HalfGravityStep = Gravity * (0.5f * StepTime * StepTime);
+	const FVector GravityStep = Gravity * StepTime;
+	FVector* RESTRICT Location = Locations.GetData();
+	FVector* RESTRICT Velocity = Velocities.GetData();
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		Location[Index] += Velocity[Index] * StepTime + HalfGravityStep;
+		Velocity[Index] += GravityStep;
+	}
+}
+
+void FInterceptSolver::SolveBatch(const FInterceptShooter& Shooter, TArrayView<const FVector> TargetLocations, TArrayView<const FVector> TargetVelocities,
+	TArrayView<const float> TargetRadii, TArrayView<FInterceptSolution> OutSolutions)
+{
+	check(TargetVelocities.Num() == TargetLocations.Num() && TargetRadii.Num() == TargetLocations.Num() && OutSolutions.Num() == TargetLocations.Num());
+
+	const float InvRoundSpeed = 1.f / FMath::Max(Shooter.RoundSpeed, 1.f);
+	const FVector HalfGravity = Shooter.Gravity * 0.5f;
+	const float TanCone = FMath::Tan(FMath::DegreesToRadians(FMath::Max(Shooter.DispersionCone, 0.f)));
+
+	// Targets the rounds cannot catch would run the flight time away, they are out of range long before this
+	const float FlightTimeLimit = 2.f * Shooter.MaxFlightTime;
+
+	for (int32 Index = 0; Index < TargetLocations.Num(); Index++)
+	{
+		const FVector ToTarget = TargetLocations[Index] - Shooter.MuzzleLocation;
+		const FVector TargetVelocity = TargetVelocities[Index];
+
+		// The gun must point at where the target will be, raised by the drop over the flight time
+		float FlightTime = FMath::Min(ToTarget.Size() * InvRoundSpeed, FlightTimeLimit);
+		for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+		{
+			const FVector Lead = ToTarget + TargetVelocity * FlightTime - HalfGravity * (FlightTime * FlightTime);
+			FlightTime = FMath::Min(Lead.Size() * InvRoundSpeed, FlightTimeLimit);
+		}
+		const FVector Lead = ToTarget + TargetVelocity * FlightTime - HalfGravity * (FlightTime * FlightTime);
+
+		// How far the current aim passes from the lead point, against how wide the rounds are spread there
+		const float RangeSquared = Lead.SizeSquared();
+		const float Along = FVector::DotProduct(Lead, Shooter.AimDirection);
+		const float Miss = FMath::Sqrt(FMath::Max(RangeSquared - Along * Along, 0.f));
+		const float Spread = FMath::Max(FMath::Sqrt(RangeSquared) * TanCone, 1.f);
+		const float Radius = TargetRadii[Index];
+		const float OverlapAcross = FMath::Max(FMath::Min(Miss + Radius, Spread) - FMath::Max(Miss - Radius, -Spread), 0.f);
+		const float OverlapSide = 2.f * FMath::Min(Radius, Spread);
+		const float HitProbability = OverlapAcross * OverlapSide / (4.f * Spread * Spread);
+
+		FInterceptSolution& Solution = OutSolutions[Index];
+		Solution.AimPoint = Shooter.MuzzleLocation + Lead;
+		Solution.FlightTime = FlightTime;
+		Solution.HitProbability = (FlightTime <= Shooter.MaxFlightTime && Along > 0.f) ? HitProbability : 0.f;
+	}
+}
+
+void FMissileGuidance::StepBatch(TArrayView<const FMissileGuidanceParams> Params, TArrayView<FVector> Locations, TArrayView<FVector> Velocities,
+	TArrayView<const FVector> TargetLocations, TArrayView<const FVector> TargetVelocities, TArrayView<const bool> Tracking,
+	TArrayView<float> OutClosestApproach, TArrayView<float> OutApproachTimes, float StepTime)
+{
+	const int32 NumMissiles = Locations.Num();
+	check(Params.Num() == NumMissiles && Velocities.Num() == NumMissiles && TargetLocations.Num() == NumMissiles
+		&& TargetVelocities.Num() == NumMissiles && Tracking.Num() == NumMissiles && OutClosestApproach.Num() == NumMissiles
+		&& OutApproachTimes.Num() == NumMissiles);
+
+	for (int32 Index = 0; Index < NumMissiles; Index++)
+	{
+		const FMissileGuidanceParams& Missile = Params[Index];
+		const FVector ToTarget = TargetLocations[Index] - Locations[Index];
+		const FVector ClosingVelocity = TargetVelocities[Index] - Velocities[Index];
+
+		// Line of sight rate, then turn the velocity about it N times as fast: a = N * (Omega x V)
+		const float RangeSquared = FMath::Max(ToTarget.SizeSquared(), 1.f);
+		const FVector LineOfSightRate = FVector::CrossProduct(ToTarget, ClosingVelocity) / RangeSquared;
+		FVector Acceleration = FVector::CrossProduct(LineOfSightRate, Velocities[Index]) * Missile.NavigationConstant;
+		Acceleration = Acceleration.GetClampedToMaxSize(Missile.MaxAcceleration) * (Tracking[Index] ? 1.f : 0.f);
+
+		// Turning only, the speed is held
+		const FVector Velocity = (Velocities[Index] + Acceleration * StepTime).GetSafeNormal() * Missile.Speed;
+
+		// Closest approach over the step, with both moving in straight lines
+		const FVector RelativeVelocity = TargetVelocities[Index] - Velocity;
+		const float ApproachTime = FMath::Clamp(-FVector::DotProduct(ToTarget, RelativeVelocity) / FMath::Max(RelativeVelocity.SizeSquared(), KINDA_SMALL_NUMBER), 0.f, StepTime);
+		const float ClosestApproach = (ToTarget + RelativeVelocity * ApproachTime).Size();
+
+		Velocities[Index] = Velocity;
+		Locations[Index] += Velocity * StepTime;
+		OutClosestApproach[Index] = Tracking[Index] ? ClosestApproach : MAX_flt;
+		OutApproachTimes[Index] = ApproachTime;
+	}
+}
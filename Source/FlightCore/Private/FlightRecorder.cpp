@@ -0,0 +1,275 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "FlightRecorder.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/Archive.h"
+
+namespace FlightRecorder
+{
+	/** "ACFR" */
+	static const uint32 Magic = 0x52464341;
+	static const uint32 Version = 1;
+	static const int32 NumFields = 17;
+
+	/** Value of one step of each quantized field, the file is exact to half of it */
+	static const float Resolutions[NumFields] =
+	{
+		1e-4f, 1e-5f,			// Time, FrameTime in s
+		0.1f, 0.1f, 0.1f,		// Location in cm
+		1e-3f, 1e-3f, 1e-3f,	// Rotation in degrees
+		1e-4f, 1e-4f, 1e-4f, 1e-4f,	// Inputs
+		0.1f, 0.1f,				// ForwardSpeed, Acceleration in cm/s and cm/s^2
+		1e-3f, 1e-3f, 1e-3f,	// Pitch, yaw and roll rates in degrees/s
+	};
+
+	static const TCHAR* const FieldNames[NumFields] =
+	{
+		TEXT("Time"), TEXT("FrameTime"),
+		TEXT("X"), TEXT("Y"), TEXT("Z"),
+		TEXT("Pitch"), TEXT("Yaw"), TEXT("Roll"),
+		TEXT("ThrustInput"), TEXT("UpInput"), TEXT("RightInput"), TEXT("YawInput"),
+		TEXT("ForwardSpeed"), TEXT("Acceleration"),
+		TEXT("PitchSpeed"), TEXT("YawSpeed"), TEXT("RollSpeed"),
+	};
+
+	static void ToFields(const FFlightRecord& Record, float* OutFields)
+	{
+		const float Fields[NumFields] =
+		{
+			Record.Time, Record.FrameTime,
+			Record.Location.X, Record.Location.Y, Record.Location.Z,
+			Record.Rotation.Pitch, Record.Rotation.Yaw, Record.Rotation.Roll,
+			Record.Input.Thrust, Record.Input.Up, Record.Input.Right, Record.Input.Yaw,
+			Record.State.ForwardSpeed, Record.State.Acceleration,
+			Record.State.PitchSpeed, Record.State.YawSpeed, Record.State.RollSpeed,
+		};
+		FMemory::Memcpy(OutFields, Fields, sizeof(Fields));
+	}
+
+	static void FromFields(const float* Fields, FFlightRecord& OutRecord)
+	{
+		OutRecord.Time = Fields[0];
+		OutRecord.FrameTime = Fields[1];
+		OutRecord.Location = FVector(Fields[2], Fields[3], Fields[4]);
+		OutRecord.Rotation = FRotator(Fields[5], Fields[6], Fields[7]);
+		OutRecord.Input.Thrust = Fields[8];
+		OutRecord.Input.Up = Fields[9];
+		OutRecord.Input.Right = Fields[10];
+		OutRecord.Input.Yaw = Fields[11];
+		OutRecord.State.ForwardSpeed = Fields[12];
+		OutRecord.State.Acceleration = Fields[13];
+		OutRecord.State.PitchSpeed = Fields[14];
+		OutRecord.State.YawSpeed = Fields[15];
+		OutRecord.State.RollSpeed = Fields[16];
+	}
+
+	/** Seven bits per byte, the high bit set on every byte but the last */
+	static FORCEINLINE void WriteVarint(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(uint8(Value) | 0x80);
+			Value >>= 7;
+		}
+		Out.Add(uint8(Value));
+	}
+
+	static FORCEINLINE bool ReadVarint(const uint8*& Cursor, const uint8* End, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 35 && Cursor < End; Shift += 7)
+		{
+			const uint8 Byte = *Cursor++;
+			OutValue |= uint32(Byte & 0x7f) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Maps small negative and positive deltas alike to small unsigned values */
+	static FORCEINLINE uint32 ZigZag(int32 Value)
+	{
+		return (uint32(Value) << 1) ^ uint32(Value >> 31);
+	}
+
+	static FORCEINLINE int32 UnZigZag(uint32 Value)
+	{
+		return int32(Value >> 1) ^ -int32(Value & 1);
+	}
+}
+
+TUniquePtr<FFlightRecorder> FFlightRecorder::Create(const FString& Filename, uint32 Capacity)
+{
+	FArchive* Archive = IFileManager::Get().CreateFileWriter(*Filename);
+	if (Archive == nullptr)
+	{
+		return nullptr;
+	}
+
+	// The header carries the resolutions, so a reader does not depend on the writer's version of them
+	uint32 Magic = FlightRecorder::Magic;
+	uint32 Version = FlightRecorder::Version;
+	int32 NumFields = FlightRecorder::NumFields;
+	*Archive << Magic << Version << NumFields;
+	for (int32 Field = 0; Field < FlightRecorder::NumFields; Field++)
+	{
+		float Resolution = FlightRecorder::Resolutions[Field];
+		*Archive << Resolution;
+	}
+
+	TUniquePtr<FFlightRecorder> Recorder(new FFlightRecorder(Archive, Capacity));
+	Recorder->Thread = FRunnableThread::Create(Recorder.Get(), TEXT("FlightRecorder"), 0, TPri_BelowNormal);
+	return Recorder;
+}
+
+FFlightRecorder::FFlightRecorder(FArchive* InArchive, uint32 Capacity)
+	: Queue(Capacity + 1)
+	, Archive(InArchive)
+	, Thread(nullptr)
+	, NumDropped(0)
+{
+	Previous.SetNumZeroed(FlightRecorder::NumFields);
+}
+
+FFlightRecorder::~FFlightRecorder()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
+	else
+	{
+		// Without threads everything recorded so far is written now
+		Drain();
+	}
+
+	delete Archive;
+}
+
+uint32 FFlightRecorder::Run()
+{
+	while (!bStopping)
+	{
+		Drain();
+		FPlatformProcess::Sleep(0.01f);
+	}
+
+	// Whatever was queued before stopping still goes to the file
+	Drain();
+	return 0;
+}
+
+void FFlightRecorder::Stop()
+{
+	bStopping = true;
+}
+
+void FFlightRecorder::Drain()
+{
+	float Fields[FlightRecorder::NumFields];
+	FFlightRecord Record;
+	while (Queue.Dequeue(Record))
+	{
+		FlightRecorder::ToFields(Record, Fields);
+		for (int32 Field = 0; Field < FlightRecorder::NumFields; Field++)
+		{
+			const float Steps = FMath::Clamp(Fields[Field] / FlightRecorder::Resolutions[Field], -2.0e9f, 2.0e9f);
+			const int32 Quantized = FMath::RoundToInt(Steps);
+
+			// Wrapping arithmetic, so any two quantized values have a delta that round trips
+			const int32 Delta = int32(uint32(Quantized) - uint32(Previous[Field]));
+			FlightRecorder::WriteVarint(Buffer, FlightRecorder::ZigZag(Delta));
+			Previous[Field] = Quantized;
+		}
+	}
+
+	if (Buffer.Num() > 0)
+	{
+		Archive->Serialize(Buffer.GetData(), Buffer.Num());
+		Archive->Flush();
+		Buffer.Reset();
+	}
+}
+
+bool FFlightRecordReader::Read(const FString& Filename, TArray<FFlightRecord>& OutRecords)
+{
+	OutRecords.Reset();
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		return false;
+	}
+
+	const int32 HeaderSize = 3 * sizeof(uint32) + FlightRecorder::NumFields * sizeof(float);
+	if (Bytes.Num() < HeaderSize)
+	{
+		return false;
+	}
+
+	uint32 Header[3];
+	FMemory::Memcpy(Header, Bytes.GetData(), sizeof(Header));
+	if (Header[0] != FlightRecorder::Magic || Header[1] != FlightRecorder::Version || Header[2] != uint32(FlightRecorder::NumFields))
+	{
+		return false;
+	}
+
+	float Resolutions[FlightRecorder::NumFields];
+	FMemory::Memcpy(Resolutions, Bytes.GetData() + sizeof(Header), sizeof(Resolutions));
+
+	int32 Quantized[FlightRecorder::NumFields] = {};
+	float Fields[FlightRecorder::NumFields];
+	const uint8* Cursor = Bytes.GetData() + HeaderSize;
+	const uint8* End = Bytes.GetData() + Bytes.Num();
+	while (Cursor < End)
+	{
+		for (int32 Field = 0; Field < FlightRecorder::NumFields; Field++)
+		{
+			uint32 Encoded;
+			if (!FlightRecorder::ReadVarint(Cursor, End, Encoded))
+			{
+				// A record cut short by a crash ends the file
+				return true;
+			}
+			Quantized[Field] = int32(uint32(Quantized[Field]) + uint32(FlightRecorder::UnZigZag(Encoded)));
+			Fields[Field] = Quantized[Field] * Resolutions[Field];
+		}
+		FlightRecorder::FromFields(Fields, OutRecords.AddDefaulted_GetRef());
+	}
+	return true;
+}
+
+bool FFlightRecordReader::ExportCsv(const FString& Filename, const FString& CsvFilename)
+{
+	TArray<FFlightRecord> Records;
+	if (!Read(Filename, Records))
+	{
+		return false;
+	}
+
+	FString Csv = FString::Join(TArrayView<const TCHAR* const>(FlightRecorder::FieldNames, FlightRecorder::NumFields), TEXT(","));
+	Csv += LINE_TERMINATOR;
+
+	float Fields[FlightRecorder::NumFields];
+	for (const FFlightRecord& Record : Records)
+	{
+		FlightRecorder::ToFields(Record, Fields);
+		for (int32 Field = 0; Field < FlightRecorder::NumFields; Field++)
+		{
+			if (Field > 0)
+			{
+				Csv += TEXT(",");
+			}
+			Csv += FString::SanitizeFloat(Fields[Field]);
+		}
+		Csv += LINE_TERMINATOR;
+	}
+	return FFileHelper::SaveStringToFile(Csv, *CsvFilename);
+}
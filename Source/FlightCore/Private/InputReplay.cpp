@@ -0,0 +1,83 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "InputReplay.h"
+#include "HAL/FileManager.h"
+#include "Serialization/Archive.h"
+
+namespace InputReplay
+{
+	/** "ACIR" */
+	static const uint32 Magic = 0x52494341;
+	static const uint32 Version = 1;
+
+	/** Floats are stored exactly, any rounding would make the replay drift from the recorded flight */
+	static void Serialize(FArchive& Ar, FInputReplay& Replay)
+	{
+		Ar << Replay.Seed << Replay.StepRate << Replay.StartLocation << Replay.StartRotation;
+
+		FFlightModelState& State = Replay.StartState;
+		Ar << State.ForwardSpeed << State.Acceleration << State.PitchSpeed << State.YawSpeed << State.RollSpeed;
+
+		int32 NumSteps = Replay.Steps.Num();
+		Ar << NumSteps;
+		if (Ar.IsLoading())
+		{
+			// Bounded by what the file can hold, so a damaged count cannot request a huge allocation
+			const int64 MaxSteps = (Ar.TotalSize() - Ar.Tell()) / (6 * sizeof(float) + sizeof(uint8));
+			if (NumSteps < 0 || NumSteps > MaxSteps)
+			{
+				Ar.SetError();
+				return;
+			}
+			Replay.Steps.SetNum(NumSteps);
+		}
+
+		for (FInputReplayStep& Step : Replay.Steps)
+		{
+			Ar << Step.Flight.Thrust << Step.Flight.Up << Step.Flight.Right << Step.Flight.Yaw;
+			Ar << Step.CameraRight << Step.CameraUp << Step.Actions;
+		}
+	}
+}
+
+bool FInputReplay::Save(const FString& Filename) const
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Ar)
+	{
+		return false;
+	}
+
+	uint32 Magic = InputReplay::Magic;
+	uint32 Version = InputReplay::Version;
+	*Ar << Magic << Version;
+
+	// Serialization is symmetric, the archive only reads from the replay when saving
+	InputReplay::Serialize(*Ar, const_cast<FInputReplay&>(*this));
+	return Ar->Close();
+}
+
+bool FInputReplay::Load(const FString& Filename)
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Ar)
+	{
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Ar << Magic << Version;
+	if (Ar->IsError() || Magic != InputReplay::Magic || Version != InputReplay::Version)
+	{
+		return false;
+	}
+
+	InputReplay::Serialize(*Ar, *this);
+	if (Ar->IsError())
+	{
+		Steps.Reset();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,344 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "TerrainHeightfield.h"
+
+namespace TerrainHeightfield
+{
+	/** Narrows [InOutTimeIn, InOutTimeOut] to where Start + Delta * Time lies within [Min, Max] on one axis */
+	static FORCEINLINE bool ClipSlab(float Start, float Delta, float Min, float Max, float& InOutTimeIn, float& InOutTimeOut)
+	{
+		if (FMath::IsNearlyZero(Delta))
+		{
+			return Start >= Min && Start <= Max;
+		}
+
+		const float InvDelta = 1.f / Delta;
+		float TimeIn = (Min - Start) * InvDelta;
+		float TimeOut = (Max - Start) * InvDelta;
+		if (TimeIn > TimeOut)
+		{
+			Swap(TimeIn, TimeOut);
+		}
+		InOutTimeIn = FMath::Max(InOutTimeIn, TimeIn);
+		InOutTimeOut = FMath::Min(InOutTimeOut, TimeOut);
+		return InOutTimeIn <= InOutTimeOut;
+	}
+
+	/** Two sided segment against triangle A, B, C, lowers InOutTime when the crossing is earlier */
+	static FORCEINLINE bool IntersectTriangle(const FVector& Start, const FVector& Delta, const FVector& A, const FVector& B, const FVector& C, float& InOutTime)
+	{
+		const FVector EdgeB = B - A;
+		const FVector EdgeC = C - A;
+		const FVector P = Delta ^ EdgeC;
+		const float Det = EdgeB | P;
+		if (FMath::IsNearlyZero(Det, SMALL_NUMBER))
+		{
+			return false;
+		}
+
+		const float InvDet = 1.f / Det;
+		const FVector ToStart = Start - A;
+		const float U = (ToStart | P) * InvDet;
+		if (U < 0.f || U > 1.f)
+		{
+			return false;
+		}
+
+		const FVector Q = ToStart ^ EdgeB;
+		const float V = (Delta | Q) * InvDet;
+		if (V < 0.f || U + V > 1.f)
+		{
+			return false;
+		}
+
+		const float Time = (EdgeC | Q) * InvDet;
+		if (Time < 0.f || Time > InOutTime)
+		{
+			return false;
+		}
+		InOutTime = Time;
+		return true;
+	}
+}
+
+const float FTerrainHeightfield::NoTerrain = -MAX_flt;
+
+FTerrainHeightfield::FTerrainHeightfield()
+	: Origin(FVector2D::ZeroVector)
+	, Spacing(1.f)
+	, InvSpacing(1.f)
+	, NumX(0)
+	, NumY(0)
+	, TilesX(0)
+	, MinHeight(0.f)
+	, HeightStep(1.f)
+{
+}
+
+void FTerrainHeightfield::Build(const FVector2D& InOrigin, float InSpacing, int32 InNumX, int32 InNumY, TArrayView<const float> Heights)
+{
+	check(InNumX >= 2 && InNumY >= 2 && InSpacing > 0.f);
+	check(Heights.Num() == InNumX * InNumY);
+
+	Origin = InOrigin;
+	Spacing = InSpacing;
+	InvSpacing = 1.f / InSpacing;
+	NumX = InNumX;
+	NumY = InNumY;
+	TilesX = FMath::DivideAndRoundUp(NumX, TileSize);
+	const int32 TilesY = FMath::DivideAndRoundUp(NumY, TileSize);
+
+	float LowestHeight = MAX_flt;
+	float HighestHeight = -MAX_flt;
+	for (float Height : Heights)
+	{
+		if (Height != NoTerrain)
+		{
+			LowestHeight = FMath::Min(LowestHeight, Height);
+			HighestHeight = FMath::Max(HighestHeight, Height);
+		}
+	}
+
+	// The top quantized value is kept for samples without terrain
+	MinHeight = LowestHeight <= HighestHeight ? LowestHeight : 0.f;
+	HeightStep = HighestHeight > LowestHeight ? (HighestHeight - LowestHeight) / (NoTerrainSample - 1) : 1.f;
+
+	Samples.Reset();
+	Samples.SetNumZeroed(TilesX * TilesY * TileSize * TileSize);
+	for (int32 Y = 0; Y < NumY; Y++)
+	{
+		for (int32 X = 0; X < NumX; X++)
+		{
+			const float Height = Heights[Y * NumX + X];
+			Samples[GetSampleIndex(X, Y)] = Height == NoTerrain ? NoTerrainSample : (uint16)FMath::Clamp(FMath::RoundToInt((Height - MinHeight) / HeightStep), 0, NoTerrainSample - 1);
+		}
+	}
+
+	// Level 0 bounds each grid cell by its four corners, a cell missing any corner holds no terrain
+	Levels.Reset();
+	LevelSizes.Reset();
+	FIntPoint Size(NumX - 1, NumY - 1);
+	TArray<FMinMax>& Cells = Levels.AddDefaulted_GetRef();
+	LevelSizes.Add(Size);
+	Cells.SetNumUninitialized(Size.X * Size.Y);
+	for (int32 Y = 0; Y < Size.Y; Y++)
+	{
+		for (int32 X = 0; X < Size.X; X++)
+		{
+			const uint16 H00 = Samples[GetSampleIndex(X, Y)];
+			const uint16 H10 = Samples[GetSampleIndex(X + 1, Y)];
+			const uint16 H01 = Samples[GetSampleIndex(X, Y + 1)];
+			const uint16 H11 = Samples[GetSampleIndex(X + 1, Y + 1)];
+			const uint16 Highest = FMath::Max(FMath::Max(H00, H10), FMath::Max(H01, H11));
+			Cells[Y * Size.X + X] = Highest == NoTerrainSample ? FMinMax{ NoTerrainSample, 0 } : FMinMax{ FMath::Min(FMath::Min(H00, H10), FMath::Min(H01, H11)), Highest };
+		}
+	}
+
+	// Each level above halves the one below until a single cell covers the whole grid
+	while (Size.X > 1 || Size.Y > 1)
+	{
+		const FIntPoint ChildSize = Size;
+		Size = FIntPoint(FMath::DivideAndRoundUp(ChildSize.X, 2), FMath::DivideAndRoundUp(ChildSize.Y, 2));
+		const TArray<FMinMax> Children = Levels.Last();
+		TArray<FMinMax>& Parents = Levels.AddDefaulted_GetRef();
+		LevelSizes.Add(Size);
+		Parents.SetNumUninitialized(Size.X * Size.Y);
+		for (int32 Y = 0; Y < Size.Y; Y++)
+		{
+			for (int32 X = 0; X < Size.X; X++)
+			{
+				FMinMax Bounds = { NoTerrainSample, 0 };
+				for (int32 ChildY = Y * 2; ChildY < FMath::Min(Y * 2 + 2, ChildSize.Y); ChildY++)
+				{
+					for (int32 ChildX = X * 2; ChildX < FMath::Min(X * 2 + 2, ChildSize.X); ChildX++)
+					{
+						const FMinMax& Child = Children[ChildY * ChildSize.X + ChildX];
+						Bounds.Min = FMath::Min(Bounds.Min, Child.Min);
+						Bounds.Max = FMath::Max(Bounds.Max, Child.Max);
+					}
+				}
+				Parents[Y * Size.X + X] = Bounds;
+			}
+		}
+	}
+}
+
+bool FTerrainHeightfield::GetHeight(float X, float Y, float& OutHeight) const
+{
+	const float GridX = (X - Origin.X) * InvSpacing;
+	const float GridY = (Y - Origin.Y) * InvSpacing;
+	if (!IsValid() || GridX < 0.f || GridY < 0.f || GridX > NumX - 1 || GridY > NumY - 1)
+	{
+		return false;
+	}
+
+	const int32 CellX = FMath::Min(FMath::FloorToInt(GridX), NumX - 2);
+	const int32 CellY = FMath::Min(FMath::FloorToInt(GridY), NumY - 2);
+	const FMinMax& Cell = Levels[0][CellY * LevelSizes[0].X + CellX];
+	if (Cell.Min > Cell.Max)
+	{
+		return false;
+	}
+
+	const float FracX = GridX - CellX;
+	const float FracY = GridY - CellY;
+	const float H00 = GetSampleHeight(CellX, CellY);
+	const float H11 = GetSampleHeight(CellX + 1, CellY + 1);
+
+	// Same two triangles per cell as the segment test, split along the 00-11 diagonal
+	if (FracX >= FracY)
+	{
+		const float H10 = GetSampleHeight(CellX + 1, CellY);
+		OutHeight = H00 + FracX * (H10 - H00) + FracY * (H11 - H10);
+	}
+	else
+	{
+		const float H01 = GetSampleHeight(CellX, CellY + 1);
+		OutHeight = H00 + FracY * (H01 - H00) + FracX * (H11 - H01);
+	}
+	return true;
+}
+
+bool FTerrainHeightfield::GetHeightAboveGround(const FVector& Location, float& OutHeight) const
+{
+	float GroundHeight;
+	if (!GetHeight(Location.X, Location.Y, GroundHeight))
+	{
+		return false;
+	}
+	OutHeight = Location.Z - GroundHeight;
+	return true;
+}
+
+bool FTerrainHeightfield::IntersectSegment(const FVector& Start, const FVector& End, float& OutTime) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	const FVector GridStart((Start.X - Origin.X) * InvSpacing, (Start.Y - Origin.Y) * InvSpacing, Start.Z);
+	const FVector GridDelta((End.X - Start.X) * InvSpacing, (End.Y - Start.Y) * InvSpacing, End.Z - Start.Z);
+	OutTime = 1.f;
+	return IntersectCell(Levels.Num() - 1, 0, 0, GridStart, GridDelta, OutTime);
+}
+
+bool FTerrainHeightfield::IntersectCell(int32 Level, int32 CellX, int32 CellY, const FVector& Start, const FVector& Delta, float& InOutTime) const
+{
+	const float MinX = float(CellX << Level);
+	const float MinY = float(CellY << Level);
+	const float MaxX = FMath::Min(float((CellX + 1) << Level), float(NumX - 1));
+	const float MaxY = FMath::Min(float((CellY + 1) << Level), float(NumY - 1));
+
+	float TimeIn = 0.f;
+	float TimeOut = InOutTime;
+	if (!TerrainHeightfield::ClipSlab(Start.X, Delta.X, MinX, MaxX, TimeIn, TimeOut) || !TerrainHeightfield::ClipSlab(Start.Y, Delta.Y, MinY, MaxY, TimeIn, TimeOut))
+	{
+		return false;
+	}
+
+	// The segment is straight, so its lowest point over the cell is at one end of the clipped part
+	const FMinMax& Bounds = Levels[Level][CellY * LevelSizes[Level].X + CellX];
+	if (Bounds.Min > Bounds.Max)
+	{
+		return false;
+	}
+	const float LowestZ = Start.Z + Delta.Z * (Delta.Z < 0.f ? TimeOut : TimeIn);
+	if (LowestZ > Decode(Bounds.Max))
+	{
+		return false;
+	}
+
+	if (Level == 0)
+	{
+		return IntersectGridCell(CellX, CellY, Start, Delta, InOutTime);
+	}
+
+	// Visit the children nearest the segment start first, so later ones are clipped by any hit found
+	const int32 ChildLevel = Level - 1;
+	const FIntPoint& ChildSize = LevelSizes[ChildLevel];
+	const int32 FlipX = Delta.X < 0.f ? 1 : 0;
+	const int32 FlipY = Delta.Y < 0.f ? 1 : 0;
+	bool bHit = false;
+	for (int32 OrderY = 0; OrderY < 2; OrderY++)
+	{
+		const int32 ChildY = CellY * 2 + (OrderY ^ FlipY);
+		if (ChildY >= ChildSize.Y)
+		{
+			continue;
+		}
+		for (int32 OrderX = 0; OrderX < 2; OrderX++)
+		{
+			const int32 ChildX = CellX * 2 + (OrderX ^ FlipX);
+			if (ChildX < ChildSize.X)
+			{
+				bHit |= IntersectCell(ChildLevel, ChildX, ChildY, Start, Delta, InOutTime);
+			}
+		}
+	}
+	return bHit;
+}
+
+bool FTerrainHeightfield::IntersectGridCell(int32 CellX, int32 CellY, const FVector& Start, const FVector& Delta, float& InOutTime) const
+{
+	const FVector P00(CellX, CellY, GetSampleHeight(CellX, CellY));
+	const FVector P10(CellX + 1, CellY, GetSampleHeight(CellX + 1, CellY));
+	const FVector P01(CellX, CellY + 1, GetSampleHeight(CellX, CellY + 1));
+	const FVector P11(CellX + 1, CellY + 1, GetSampleHeight(CellX + 1, CellY + 1));
+
+	bool bHit = TerrainHeightfield::IntersectTriangle(Start, Delta, P00, P10, P11, InOutTime);
+	bHit |= TerrainHeightfield::IntersectTriangle(Start, Delta, P00, P11, P01, InOutTime);
+	return bHit;
+}
+
+void FTerrainHeightfield::GetHeights(TArrayView<const FVector> Points, TArrayView<float> OutHeights, float OutsideHeight) const
+{
+	check(Points.Num() == OutHeights.Num());
+
+	for (int32 Index = 0; Index < Points.Num(); Index++)
+	{
+		if (!GetHeight(Points[Index].X, Points[Index].Y, OutHeights[Index]))
+		{
+			OutHeights[Index] = OutsideHeight;
+		}
+	}
+}
+
+void FTerrainHeightfield::IntersectSegments(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<float> OutTimes) const
+{
+	check(Starts.Num() == Ends.Num() && Starts.Num() == OutTimes.Num());
+
+	for (int32 Index = 0; Index < Starts.Num(); Index++)
+	{
+		if (!IntersectSegment(Starts[Index], Ends[Index], OutTimes[Index]))
+		{
+			OutTimes[Index] = 1.f;
+		}
+	}
+}
+
+FBox FTerrainHeightfield::GetBounds() const
+{
+	if (!IsValid())
+	{
+		return FBox(ForceInit);
+	}
+
+	const FVector2D Extent = FVector2D(NumX - 1, NumY - 1) * Spacing;
+	const FMinMax& Root = Levels.Last()[0];
+	if (Root.Min > Root.Max)
+	{
+		return FBox(ForceInit);
+	}
+	return FBox(FVector(Origin, Decode(Root.Min)), FVector(Origin + Extent, Decode(Root.Max)));
+}
+
+SIZE_T FTerrainHeightfield::GetAllocatedSize() const
+{
+	SIZE_T Size = Samples.GetAllocatedSize() + Levels.GetAllocatedSize() + LevelSizes.GetAllocatedSize();
+	for (const TArray<FMinMax>& Level : Levels)
+	{
+		Size += Level.GetAllocatedSize();
+	}
+	return Size;
+}
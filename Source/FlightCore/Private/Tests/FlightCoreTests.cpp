@@ -0,0 +1,298 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Misc/FileHelper.h"
+#include "HAL/FileManager.h"
+#include "FlightModel.h"
+#include "AircraftBatch.h"
+#include "Ballistics.h"
+#include "FlightRecorder.h"
+#include "InputReplay.h"
+#include "TerrainHeightfield.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FlightCoreTests
+{
+	/** Control axes that keep changing, so every term of the flight model is exercised */
+	static FFlightModelInput MakeInput(int32 Step, int32 Aircraft)
+	{
+		FFlightModelInput Input;
+		Input.Thrust = FMath::Sin(Step * 0.02f + Aircraft);
+		Input.Up = 0.5f * FMath::Cos(Step * 0.013f * (Aircraft + 1));
+		Input.Right = 0.5f * FMath::Sin(Step * 0.007f - Aircraft);
+		Input.Yaw = (Step / 60) % 2 ? 0.3f : -0.3f;
+		return Input;
+	}
+
+	static float PlaneHeight(float X, float Y)
+	{
+		return 0.5f * X - 0.25f * Y + 300.f;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAircraftBatchMatchesFlightModelTest, "ACRL.FlightCore.AircraftBatchMatchesFlightModel", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FAircraftBatchMatchesFlightModelTest::RunTest(const FString& Parameters)
+{
+	const FFlightModelParams Params;
+	const float StepTime = 1.f / 120.f;
+	const int32 NumAircraft = 4;
+	const int32 NumSteps = 240;
+
+	TArray<FAircraftState> States;
+	TArray<FFlightModelInput> Inputs;
+	FAircraftBatch Batch;
+	for (int32 Index = 0; Index < NumAircraft; Index++)
+	{
+		FAircraftState& State = States.AddDefaulted_GetRef();
+		State.Location = FVector(Index * 10000.f, 0.f, 50000.f);
+		State.Rotation = FRotator(0.f, Index * 30.f, 0.f).Quaternion();
+		State.Flight.ForwardSpeed = 20000.f;
+		Inputs.AddDefaulted();
+		Batch.Add(Params, State.Location, State.Rotation, State.Flight);
+	}
+
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		for (int32 Index = 0; Index < NumAircraft; Index++)
+		{
+			Inputs[Index] = FlightCoreTests::MakeInput(Step, Index);
+			Batch.SetInput(Index, Inputs[Index]);
+		}
+		FFlightModel::StepBatch(Params, Inputs, States, StepTime);
+		Batch.Step(StepTime, 0, NumAircraft);
+	}
+
+	// The batch skips FInterpTo's snap to target and rotates with vector maths, so only float rounding may differ
+	for (int32 Index = 0; Index < NumAircraft; Index++)
+	{
+		const FFlightModelState BatchState = Batch.GetState(Index);
+		TestTrue(*FString::Printf(TEXT("Aircraft %d location"), Index), Batch.Locations[Index].Equals(States[Index].Location, 2.f));
+		TestTrue(*FString::Printf(TEXT("Aircraft %d rotation"), Index), Batch.Rotations[Index].Equals(States[Index].Rotation, 1e-4f));
+		TestEqual(*FString::Printf(TEXT("Aircraft %d forward speed"), Index), BatchState.ForwardSpeed, States[Index].Flight.ForwardSpeed, 0.1f);
+		TestEqual(*FString::Printf(TEXT("Aircraft %d acceleration"), Index), BatchState.Acceleration, States[Index].Flight.Acceleration, 0.1f);
+		TestEqual(*FString::Printf(TEXT("Aircraft %d pitch speed"), Index), BatchState.PitchSpeed, States[Index].Flight.PitchSpeed, 1e-3f);
+		TestEqual(*FString::Printf(TEXT("Aircraft %d yaw speed"), Index), BatchState.YawSpeed, States[Index].Flight.YawSpeed, 1e-3f);
+		TestEqual(*FString::Printf(TEXT("Aircraft %d roll speed"), Index), BatchState.RollSpeed, States[Index].Flight.RollSpeed, 1e-3f);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBallisticsStepMatchesClosedFormTest, "ACRL.FlightCore.BallisticsStepMatchesClosedForm", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBallisticsStepMatchesClosedFormTest::RunTest(const FString& Parameters)
+{
+	const FVector Gravity(0.f, 0.f, -980.f);
+	const float FlightTime = 2.f;
+	const FVector Origins[] = { FVector::ZeroVector, FVector(1000.f, -2000.f, 30000.f), FVector(-5000.f, 0.f, 100.f) };
+	const FVector LaunchVelocities[] = { FVector(80000.f, 0.f, 0.f), FVector(0.f, 60000.f, 20000.f), FVector(-30000.f, 30000.f, -5000.f) };
+
+	// The update is exact for constant gravity, so coarse and fine steps must both land on the closed form
+	for (int32 NumSteps : { 8, 120 })
+	{
+		TArray<FVector> Locations(Origins, UE_ARRAY_COUNT(Origins));
+		TArray<FVector> Velocities(LaunchVelocities, UE_ARRAY_COUNT(LaunchVelocities));
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			FBallistics::StepBatch(Locations, Velocities, Gravity, FlightTime / NumSteps);
+		}
+
+		for (int32 Index = 0; Index < Locations.Num(); Index++)
+		{
+			const FVector Expected = FBallistics::EvaluateLocation(Origins[Index], LaunchVelocities[Index], Gravity, FlightTime);
+			const FVector ExpectedVelocity = FBallistics::EvaluateVelocity(LaunchVelocities[Index], Gravity, FlightTime);
+			TestTrue(*FString::Printf(TEXT("Round %d location after %d steps"), Index, NumSteps), Locations[Index].Equals(Expected, 1.f));
+			TestTrue(*FString::Printf(TEXT("Round %d velocity after %d steps"), Index, NumSteps), Velocities[Index].Equals(ExpectedVelocity, 0.1f));
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFlightRecorderRoundTripTest, "ACRL.FlightCore.FlightRecorderRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFlightRecorderRoundTripTest::RunTest(const FString& Parameters)
+{
+	const FString Filename = FPaths::AutomationTransientDir() / TEXT("FlightRecorderRoundTrip.acfr");
+
+	TArray<FFlightRecord> Records;
+	FAircraftState State;
+	State.Location = FVector(-120000.f, 45000.f, 30000.f);
+	State.Flight.ForwardSpeed = 20000.f;
+	for (int32 Step = 0; Step < 1000; Step++)
+	{
+		const FFlightModelInput Input = FlightCoreTests::MakeInput(Step, 0);
+		FFlightModel::StepBatch(FFlightModelParams(), MakeArrayView(&Input, 1), MakeArrayView(&State, 1), 1.f / 120.f);
+		Records.Add({ Step / 120.f, 1.f / 60.f, State.Location, State.Rotation.Rotator(), Input, State.Flight });
+	}
+
+	{
+		TUniquePtr<FFlightRecorder> Recorder = FFlightRecorder::Create(Filename);
+		if (!TestNotNull(TEXT("Recorder"), Recorder.Get()))
+		{
+			return false;
+		}
+		for (const FFlightRecord& Record : Records)
+		{
+			Recorder->Record(Record);
+		}
+		TestEqual(TEXT("Records dropped"), Recorder->GetNumDropped(), 0);
+	}
+
+	TArray<FFlightRecord> ReadRecords;
+	const bool bRead = FFlightRecordReader::Read(Filename, ReadRecords);
+	IFileManager::Get().Delete(*Filename);
+	if (!TestTrue(TEXT("Read"), bRead) || !TestEqual(TEXT("Records read"), ReadRecords.Num(), Records.Num()))
+	{
+		return false;
+	}
+
+	// Each field is quantized, to 0.1 cm for locations and speeds, 1e-3 degrees for angles and 1e-4 for inputs
+	for (int32 Index = 0; Index < Records.Num(); Index++)
+	{
+		const FFlightRecord& Written = Records[Index];
+		const FFlightRecord& Read = ReadRecords[Index];
+		const bool bMatches = FMath::IsNearlyEqual(Written.Time, Read.Time, 1e-4f)
+			&& FMath::IsNearlyEqual(Written.FrameTime, Read.FrameTime, 1e-5f)
+			&& Written.Location.Equals(Read.Location, 0.1f)
+			&& Written.Rotation.Equals(Read.Rotation, 1e-3f)
+			&& FMath::IsNearlyEqual(Written.Input.Thrust, Read.Input.Thrust, 1e-4f)
+			&& FMath::IsNearlyEqual(Written.Input.Up, Read.Input.Up, 1e-4f)
+			&& FMath::IsNearlyEqual(Written.Input.Right, Read.Input.Right, 1e-4f)
+			&& FMath::IsNearlyEqual(Written.Input.Yaw, Read.Input.Yaw, 1e-4f)
+			&& FMath::IsNearlyEqual(Written.State.ForwardSpeed, Read.State.ForwardSpeed, 0.1f)
+			&& FMath::IsNearlyEqual(Written.State.Acceleration, Read.State.Acceleration, 0.1f)
+			&& FMath::IsNearlyEqual(Written.State.PitchSpeed, Read.State.PitchSpeed, 1e-3f)
+			&& FMath::IsNearlyEqual(Written.State.YawSpeed, Read.State.YawSpeed, 1e-3f)
+			&& FMath::IsNearlyEqual(Written.State.RollSpeed, Read.State.RollSpeed, 1e-3f);
+		if (!bMatches)
+		{
+			AddError(FString::Printf(TEXT("Record %d differs after the round trip"), Index));
+			return false;
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInputReplayRoundTripTest, "ACRL.FlightCore.InputReplayRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FInputReplayRoundTripTest::RunTest(const FString& Parameters)
+{
+	const FString Filename = FPaths::AutomationTransientDir() / TEXT("InputReplayRoundTrip.acir");
+
+	FInputReplay Replay;
+	Replay.Seed = 0x5eed;
+	Replay.StepRate = 120.f;
+	Replay.StartLocation = FVector(1.5f, -2.25f, 30000.125f);
+	Replay.StartRotation = FRotator(3.f, 91.5f, -12.75f);
+	Replay.StartState.ForwardSpeed = 21000.3f;
+	Replay.StartState.Acceleration = -1234.5f;
+	Replay.StartState.RollSpeed = 7.77f;
+	for (int32 Step = 0; Step < 500; Step++)
+	{
+		FInputReplayStep& ReplayStep = Replay.Steps.AddDefaulted_GetRef();
+		ReplayStep.Flight = FlightCoreTests::MakeInput(Step, 1);
+		ReplayStep.CameraRight = FMath::Sin(Step * 0.1f) * 45.f;
+		ReplayStep.CameraUp = FMath::Cos(Step * 0.1f) * -30.f;
+		ReplayStep.Actions = uint8(Step % 8);
+	}
+
+	const bool bSaved = Replay.Save(Filename);
+	FInputReplay Loaded;
+	const bool bLoaded = bSaved && Loaded.Load(Filename);
+	IFileManager::Get().Delete(*Filename);
+	if (!TestTrue(TEXT("Saved"), bSaved) || !TestTrue(TEXT("Loaded"), bLoaded))
+	{
+		return false;
+	}
+
+	// Floats are stored exactly, so the replay must come back bit for bit
+	TestEqual(TEXT("Seed"), Loaded.Seed, Replay.Seed);
+	TestEqual(TEXT("Step rate"), Loaded.StepRate, Replay.StepRate, 0.f);
+	TestEqual(TEXT("Start location"), Loaded.StartLocation, Replay.StartLocation, 0.f);
+	TestEqual(TEXT("Start rotation"), Loaded.StartRotation, Replay.StartRotation, 0.f);
+	TestTrue(TEXT("Start state"), FMemory::Memcmp(&Loaded.StartState, &Replay.StartState, sizeof(FFlightModelState)) == 0);
+	if (!TestEqual(TEXT("Steps"), Loaded.Steps.Num(), Replay.Steps.Num()))
+	{
+		return false;
+	}
+	for (int32 Step = 0; Step < Replay.Steps.Num(); Step++)
+	{
+		const FInputReplayStep& Saved = Replay.Steps[Step];
+		const FInputReplayStep& Read = Loaded.Steps[Step];
+		if (FMemory::Memcmp(&Saved.Flight, &Read.Flight, sizeof(FFlightModelInput)) != 0 || Saved.CameraRight != Read.CameraRight
+			|| Saved.CameraUp != Read.CameraUp || Saved.Actions != Read.Actions)
+		{
+			AddError(FString::Printf(TEXT("Step %d differs after the round trip"), Step));
+			return false;
+		}
+	}
+
+	// Anything else is rejected rather than read as a replay
+	const FString BadFilename = FPaths::AutomationTransientDir() / TEXT("InputReplayRoundTrip.bad");
+	TArray<uint8> Garbage;
+	Garbage.Init(0xab, 64);
+	TestTrue(TEXT("Garbage written"), FFileHelper::SaveArrayToFile(Garbage, *BadFilename));
+	TestFalse(TEXT("Garbage loaded"), FInputReplay().Load(BadFilename));
+	IFileManager::Get().Delete(*BadFilename);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainHeightfieldQueriesTest, "ACRL.FlightCore.TerrainHeightfieldQueries", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTerrainHeightfieldQueriesTest::RunTest(const FString& Parameters)
+{
+	// A tilted plane across several tiles, which the two triangles per cell reproduce up to quantization
+	const FVector2D Origin(-1000.f, -2000.f);
+	const float Spacing = 100.f;
+	const int32 NumX = 33;
+	const int32 NumY = 21;
+	TArray<float> Heights;
+	for (int32 Y = 0; Y < NumY; Y++)
+	{
+		for (int32 X = 0; X < NumX; X++)
+		{
+			Heights.Add(FlightCoreTests::PlaneHeight(Origin.X + X * Spacing, Origin.Y + Y * Spacing));
+		}
+	}
+
+	// One sample without terrain, in the cells around (1000, -1000)
+	const int32 HoleX = 20;
+	const int32 HoleY = 10;
+	Heights[HoleY * NumX + HoleX] = FTerrainHeightfield::NoTerrain;
+
+	FTerrainHeightfield Heightfield;
+	Heightfield.Build(Origin, Spacing, NumX, NumY, Heights);
+	TestTrue(TEXT("Valid"), Heightfield.IsValid());
+
+	float Height = 0.f;
+	for (const FVector2D& Point : { FVector2D(-1000.f, -2000.f), FVector2D(-512.3f, -1337.f), FVector2D(2200.f, 0.f), FVector2D(40.f, -60.f) })
+	{
+		const bool bFound = Heightfield.GetHeight(Point.X, Point.Y, Height);
+		TestTrue(*FString::Printf(TEXT("Height found at %s"), *Point.ToString()), bFound);
+		TestEqual(*FString::Printf(TEXT("Height at %s"), *Point.ToString()), Height, FlightCoreTests::PlaneHeight(Point.X, Point.Y), 0.1f);
+	}
+	TestFalse(TEXT("Height outside the grid"), Heightfield.GetHeight(2300.f, 0.f, Height));
+
+	// A vertical drop crosses the plane where GetHeight says it is
+	const FVector Start(-300.f, -700.f, 5000.f);
+	const FVector End(-300.f, -700.f, -5000.f);
+	float Time = 1.f;
+	TestTrue(TEXT("Drop hits"), Heightfield.IntersectSegment(Start, End, Time));
+	TestEqual(TEXT("Drop hit height"), FMath::Lerp(Start.Z, End.Z, Time), FlightCoreTests::PlaneHeight(Start.X, Start.Y), 0.1f);
+	TestFalse(TEXT("Segment above the terrain"), Heightfield.IntersectSegment(FVector(-900.f, -1900.f, 5000.f), FVector(2100.f, -100.f, 5000.f), Time));
+
+	// The cells around the missing sample hold no terrain, rather than a pit down to it
+	const float HoleWorldX = Origin.X + HoleX * Spacing;
+	const float HoleWorldY = Origin.Y + HoleY * Spacing;
+	TestFalse(TEXT("Height beside the missing sample"), Heightfield.GetHeight(HoleWorldX - 50.f, HoleWorldY + 50.f, Height));
+	TestFalse(TEXT("Drop beside the missing sample"), Heightfield.IntersectSegment(FVector(HoleWorldX + 50.f, HoleWorldY - 50.f, 5000.f), FVector(HoleWorldX + 50.f, HoleWorldY - 50.f, -5000.f), Time));
+	TestTrue(TEXT("Height two cells away"), Heightfield.GetHeight(HoleWorldX - 150.f, HoleWorldY, Height));
+
+	const FBox Bounds = Heightfield.GetBounds();
+	TestTrue(TEXT("Bounds cover the plane"), Bounds.IsValid && Bounds.Min.Z <= FlightCoreTests::PlaneHeight(-1000.f, 0.f) + 0.1f && Bounds.Max.Z >= FlightCoreTests::PlaneHeight(2200.f, -2000.f) - 0.1f);
+	return true;
+}
+
+#endif
@@ -0,0 +1,60 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FlightModel.h"
+
+/**
+ * Many aircraft stored as parallel arrays and stepped with the same rules as FFlightModel, without collision.
+ * Speeds are integrated in flat loops over contiguous floats, and positions and rotations with vector
+ * quaternion maths. Step works on an index range, so callers can split a large batch across workers.
+ */
+struct FLIGHTCORE_API FAircraftBatch
+{
+	/** Appends an aircraft and returns its index */
+	int32 Add(const FFlightModelParams& InParams, const FVector& Location, const FQuat& Rotation, const FFlightModelState& State);
+
+	/** Removes aircraft Index by swapping the last aircraft into its slot */
+	void RemoveAtSwap(int32 Index);
+
+	/** Removes every aircraft */
+	void Empty();
+
+	FORCEINLINE int32 Num() const { return Locations.Num(); }
+
+	/** Sets the control axes aircraft Index holds from now on */
+	void SetInput(int32 Index, const FFlightModelInput& Input);
+
+	/** Returns the flight speeds of aircraft Index */
+	FFlightModelState GetState(int32 Index) const;
+
+	/** Advances aircraft [BeginIndex, EndIndex) by one step, keeping their previous transforms for interpolation */
+	void Step(float StepTime, int32 BeginIndex, int32 EndIndex);
+
+	/** Returns the transform of aircraft Index drawn Alpha of the way from its previous to its current step */
+	FTransform GetInterpolatedTransform(int32 Index, float Alpha) const;
+
+	/** Handling limits of each aircraft */
+	TArray<FFlightModelParams> Params;
+
+	/** Control axes of each aircraft */
+	TArray<float> ThrustInputs;
+	TArray<float> UpInputs;
+	TArray<float> RightInputs;
+	TArray<float> YawInputs;
+
+	/** Flight speeds of each aircraft */
+	TArray<float> ForwardSpeeds;
+	TArray<float> Accelerations;
+	TArray<float> PitchSpeeds;
+	TArray<float> YawSpeeds;
+	TArray<float> RollSpeeds;
+
+	/** Transform of each aircraft after the last step */
+	TArray<FVector> Locations;
+	TArray<FQuat> Rotations;
+
+	/** Transform of each aircraft before the last step */
+	TArray<FVector> PreviousLocations;
+	TArray<FQuat> PreviousRotations;
+};
@@ -0,0 +1,31 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Motion of unpowered rounds under constant gravity, with no drag.
+ * The closed forms let a round's position be evaluated at any time from its launch state alone.
+ */
+struct FLIGHTCORE_API FBallistics
+{
+	/** Returns where a round launched from Origin with Velocity is after FlightTime seconds */
+	static FORCEINLINE FVector EvaluateLocation(const FVector& Origin, const FVector& Velocity, const FVector& Gravity, float FlightTime)
+	{
+		return Origin + Velocity * FlightTime + Gravity * (0.5f * FlightTime * FlightTime);
+	}
+
+	/** Returns the velocity of a round launched with Velocity after FlightTime seconds */
+	static FORCEINLINE FVector EvaluateVelocity(const FVector& Velocity, const FVector& Gravity, float FlightTime)
+	{
+		return Velocity + Gravity * FlightTime;
+	}
+
+	/**
+	 * Advances every round by StepTime seconds.
+	 * The update is exact for constant gravity, so the step size does not change the path.
+	 * @param Locations		Location of each round, updated in place
+	 * @param Velocities	Velocity of each round, same length as Locations, updated in place
+	 */
+	static void StepBatch(TArrayView<FVector> Locations, TArrayView<FVector> Velocities, const FVector& Gravity, float StepTime);
+};
@@ -0,0 +1,157 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Handling limits of an aircraft */
+struct FFlightModelParams
+{
+	/** How quickly the thrust setting changes, per second of full input */
+	float Acceleration = 15000.f;
+
+	/** Pitch and roll rate at full input, in degrees per second */
+	float TurnSpeed = 50.f;
+
+	/** Yaw rate at half input, in degrees per second */
+	float YawSpeed = 10.f;
+
+	float MinSpeed = 7200.f;
+	float MaxSpeed = 67056.f;
+	float MinAcceleration = -7500.f;
+	float MaxAcceleration = 10000.f;
+};
+
+/** Control axes held by the pilot, each in [-1, 1] */
+struct FFlightModelInput
+{
+	float Thrust = 0.f;
+	float Up = 0.f;
+	float Right = 0.f;
+	float Yaw = 0.f;
+};
+
+/** Everything the flight model integrates apart from the aircraft's transform */
+struct FFlightModelState
+{
+	float ForwardSpeed = 0.f;
+	float Acceleration = 0.f;
+	float PitchSpeed = 0.f;
+	float YawSpeed = 0.f;
+	float RollSpeed = 0.f;
+};
+
+/** Full state of one aircraft flown without a world, for batch stepping */
+struct FAircraftState
+{
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FFlightModelState Flight;
+};
+
+/**
+ * Arcade flight model advanced in fixed steps.
+ * The single aircraft step only produces the local move and rotation of the aircraft, so an owner that
+ * sweeps the move against the world can apply it itself. The batch step applies them directly.
+ */
+struct FLIGHTCORE_API FFlightModel
+{
+	/**
+	 * Advances State by one step of StepTime seconds.
+	 * @param OutLocalMove		Receives the move along the aircraft's axes this step
+	 * @param OutDeltaRotation	Receives the local rotation this step
+	 */
+	static void Step(const FFlightModelParams& Params, const FFlightModelInput& Input, float StepTime, FFlightModelState& State, FVector& OutLocalMove, FRotator& OutDeltaRotation)
+	{
+		// If thrust is not held down, settle back towards cruise
+		const bool bHasThrust = !FMath::IsNearlyEqual(Input.Thrust, 0.f);
+		const float ThrustChange = bHasThrust ? (Input.Thrust * Params.Acceleration) : (-0.4f * State.Acceleration);
+		State.Acceleration = FMath::Clamp(State.Acceleration + StepTime * ThrustChange, Params.MinAcceleration, Params.MaxAcceleration);
+
+		// When steering, we decrease pitch slightly
+		const float TargetPitchSpeed = -Input.Up * Params.TurnSpeed - FMath::Abs(State.YawSpeed) * 0.2f;
+		State.PitchSpeed = FMath::FInterpTo(State.PitchSpeed, TargetPitchSpeed, StepTime, 2.f);
+		State.RollSpeed = FMath::FInterpTo(State.RollSpeed, 2.f * Input.Right * Params.TurnSpeed, StepTime, 2.f);
+		State.YawSpeed = FMath::FInterpTo(State.YawSpeed, 2.f * Input.Yaw * Params.YawSpeed, StepTime, 2.f);
+
+		State.ForwardSpeed = FMath::Clamp(State.ForwardSpeed + StepTime * State.Acceleration, Params.MinSpeed, Params.MaxSpeed);
+
+		OutLocalMove = FVector(State.ForwardSpeed * StepTime, 0.f, 0.f);
+		OutDeltaRotation = FRotator(State.PitchSpeed * StepTime, State.YawSpeed * StepTime, State.RollSpeed * StepTime);
+	}
+
+	/**
+	 * Predicts the path of an aircraft that holds its current speed and turn rates.
+	 * @param StepTime	Seconds between two points of the path
+	 * @param OutPath	Receives NumSteps points, the first one StepTime seconds ahead of Start
+	 */
+	static void PredictPath(const FAircraftState& Start, float StepTime, int32 NumSteps, TArray<FVector>& OutPath)
+	{
+		const FVector LocalMove(Start.Flight.ForwardSpeed * StepTime, 0.f, 0.f);
+		const FQuat DeltaRotation(FRotator(Start.Flight.PitchSpeed * StepTime, Start.Flight.YawSpeed * StepTime, Start.Flight.RollSpeed * StepTime));
+
+		FVector Location = Start.Location;
+		FQuat Rotation = Start.Rotation;
+		OutPath.Reset(NumSteps);
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			// Move along the current facing, then turn, as a step does
+			Location += Rotation.RotateVector(LocalMove);
+			Rotation = Rotation * DeltaRotation;
+			OutPath.Add(Location);
+		}
+	}
+
+	/**
+	 * Advances every aircraft in States by one step, moving them without collision.
+	 * @param Inputs	Control axes of each aircraft, same length as States
+	 */
+	static void StepBatch(const FFlightModelParams& Params, TArrayView<const FFlightModelInput> Inputs, TArrayView<FAircraftState> States, float StepTime);
+};
+
+/**
+ * Fixed step accumulator.
+ * Reports how many whole steps are owed for a frame and how far the frame has progressed into the next one,
+ * so a fixed rate simulation can be drawn smoothly at any frame rate.
+ */
+struct FFixedStepClock
+{
+	FFixedStepClock()
+		: Accumulator(0.f)
+	{
+	}
+
+	/**
+	 * Advances the clock by one frame.
+	 * @param DeltaTime	Length of the frame in seconds
+	 * @param StepTime	Length of one step in seconds
+	 * @param MaxSteps	Upper bound on steps per frame, time beyond it is dropped so a hitch cannot snowball
+	 * @return Number of steps owed this frame
+	 */
+	int32 Advance(float DeltaTime, float StepTime, int32 MaxSteps)
+	{
+		if (StepTime <= 0.f)
+		{
+			return 0;
+		}
+
+		Accumulator += DeltaTime;
+		const int32 NumSteps = FMath::Min(FMath::FloorToInt(Accumulator / StepTime), FMath::Max(1, MaxSteps));
+		Accumulator = FMath::Min(Accumulator - NumSteps * StepTime, StepTime);
+		return NumSteps;
+	}
+
+	/** Returns how far the clock is between the last two steps, in [0, 1] */
+	float GetAlpha(float StepTime) const
+	{
+		return StepTime > 0.f ? FMath::Clamp(Accumulator / StepTime, 0.f, 1.f) : 1.f;
+	}
+
+	void Reset()
+	{
+		Accumulator = 0.f;
+	}
+
+private:
+	/** Seconds of simulation owed but not yet stepped */
+	float Accumulator;
+};
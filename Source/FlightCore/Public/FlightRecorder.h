@@ -0,0 +1,97 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "FlightModel.h"
+
+class FArchive;
+class FRunnableThread;
+
+/** State of one aircraft after one flight model step */
+struct FFlightRecord
+{
+	/** World time of the frame the step ran in */
+	float Time;
+
+	/** Length of that frame, several steps share one frame and hitches show up here */
+	float FrameTime;
+
+	FVector Location;
+	FRotator Rotation;
+	FFlightModelInput Input;
+	FFlightModelState State;
+};
+
+/**
+ * Streams flight records to a file on a background thread.
+ * Records are queued in a lock-free single producer, single consumer ring buffer, so recording a step costs a
+ * copy and never blocks. The writer thread drains the ring a hundred times a second and appends the records
+ * quantized to fixed point, each field stored as a variable length delta from the previous record.
+ * Records are dropped rather than waited for if the writer falls behind.
+ */
+class FLIGHTCORE_API FFlightRecorder : public FRunnable
+{
+public:
+	/**
+	 * Starts recording into Filename.
+	 * @param Capacity	Records the ring holds before new ones are dropped
+	 * @return The recorder, or null if the file cannot be written
+	 */
+	static TUniquePtr<FFlightRecorder> Create(const FString& Filename, uint32 Capacity = 8192);
+
+	/** Writes out whatever is still queued and closes the file */
+	virtual ~FFlightRecorder();
+
+	/** Queues Record, call from one thread only */
+	FORCEINLINE void Record(const FFlightRecord& Record)
+	{
+		if (!Queue.Enqueue(Record))
+		{
+			NumDropped++;
+		}
+	}
+
+	/** Returns the number of records dropped because the ring was full */
+	FORCEINLINE int32 GetNumDropped() const { return NumDropped; }
+
+	// Begin FRunnable overrides
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End FRunnable overrides
+
+private:
+	FFlightRecorder(FArchive* InArchive, uint32 Capacity);
+
+	/** Encodes and writes every queued record, writer thread only */
+	void Drain();
+
+	TCircularQueue<FFlightRecord> Queue;
+
+	/** Output file, owned by the writer thread once it runs */
+	FArchive* Archive;
+
+	FRunnableThread* Thread;
+
+	FThreadSafeBool bStopping;
+
+	int32 NumDropped;
+
+	/** Quantized fields of the last record written */
+	TArray<int32> Previous;
+
+	/** Scratch encoded bytes */
+	TArray<uint8> Buffer;
+};
+
+/** Reads files written by FFlightRecorder */
+struct FLIGHTCORE_API FFlightRecordReader
+{
+	/** Reads every record of Filename, returns false if it is not a flight record file */
+	static bool Read(const FString& Filename, TArray<FFlightRecord>& OutRecords);
+
+	/** Writes every record of Filename as one CSV row to CsvFilename */
+	static bool ExportCsv(const FString& Filename, const FString& CsvFilename);
+};
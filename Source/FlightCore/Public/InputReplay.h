@@ -0,0 +1,62 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FlightModel.h"
+
+/** Input actions, as bits of FInputReplayStep::Actions */
+namespace EInputReplayAction
+{
+	enum Type : uint8
+	{
+		MGunPressed = 1 << 0,
+		MGunReleased = 1 << 1,
+		Missile = 1 << 2,
+	};
+}
+
+/** What an input replay owner is doing with its replay */
+enum class EInputReplayMode : uint8
+{
+	None,
+	Recording,
+	Playing,
+};
+
+/** Everything bound to input as of one flight model step */
+struct FInputReplayStep
+{
+	FFlightModelInput Flight;
+	float CameraRight = 0.f;
+	float CameraUp = 0.f;
+
+	/** EInputReplayAction bits triggered since the previous step */
+	uint8 Actions = 0;
+};
+
+/**
+ * Input of one sortie, sampled once per flight model step.
+ * Fed back step for step from the same start state, with the same seed and step rate, the flight model retraces
+ * the recorded flight path whatever the frame rate of either run.
+ */
+struct FLIGHTCORE_API FInputReplay
+{
+	/** Seed of the cannon dispersion and of the global random stream */
+	int32 Seed = 0;
+
+	/** Flight model steps per second */
+	float StepRate = 0.f;
+
+	FVector StartLocation = FVector::ZeroVector;
+	FRotator StartRotation = FRotator::ZeroRotator;
+	FFlightModelState StartState;
+
+	/** One entry per flight model step */
+	TArray<FInputReplayStep> Steps;
+
+	/** Writes the replay to Filename, returns false if the file cannot be written */
+	bool Save(const FString& Filename) const;
+
+	/** Replaces the replay with the one in Filename, returns false if it is missing or not an input replay */
+	bool Load(const FString& Filename);
+};
@@ -0,0 +1,63 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Gun and round state shared by every target of one intercept batch */
+struct FInterceptShooter
+{
+	/** Where rounds leave the gun */
+	FVector MuzzleLocation = FVector::ZeroVector;
+
+	/** Where the gun points now, normalized */
+	FVector AimDirection = FVector::ForwardVector;
+
+	/** Launch speed of a round along the gun, including whatever speed the shooter adds to it, in cm/s */
+	float RoundSpeed = 0.f;
+
+	FVector Gravity = FVector::ZeroVector;
+
+	/** Dispersion of each round in pitch and in yaw, in degrees either side of the aim */
+	float DispersionCone = 0.f;
+
+	/** Rounds are gone after this many seconds, targets further out cannot be hit. Must be positive */
+	float MaxFlightTime = 0.f;
+};
+
+/** Where to aim to hit one target, and how likely a round fired now is to hit it */
+struct FInterceptSolution
+{
+	/** Point to aim the gun at, it leads the target and allows for the drop of the round */
+	FVector AimPoint;
+
+	/** Seconds from the muzzle to the target */
+	float FlightTime;
+
+	/** Chance of a single round fired along the current aim hitting, 0 when out of range */
+	float HitProbability;
+};
+
+/**
+ * Lead computing solver for unguided rounds, with the same no-drag ballistics as FBallistics.
+ * Targets are assumed to hold their velocity over the flight time of a round.
+ */
+struct FLIGHTCORE_API FInterceptSolver
+{
+	/**
+	 * Fixed point iterations on the flight time. Each one shrinks the error by about the ratio of target speed
+	 * to round speed, so a handful converges for anything slower than the rounds.
+	 */
+	static const int32 NumIterations = 4;
+
+	/**
+	 * Solves every target in one pass.
+	 * The hit probability treats the target as a square of side twice its radius, facing the gun, and the
+	 * dispersion as uniform over the cone the gun's rounds are spread across.
+	 * @param TargetLocations	Location of each target
+	 * @param TargetVelocities	Velocity of each target, same length as TargetLocations
+	 * @param TargetRadii		Radius of each target, same length as TargetLocations
+	 * @param OutSolutions		Receives one solution per target, same length as TargetLocations
+	 */
+	static void SolveBatch(const FInterceptShooter& Shooter, TArrayView<const FVector> TargetLocations, TArrayView<const FVector> TargetVelocities,
+		TArrayView<const float> TargetRadii, TArrayView<FInterceptSolution> OutSolutions);
+};
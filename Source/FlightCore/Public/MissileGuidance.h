@@ -0,0 +1,40 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Airframe limits of one guided missile */
+struct FMissileGuidanceParams
+{
+	/** Speed the missile holds, in cm/s */
+	float Speed = 80000.f;
+
+	/** Most lateral acceleration the airframe can pull, in cm/s^2 */
+	float MaxAcceleration = 30000.f;
+
+	/** Ratio of the turn rate of the missile to the turn rate of the line of sight, 3 to 5 in practice */
+	float NavigationConstant = 4.f;
+};
+
+/**
+ * Proportional navigation for constant speed missiles.
+ * Each missile turns at a multiple of the rotation rate of its line of sight to the target, which flies it onto
+ * a collision course without having to predict where the target is going.
+ */
+struct FLIGHTCORE_API FMissileGuidance
+{
+	/**
+	 * Steers and moves every missile by StepTime.
+	 * Missiles that are not tracking fly straight on.
+	 * @param Locations				Location of each missile, updated in place
+	 * @param Velocities			Velocity of each missile, same length as Locations, updated in place
+	 * @param TargetLocations		Location of each missile's target at the start of the step
+	 * @param TargetVelocities		Velocity of each missile's target
+	 * @param Tracking				Whether each missile has a target to steer for
+	 * @param OutClosestApproach	Receives the closest distance between each missile and its target during the step, MAX_flt when not tracking
+	 * @param OutApproachTimes		Receives how far into the step, in seconds, each missile came closest to its target
+	 */
+	static void StepBatch(TArrayView<const FMissileGuidanceParams> Params, TArrayView<FVector> Locations, TArrayView<FVector> Velocities,
+		TArrayView<const FVector> TargetLocations, TArrayView<const FVector> TargetVelocities, TArrayView<const bool> Tracking,
+		TArrayView<float> OutClosestApproach, TArrayView<float> OutApproachTimes, float StepTime);
+};
@@ -0,0 +1,121 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Immutable terrain height grid answering height and segment queries without a physics scene.
+ * Heights are quantized to 16 bits and stored in square tiles so neighbouring samples share cache lines.
+ * A min/max pyramid over the grid cells lets segment tests skip any region the segment stays above.
+ * Samples may be marked as having no terrain; heights and hits are only reported over cells whose corners all hold terrain.
+ * Every query is const and touches no shared mutable state, so a built heightfield can be read from any thread.
+ */
+class FLIGHTCORE_API FTerrainHeightfield
+{
+public:
+	/** Samples per tile edge */
+	static const int32 TileSize = 16;
+
+	/** Height passed to Build for samples where there is no terrain */
+	static const float NoTerrain;
+
+	FTerrainHeightfield();
+
+	/**
+	 * Builds the heightfield from a grid of samples.
+	 * @param InOrigin	World XY of sample (0, 0)
+	 * @param InSpacing	Distance between neighbouring samples, in cm
+	 * @param InNumX	Samples along X, at least 2
+	 * @param InNumY	Samples along Y, at least 2
+	 * @param Heights	InNumX * InNumY world heights, row by row along X, NoTerrain where there is none
+	 */
+	void Build(const FVector2D& InOrigin, float InSpacing, int32 InNumX, int32 InNumY, TArrayView<const float> Heights);
+
+	/** Returns whether the heightfield holds any terrain */
+	FORCEINLINE bool IsValid() const { return NumX >= 2 && NumY >= 2; }
+
+	/** Returns the terrain height under X, Y, or false outside the grid or where there is no terrain */
+	bool GetHeight(float X, float Y, float& OutHeight) const;
+
+	/** Returns how far Location is above the terrain, negative below it, or false outside the grid or where there is no terrain */
+	bool GetHeightAboveGround(const FVector& Location, float& OutHeight) const;
+
+	/**
+	 * Finds where the segment from Start to End first crosses the terrain surface.
+	 * @param OutTime	Receives the fraction of the segment at the hit
+	 * @return Whether the segment hits the terrain within the grid
+	 */
+	bool IntersectSegment(const FVector& Start, const FVector& End, float& OutTime) const;
+
+	/** Terrain height under each point, OutsideHeight for points outside the grid or where there is no terrain */
+	void GetHeights(TArrayView<const FVector> Points, TArrayView<float> OutHeights, float OutsideHeight = -MAX_flt) const;
+
+	/** Hit fraction of each segment, 1 for segments that do not hit the terrain */
+	void IntersectSegments(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<float> OutTimes) const;
+
+	/** World bounds of the grid, from the lowest to the highest terrain sample */
+	FBox GetBounds() const;
+
+	/** Bytes held by the samples and the pyramid */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/** Quantized value of samples without terrain, above every height */
+	static const uint16 NoTerrainSample = 65535;
+
+	/** Lowest and highest quantized height of a pyramid cell, Min above Max when no part of it holds terrain */
+	struct FMinMax
+	{
+		uint16 Min;
+		uint16 Max;
+	};
+
+	/** Returns the index of sample X, Y in the tiled sample array */
+	FORCEINLINE int32 GetSampleIndex(int32 X, int32 Y) const
+	{
+		const int32 Tile = (Y / TileSize) * TilesX + (X / TileSize);
+		return Tile * TileSize * TileSize + (Y % TileSize) * TileSize + (X % TileSize);
+	}
+
+	FORCEINLINE float Decode(uint16 Quantized) const
+	{
+		return MinHeight + Quantized * HeightStep;
+	}
+
+	FORCEINLINE float GetSampleHeight(int32 X, int32 Y) const
+	{
+		return Decode(Samples[GetSampleIndex(X, Y)]);
+	}
+
+	/**
+	 * Tests the segment against pyramid cell CellX, CellY of Level and its children.
+	 * Start and Delta are in grid space: X and Y in samples, Z in cm.
+	 * @param InOutTime	Earliest hit found so far, lowered when this cell holds an earlier one
+	 */
+	bool IntersectCell(int32 Level, int32 CellX, int32 CellY, const FVector& Start, const FVector& Delta, float& InOutTime) const;
+
+	/** Tests the segment against the two triangles of grid cell CellX, CellY */
+	bool IntersectGridCell(int32 CellX, int32 CellY, const FVector& Start, const FVector& Delta, float& InOutTime) const;
+
+	FVector2D Origin;
+	float Spacing;
+	float InvSpacing;
+	int32 NumX;
+	int32 NumY;
+	int32 TilesX;
+
+	/** Height of quantized value 0 */
+	float MinHeight;
+
+	/** Height of one quantized step */
+	float HeightStep;
+
+	/** Quantized heights, tile by tile, NoTerrainSample where there is no terrain */
+	TArray<uint16> Samples;
+
+	/** Min/max of each cell per pyramid level, level 0 holds one entry per grid cell */
+	TArray<TArray<FMinMax>> Levels;
+
+	/** Cells along X and Y at each pyramid level */
+	TArray<FIntPoint> LevelSizes;
+};